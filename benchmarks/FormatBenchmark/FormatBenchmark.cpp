@@ -0,0 +1,59 @@
+#include <Core/Format.hpp>
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+using namespace cobalt::core;
+
+// The formatting half of the old Log path, which went through vprintf
+static size_t formatWithVsnprintf( char* out, size_t outSize, const char* format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    int length = std::vsnprintf( out, outSize, format, args );
+    va_end( args );
+    return length > 0 ? static_cast< size_t >( length ) : 0;
+}
+
+template< typename Function >
+static double nanosecondsPerCall( int iterations, Function function )
+{
+    auto start = std::chrono::steady_clock::now();
+    for( int i = 0; i < iterations; ++i )
+    {
+        function( i );
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration< double, std::nano >( elapsed ).count() / iterations;
+}
+
+int main( int argc, char* argv[] )
+{
+    const int iterations = 2000000;
+    char buffer[ 256 ];
+    size_t checksum = 0;
+
+    std::printf( "%-28s %14s %14s %8s\n", "case", "vsnprintf ns", "format ns", "speedup" );
+
+#define COBALT_FORMAT_CASE( name, ... ) \
+    { \
+        double baseline = nanosecondsPerCall( iterations, [&]( int i ) { checksum += formatWithVsnprintf( buffer, sizeof( buffer ), __VA_ARGS__ ); } ); \
+        double cobalt = nanosecondsPerCall( iterations, [&]( int i ) { checksum += format( buffer, sizeof( buffer ), __VA_ARGS__ ); } ); \
+        std::printf( "%-28s %14.1f %14.1f %7.2fx\n", name, baseline, cobalt, baseline / cobalt ); \
+    }
+
+    COBALT_FORMAT_CASE( "literal only", "Application startup complete." );
+    COBALT_FORMAT_CASE( "one int", "frame %d", i );
+    COBALT_FORMAT_CASE( "three ints", "%d %d %d", i, i * 7, -i );
+    COBALT_FORMAT_CASE( "hex and padding", "%08x|%-6d|", i, i );
+    COBALT_FORMAT_CASE( "dt %2.4g", "%2.4g seconds since last onUpdate()", 0.016 + i * 1e-9 );
+    COBALT_FORMAT_CASE( "fixed %.3f", "dt=%.3f", 0.016 + i * 1e-9 );
+    COBALT_FORMAT_CASE( "string", "Hello %s!", "World" );
+    COBALT_FORMAT_CASE( "mixed", "%s: %d items, %.2f%% full", "pool", i, 12.5 );
+
+#undef COBALT_FORMAT_CASE
+
+    std::printf( "(checksum %zu)\n", checksum );
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <Platform/Application.hpp>
+#include <Core/Clock.hpp>
+#include <Core/Log.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace cobalt::core;
+using namespace cobalt::platform;
+
+/// Headless application with a trivial update, so the timings are the
+/// frame loop's own overhead
+class FrameLoopBenchmark : public Application
+{
+public:
+    explicit FrameLoopBenchmark( long frames ) : mFrames( frames ) {}
+
+    long framesRun() const { return mFramesRun; }
+
+protected:
+    virtual void configure( WindowConfiguration& config ) override
+    {
+        config.isHeadless = true;
+        config.frameStatsReportInterval = 0.0;
+    }
+
+    virtual void startup() override {}
+
+    virtual void update( double dt ) override
+    {
+        mChecksum += dt;
+        if( ++mFramesRun >= mFrames )
+        {
+            requestShutdown();
+        }
+    }
+
+    virtual void shutdown() override {}
+
+private:
+    long mFrames;
+    long mFramesRun = 0;
+    double mChecksum = 0.0;
+};
+
+int main( int argc, char* argv[] )
+{
+    long frames = argc > 1 ? std::atol( argv[ 1 ] ) : 1000000;
+    Log::sMinLogLevel = Log::Level::Warn;
+
+    FrameLoopBenchmark app( frames );
+    int64_t start = Clock::nowNs();
+    launchCobaltApplication( &app );
+    double seconds = Clock::toSeconds( Clock::nowNs() - start );
+
+    FrameStats::Summary stats = app.frameStats().summary();
+    std::printf( "%ld frames in %.3f s: %.1f ns/frame\n", app.framesRun(), seconds, seconds * 1e9 / app.framesRun() );
+    std::printf( "last %zu frames: p50 %.3f us, p95 %.3f us, p99 %.3f us, max %.3f us\n",
+                 stats.frameCount, stats.total.p50 * 1e6, stats.total.p95 * 1e6, stats.total.p99 * 1e6, stats.total.max * 1e6 );
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <Core/Clock.hpp>
+#include <Core/FlatHashMap.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace cobalt::core;
+
+// Compares FlatHashMap with std::unordered_map (with std::hash) at sizes
+// from 1K entries up to the given maximum, with integer keys and with
+// resource-name-like string keys.  Reports nanoseconds per operation for
+// inserting without reserve(), looking up present keys in random order,
+// looking up absent keys, iterating and erasing.
+// Usage: cobalt_hash_map_benchmark [maxEntries] [maxStringEntries]
+
+// At least this many lookups per measurement, so small tables time long enough
+static const size_t kMinLookups = 4000000;
+
+// Keeps the results from being optimized away
+static volatile uint64_t sSink;
+
+struct Timings
+{
+    double insert = 0.0;
+    double hit = 0.0;
+    double miss = 0.0;
+    double iterate = 0.0;
+    double erase = 0.0;
+};
+
+static double nanosecondsPer( int64_t start, size_t count )
+{
+    return double( Clock::nowNs() - start ) / double( count );
+}
+
+template< typename Map, typename Key >
+static Timings measure( const std::vector< Key >& keys, const std::vector< Key >& probes, const std::vector< Key >& absent )
+{
+    typedef typename Map::value_type Value;
+    Timings timings;
+    Map map;
+    uint64_t sum = 0;
+
+    int64_t start = Clock::nowNs();
+    for( size_t i = 0; i < keys.size(); ++i )
+    {
+        map.insert( Value( keys[ i ], i ) );
+    }
+    timings.insert = nanosecondsPer( start, keys.size() );
+
+    size_t lookups = std::max( kMinLookups, probes.size() );
+    start = Clock::nowNs();
+    for( size_t i = 0, p = 0; i < lookups; ++i, p = p + 1 == probes.size() ? 0 : p + 1 )
+    {
+        sum += map.find( probes[ p ] )->second;
+    }
+    timings.hit = nanosecondsPer( start, lookups );
+
+    start = Clock::nowNs();
+    for( size_t i = 0, p = 0; i < lookups; ++i, p = p + 1 == absent.size() ? 0 : p + 1 )
+    {
+        sum += map.find( absent[ p ] ) == map.end() ? 1 : 0;
+    }
+    timings.miss = nanosecondsPer( start, lookups );
+
+    start = Clock::nowNs();
+    for( const Value& value : map )
+    {
+        sum += value.second;
+    }
+    timings.iterate = nanosecondsPer( start, map.size() );
+
+    start = Clock::nowNs();
+    for( const Key& key : probes )
+    {
+        sum += map.erase( key );
+    }
+    timings.erase = nanosecondsPer( start, probes.size() );
+
+    sSink = sum;
+    return timings;
+}
+
+static void report( const char* keyType, size_t count, const Timings& flat, const Timings& standard )
+{
+    const char* names[] = { "insert", "hit", "miss", "iterate", "erase" };
+    double flatTimes[] = { flat.insert, flat.hit, flat.miss, flat.iterate, flat.erase };
+    double standardTimes[] = { standard.insert, standard.hit, standard.miss, standard.iterate, standard.erase };
+    for( size_t i = 0; i < 5; ++i )
+    {
+        std::printf( "%-8s %10zu %-8s %12.1f %16.1f %8.2fx\n", keyType, count, names[ i ], flatTimes[ i ], standardTimes[ i ],
+                     standardTimes[ i ] / flatTimes[ i ] );
+    }
+}
+
+/// `count` distinct keys made by `make`, plus `count` more that aren't among them
+template< typename Key, typename Make >
+static void makeKeys( size_t count, Make make, std::vector< Key >& keys, std::vector< Key >& probes, std::vector< Key >& absent )
+{
+    std::mt19937_64 random( count );
+    std::vector< uint64_t > numbers( 2 * count );
+    for( size_t i = 0; i < numbers.size(); ++i )
+    {
+        // Distinct but scattered
+        numbers[ i ] = hashInteger( i );
+    }
+    keys.clear();
+    absent.clear();
+    for( size_t i = 0; i < count; ++i )
+    {
+        keys.push_back( make( numbers[ i ] ) );
+        absent.push_back( make( numbers[ count + i ] ) );
+    }
+    probes = keys;
+    std::shuffle( probes.begin(), probes.end(), random );
+}
+
+int main( int argc, char* argv[] )
+{
+    size_t maxCount = argc > 1 ? static_cast< size_t >( std::atoll( argv[ 1 ] ) ) : 10000000;
+    size_t maxStringCount = argc > 2 ? static_cast< size_t >( std::atoll( argv[ 2 ] ) ) : 1000000;
+
+    std::printf( "FlatHashMap (%s groups) vs std::unordered_map, ns per operation\n", COBALT_FLAT_HASH_SSE2 ? "SSE2" : "scalar" );
+    std::printf( "%-8s %10s %-8s %12s %16s %9s\n", "keys", "entries", "op", "FlatHashMap", "unordered_map", "speedup" );
+
+    for( size_t count = 1000; count <= maxCount; count *= 10 )
+    {
+        std::vector< uint64_t > keys, probes, absent;
+        makeKeys< uint64_t >( count, []( uint64_t number ) { return number; }, keys, probes, absent );
+        Timings flat = measure< FlatHashMap< uint64_t, uint64_t > >( keys, probes, absent );
+        Timings standard = measure< std::unordered_map< uint64_t, uint64_t > >( keys, probes, absent );
+        report( "uint64", count, flat, standard );
+    }
+
+    for( size_t count = 1000; count <= maxStringCount; count *= 10 )
+    {
+        // Longer than the small string buffer, like real resource paths
+        std::vector< std::string > keys, probes, absent;
+        makeKeys< std::string >( count, []( uint64_t number )
+        {
+            char name[ 64 ];
+            std::snprintf( name, sizeof( name ), "textures/props/crate_%016llx.png", static_cast< unsigned long long >( number ) );
+            return std::string( name );
+        }, keys, probes, absent );
+        Timings flat = measure< FlatHashMap< std::string, uint64_t > >( keys, probes, absent );
+        Timings standard = measure< std::unordered_map< std::string, uint64_t > >( keys, probes, absent );
+        report( "string", count, flat, standard );
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <Core/Clock.hpp>
+#include <Core/TlsfHeap.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace cobalt::core;
+
+// Soak test: a long run of allocations with mixed sizes and lifetimes, the
+// way a long-running app churns through strings, buffers and resources, timing
+// every allocate and free.  Reports latency percentiles for malloc/free and
+// TlsfHeap, and how fragmented the TLSF heap ended up.
+// Usage: cobalt_heap_benchmark [millions of operations]
+
+static const size_t kShortLived = 4096;  // slots replaced constantly
+static const size_t kLongLived = 512;    // slots replaced now and then
+static const size_t kHeapBytes = 256 * 1024 * 1024;
+
+struct MallocHeap
+{
+    void* allocate( size_t size ) { return std::malloc( size ); }
+    void deallocate( void* pointer ) { std::free( pointer ); }
+};
+
+struct TlsfAdapter
+{
+    TlsfHeap heap{ kHeapBytes };
+
+    TlsfAdapter()
+    {
+        // Fault the pool's pages in up front, as a long-running app's would
+        // be, so first-touch page faults don't swamp the allocator's own cost
+        std::vector< void* > chunks;
+        while( void* chunk = heap.allocate( 1024 * 1024 ) )
+        {
+            std::memset( chunk, 0, 1024 * 1024 );
+            chunks.push_back( chunk );
+        }
+        for( void* chunk : chunks )
+        {
+            heap.deallocate( chunk );
+        }
+    }
+
+    void* allocate( size_t size ) { return heap.allocate( size ); }
+    void deallocate( void* pointer ) { heap.deallocate( pointer ); }
+};
+
+static void reportFragmentation( MallocHeap& )
+{
+}
+
+static void reportFragmentation( TlsfAdapter& adapter )
+{
+    TlsfHeap::Stats stats = adapter.heap.stats();
+    std::printf( "TlsfHeap at the end of the soak: %.1f MiB in %zu blocks, %.1f MiB free in %zu blocks, "
+                 "largest %.1f MiB, fragmentation %.3f\n",
+                 stats.usedBytes / 1048576.0, stats.usedBlocks, stats.freeBytes / 1048576.0, stats.freeBlocks,
+                 stats.largestFreeBlock / 1048576.0, stats.fragmentation() );
+}
+
+class Random
+{
+public:
+    uint32_t next()
+    {
+        mState ^= mState << 13;
+        mState ^= mState >> 17;
+        mState ^= mState << 5;
+        return mState;
+    }
+
+    /// Mostly small sizes with a long tail up to 1 MiB
+    size_t size()
+    {
+        uint32_t bucket = next() % 100;
+        if( bucket < 70 )
+        {
+            return 16 + next() % 240;
+        }
+        if( bucket < 95 )
+        {
+            return 256 + next() % 16128;
+        }
+        return 16384 + next() % ( 1024 * 1024 - 16384 );
+    }
+
+private:
+    uint32_t mState = 2463534242u;
+};
+
+struct Latencies
+{
+    std::vector< int64_t > samples;
+
+    void print( const char* name )
+    {
+        std::sort( samples.begin(), samples.end() );
+        size_t count = samples.size();
+        double sum = 0.0;
+        for( int64_t sample : samples )
+        {
+            sum += double( sample );
+        }
+        std::printf( "%-22s %10.1f %10lld %10lld %10lld %10lld\n", name, sum / double( count ),
+                     static_cast< long long >( samples[ count / 2 ] ),
+                     static_cast< long long >( samples[ count * 99 / 100 ] ),
+                     static_cast< long long >( samples[ count * 999 / 1000 ] ),
+                     static_cast< long long >( samples.back() ) );
+    }
+};
+
+template< typename Heap >
+static void soak( Heap& heap, size_t operations, Latencies& allocations, Latencies& frees )
+{
+    std::vector< void* > shortLived( kShortLived, nullptr );
+    std::vector< void* > longLived( kLongLived, nullptr );
+    allocations.samples.reserve( operations );
+    frees.samples.reserve( operations );
+    Random random;
+    for( size_t i = 0; i < operations; ++i )
+    {
+        bool isLongLived = random.next() % 64 == 0;
+        std::vector< void* >& slots = isLongLived ? longLived : shortLived;
+        void*& slot = slots[ random.next() % slots.size() ];
+        if( slot )
+        {
+            int64_t start = Clock::nowNs();
+            heap.deallocate( slot );
+            frees.samples.push_back( Clock::nowNs() - start );
+        }
+        size_t size = random.size();
+        int64_t start = Clock::nowNs();
+        slot = heap.allocate( size );
+        allocations.samples.push_back( Clock::nowNs() - start );
+        if( slot )
+        {
+            // Touch it, as a real user would
+            static_cast< char* >( slot )[ 0 ] = 1;
+            static_cast< char* >( slot )[ size - 1 ] = 1;
+        }
+    }
+    reportFragmentation( heap );
+    for( void* pointer : shortLived )
+    {
+        heap.deallocate( pointer );
+    }
+    for( void* pointer : longLived )
+    {
+        heap.deallocate( pointer );
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    size_t operations = ( argc > 1 ? static_cast< size_t >( std::atoi( argv[ 1 ] ) ) : 4 ) * 1000000;
+
+    std::printf( "%zu allocate/free pairs, latencies in ns\n", operations );
+    std::printf( "%-22s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p99", "p99.9", "max" );
+    {
+        MallocHeap heap;
+        Latencies allocations, frees;
+        soak( heap, operations, allocations, frees );
+        allocations.print( "malloc" );
+        frees.print( "free" );
+    }
+    {
+        TlsfAdapter heap;
+        Latencies allocations, frees;
+        soak( heap, operations, allocations, frees );
+        allocations.print( "TlsfHeap::allocate" );
+        frees.print( "TlsfHeap::deallocate" );
+    }
+    return 0;
+}
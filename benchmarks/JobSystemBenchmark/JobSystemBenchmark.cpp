@@ -0,0 +1,94 @@
+#include <Core/JobSystem.hpp>
+#include <Core/Clock.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace cobalt::core;
+
+// Recursive fork/join; each level waits on its children, so this exercises
+// wait-while-helping and stealing
+static void fib( int n, std::atomic< long >& result )
+{
+    if( n < 2 )
+    {
+        result.fetch_add( n, std::memory_order_relaxed );
+        return;
+    }
+    JobCounter counter;
+    JobSystem::run( [n, &result]() { fib( n - 1, result ); }, &counter );
+    fib( n - 2, result );
+    JobSystem::wait( counter );
+}
+
+static double burn( int index, int work )
+{
+    double x = index;
+    for( int i = 0; i < work; ++i )
+    {
+        x = std::sqrt( x + i );
+    }
+    return x;
+}
+
+template< typename Function >
+static double milliseconds( Function function )
+{
+    int64_t start = Clock::nowNs();
+    function();
+    return ( Clock::nowNs() - start ) / 1e6;
+}
+
+int main( int argc, char* argv[] )
+{
+    JobSystem::Config config;
+    config.workerCount = argc > 1 ? static_cast< unsigned >( std::atoi( argv[ 1 ] ) ) : 0;
+
+    const int jobCount = 100000;
+    const int work = 200;
+    std::vector< double > results( jobCount );
+
+    double serialMs = milliseconds( [&]()
+    {
+        for( int i = 0; i < jobCount; ++i )
+        {
+            results[ i ] = burn( i, work );
+        }
+    } );
+
+    JobSystem::startup( config );
+    std::printf( "%u workers\n", JobSystem::workerCount() );
+
+    double emptyMs = milliseconds( [&]()
+    {
+        JobCounter counter;
+        for( int i = 0; i < jobCount; ++i )
+        {
+            JobSystem::run( []() {}, &counter );
+        }
+        JobSystem::wait( counter );
+    } );
+
+    double parallelMs = milliseconds( [&]()
+    {
+        JobCounter counter;
+        double* out = results.data();
+        for( int i = 0; i < jobCount; ++i )
+        {
+            JobSystem::run( [out, i, work]() { out[ i ] = burn( i, work ); }, &counter );
+        }
+        JobSystem::wait( counter );
+    } );
+
+    std::atomic< long > fibResult{ 0 };
+    double fibMs = milliseconds( [&]() { fib( 25, fibResult ); } );
+
+    JobSystem::shutdown();
+
+    std::printf( "%-28s %10.1f ns/job\n", "empty jobs", emptyMs * 1e6 / jobCount );
+    std::printf( "%-28s %10.2f ms serial %10.2f ms jobs %7.2fx\n", "independent jobs", serialMs, parallelMs, serialMs / parallelMs );
+    std::printf( "%-28s %10.2f ms (fib %ld)\n", "recursive fork/join fib(25)", fibMs, fibResult.load() );
+    return 0;
+}
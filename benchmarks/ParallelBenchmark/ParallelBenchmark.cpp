@@ -0,0 +1,89 @@
+#include <Core/Parallel.hpp>
+#include <Core/Clock.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace cobalt::core;
+
+// Prints a scaling table: each algorithm timed with 1 thread (the calling
+// one, no workers) up to N threads.
+// Usage: cobalt_parallel_benchmark [maxThreads] [elementCount]
+
+template< typename Function >
+static double bestMilliseconds( Function function )
+{
+    double best = 1e30;
+    for( int repeat = 0; repeat < 5; ++repeat )
+    {
+        int64_t start = Clock::nowNs();
+        function();
+        best = std::min( best, ( Clock::nowNs() - start ) / 1e6 );
+    }
+    return best;
+}
+
+int main( int argc, char* argv[] )
+{
+    unsigned maxThreads = argc > 1 ? static_cast< unsigned >( std::atoi( argv[ 1 ] ) ) : std::max( std::thread::hardware_concurrency(), 1u );
+    size_t count = argc > 2 ? static_cast< size_t >( std::atoll( argv[ 2 ] ) ) : 4000000;
+
+    std::vector< float > input( count );
+    uint32_t random = 12345;
+    for( float& value : input )
+    {
+        random = random * 1664525u + 1013904223u;
+        value = static_cast< float >( random >> 8 ) / 16777216.0f;
+    }
+    std::vector< float > output( count );
+    std::vector< float > sortable( count );
+
+    std::printf( "%zu elements\n", count );
+    std::printf( "%8s %12s %12s %12s %12s %12s\n", "threads", "for ms", "reduce ms", "scan ms", "sort ms", "partition ms" );
+
+    double checksum = 0.0;
+    for( unsigned threads = 1; threads <= maxThreads; ++threads )
+    {
+        if( threads > 1 )
+        {
+            JobSystem::Config config;
+            config.workerCount = threads - 1;
+            JobSystem::startup( config );
+        }
+
+        double forMs = bestMilliseconds( [&]()
+        {
+            parallelFor( 0, count, [&]( size_t i ) { output[ i ] = std::sqrt( input[ i ] ) * 0.5f + 1.0f; } );
+        } );
+        double reduceMs = bestMilliseconds( [&]()
+        {
+            checksum += parallelReduce( 0, count, 0.0,
+                [&]( double sum, size_t i ) { return sum + input[ i ]; },
+                []( double a, double b ) { return a + b; } );
+        } );
+        double scanMs = bestMilliseconds( [&]()
+        {
+            parallelScan( input.data(), output.data(), count, 0.0f, []( float a, float b ) { return a + b; } );
+        } );
+        double sortMs = bestMilliseconds( [&]()
+        {
+            sortable = input;
+            parallelSort( sortable.data(), sortable.data() + count );
+        } );
+        double partitionMs = bestMilliseconds( [&]()
+        {
+            sortable = input;
+            parallelPartition( sortable.data(), sortable.data() + count, []( float value ) { return value < 0.25f; } );
+        } );
+        checksum += output[ count / 2 ] + sortable[ count / 2 ];
+
+        std::printf( "%8u %12.2f %12.2f %12.2f %12.2f %12.2f\n", threads, forMs, reduceMs, scanMs, sortMs, partitionMs );
+
+        JobSystem::shutdown();
+    }
+    std::printf( "(checksum %g)\n", checksum );
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <Core/Clock.hpp>
+#include <Core/ObjectPool.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if !COBALT_NO_THREADS
+    #include <thread>
+#endif
+
+using namespace cobalt::core;
+
+// Churns objects the size of a small engine record through ObjectPool and
+// through new/delete and reports millions of create/destroy pairs per second.
+// "local": each thread replaces random objects in its own working set.
+// "cross-thread": objects are destroyed by a different thread than the one
+// that created them, as when a loader hands records to the main thread.
+// Usage: cobalt_pool_benchmark [maxThreads]
+
+struct Record
+{
+    float transform[ 12 ];
+    unsigned id = 0;
+    unsigned flags = 0;
+};
+
+static const size_t kWorkingSet = 4096;
+static const size_t kOperationsPerThread = 2000000;
+
+struct HeapAllocator
+{
+    Record* create( unsigned id ) { Record* record = new Record; record->id = id; return record; }
+    void destroy( Record* record ) { delete record; }
+};
+
+struct PoolAllocator
+{
+    ObjectPool< Record > pool;
+    Record* create( unsigned id ) { Record* record = pool.create(); record->id = id; return record; }
+    void destroy( Record* record ) { pool.destroy( record ); }
+};
+
+/// Runs `body( thread )` on `threadCount` threads and returns the seconds taken
+template< typename Body >
+static double timeThreads( unsigned threadCount, Body body )
+{
+    int64_t start = Clock::nowNs();
+#if COBALT_NO_THREADS
+    body( 0u );
+#else
+    std::vector< std::thread > threads;
+    for( unsigned t = 0; t < threadCount; ++t )
+    {
+        threads.emplace_back( [&body, t]() { body( t ); } );
+    }
+    for( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+#endif
+    return Clock::toSeconds( Clock::nowNs() - start );
+}
+
+template< typename Allocator >
+static double localChurn( Allocator& allocator, unsigned threadCount )
+{
+    double seconds = timeThreads( threadCount, [&allocator]( unsigned thread )
+    {
+        std::vector< Record* > live( kWorkingSet );
+        for( size_t i = 0; i < kWorkingSet; ++i )
+        {
+            live[ i ] = allocator.create( static_cast< unsigned >( i ) );
+        }
+        uint32_t random = 2463534242u + thread;
+        for( size_t i = 0; i < kOperationsPerThread; ++i )
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            Record*& slot = live[ random % kWorkingSet ];
+            allocator.destroy( slot );
+            slot = allocator.create( static_cast< unsigned >( i ) );
+        }
+        for( Record* record : live )
+        {
+            allocator.destroy( record );
+        }
+    } );
+    return threadCount * kOperationsPerThread / seconds / 1e6;
+}
+
+template< typename Allocator >
+static double crossThreadChurn( Allocator& allocator, unsigned threadCount )
+{
+    // Each round, thread t destroys what thread t - 1 created last round
+    const size_t rounds = kOperationsPerThread / kWorkingSet;
+    std::vector< std::vector< Record* > > sets( threadCount, std::vector< Record* >( kWorkingSet, nullptr ) );
+    double seconds = 0.0;
+    for( size_t round = 0; round < rounds; ++round )
+    {
+        seconds += timeThreads( threadCount, [&]( unsigned thread )
+        {
+            std::vector< Record* >& set = sets[ ( thread + round ) % threadCount ];
+            for( size_t i = 0; i < kWorkingSet; ++i )
+            {
+                allocator.destroy( set[ i ] );
+                set[ i ] = allocator.create( static_cast< unsigned >( i ) );
+            }
+        } );
+    }
+    for( std::vector< Record* >& set : sets )
+    {
+        for( Record* record : set )
+        {
+            allocator.destroy( record );
+        }
+    }
+    return threadCount * rounds * kWorkingSet / seconds / 1e6;
+}
+
+int main( int argc, char* argv[] )
+{
+#if COBALT_NO_THREADS
+    unsigned maxThreads = 1;
+#else
+    unsigned maxThreads = argc > 1 ? static_cast< unsigned >( std::atoi( argv[ 1 ] ) ) : std::thread::hardware_concurrency();
+#endif
+    if( maxThreads == 0 )
+    {
+        maxThreads = 1;
+    }
+
+    std::printf( "%-14s %8s %14s %14s\n", "churn", "threads", "new/delete M/s", "ObjectPool M/s" );
+    for( unsigned threads = 1; threads <= maxThreads; threads *= 2 )
+    {
+        HeapAllocator heap;
+        PoolAllocator pool;
+        double heapRate = localChurn( heap, threads );
+        double poolRate = localChurn( pool, threads );
+        std::printf( "%-14s %8u %14.1f %14.1f\n", "local", threads, heapRate, poolRate );
+    }
+    for( unsigned threads = 2; threads <= maxThreads; threads *= 2 )
+    {
+        HeapAllocator heap;
+        PoolAllocator pool;
+        double heapRate = crossThreadChurn( heap, threads );
+        double poolRate = crossThreadChurn( pool, threads );
+        FixedSizePool::Stats stats = pool.pool.stats();
+        std::printf( "%-14s %8u %14.1f %14.1f   (pool: %zu slabs, peak %zu of %zu blocks)\n", "cross-thread", threads,
+                     heapRate, poolRate, stats.slabCount, stats.peakUsed, stats.capacity );
+    }
+    return 0;
+}
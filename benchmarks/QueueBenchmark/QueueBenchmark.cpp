@@ -0,0 +1,221 @@
+#include <Core/Clock.hpp>
+#include <Core/MpmcQueue.hpp>
+#include <Core/MpscQueue.hpp>
+#include <Core/SpscQueue.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+#if !COBALT_NO_THREADS
+    #include <deque>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+#endif
+
+using namespace cobalt::core;
+
+// Moves kItems integers from producers to consumers through each queue and
+// reports millions of items per second.
+// Usage: cobalt_queue_benchmark [threadsPerSide]
+
+#if COBALT_NO_THREADS
+
+int main( int argc, char* argv[] )
+{
+    std::printf( "Built with COBALT_NO_THREADS; nothing to measure\n" );
+    return 0;
+}
+
+#else
+
+static const size_t kItems = 4000000;
+static const size_t kBatch = 32;
+
+class LockedQueue
+{
+public:
+    bool tryPush( size_t item )
+    {
+        std::lock_guard< std::mutex > lock( mMutex );
+        mItems.push_back( item );
+        return true;
+    }
+    bool tryPop( size_t& out )
+    {
+        std::lock_guard< std::mutex > lock( mMutex );
+        if( mItems.empty() )
+        {
+            return false;
+        }
+        out = mItems.front();
+        mItems.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mMutex;
+    std::deque< size_t > mItems;
+};
+
+struct Message : MpscNode
+{
+    size_t value = 0;
+};
+
+/// Runs `producers` threads calling push( i ) for their share of kItems and
+/// `consumers` threads calling pop( sum ) until everything has arrived
+template< typename Push, typename Pop >
+static double millionsPerSecond( unsigned producers, unsigned consumers, Push push, Pop pop )
+{
+    std::atomic< size_t > consumed{ 0 };
+    std::atomic< size_t > checksum{ 0 };
+    std::vector< std::thread > threads;
+    int64_t start = Clock::nowNs();
+    for( unsigned p = 0; p < producers; ++p )
+    {
+        threads.emplace_back( [=]()
+        {
+            for( size_t i = p; i < kItems; i += producers )
+            {
+                push( p, i );
+            }
+        } );
+    }
+    for( unsigned c = 0; c < consumers; ++c )
+    {
+        threads.emplace_back( [&]()
+        {
+            size_t sum = 0;
+            while( consumed.load( std::memory_order_relaxed ) < kItems )
+            {
+                size_t count = pop( sum );
+                if( count )
+                {
+                    consumed.fetch_add( count, std::memory_order_relaxed );
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            checksum.fetch_add( sum );
+        } );
+    }
+    for( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+    double seconds = Clock::toSeconds( Clock::nowNs() - start );
+    if( checksum.load() != kItems * ( kItems - 1 ) / 2 )
+    {
+        std::printf( "checksum mismatch!\n" );
+    }
+    return kItems / seconds / 1e6;
+}
+
+static void pushOrYield( bool isPushed )
+{
+    if( !isPushed )
+    {
+        std::this_thread::yield();
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    unsigned threads = argc > 1 ? static_cast< unsigned >( std::atoi( argv[ 1 ] ) ) : 4;
+    std::printf( "%-34s %10s %10s\n", "queue", "threads", "M items/s" );
+
+    {
+        SpscQueue< size_t > queue( 4096 );
+        double rate = millionsPerSecond( 1, 1,
+            [&]( unsigned, size_t i ) { while( !queue.tryPush( i ) ) { std::this_thread::yield(); } },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "SpscQueue", "1:1", rate );
+    }
+    {
+        SpscQueue< size_t > queue( 4096 );
+        double rate = millionsPerSecond( 1, 1,
+            [&]( unsigned, size_t i )
+            {
+                // Producer batches locally; flush whenever the batch fills
+                static thread_local size_t batch[ kBatch ];
+                static thread_local size_t count = 0;
+                batch[ count++ ] = i;
+                if( count == kBatch || i + 1 == kItems )
+                {
+                    size_t pushed = 0;
+                    while( pushed < count )
+                    {
+                        size_t n = queue.pushBatch( batch + pushed, count - pushed );
+                        pushed += n;
+                        pushOrYield( n > 0 );
+                    }
+                    count = 0;
+                }
+            },
+            [&]( size_t& sum )
+            {
+                size_t items[ kBatch ];
+                size_t count = queue.popBatch( items, kBatch );
+                for( size_t i = 0; i < count; ++i )
+                {
+                    sum += items[ i ];
+                }
+                return count;
+            } );
+        std::printf( "%-34s %10s %10.1f\n", "SpscQueue, batches of 32", "1:1", rate );
+    }
+    {
+        UnboundedSpscQueue< size_t > queue;
+        double rate = millionsPerSecond( 1, 1,
+            [&]( unsigned, size_t i ) { queue.push( i ); },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "UnboundedSpscQueue", "1:1", rate );
+    }
+    {
+        LockedQueue queue;
+        double rate = millionsPerSecond( 1, 1,
+            [&]( unsigned, size_t i ) { queue.tryPush( i ); },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "mutex + std::deque", "1:1", rate );
+    }
+
+    char label[ 32 ];
+    std::snprintf( label, sizeof( label ), "%u:1", threads );
+    {
+        std::vector< Message > messages( kItems );
+        MpscQueue< Message > queue;
+        double rate = millionsPerSecond( threads, 1,
+            [&]( unsigned, size_t i ) { messages[ i ].value = i; queue.push( &messages[ i ] ); },
+            [&]( size_t& sum ) { Message* message = queue.pop(); if( !message ) { return size_t( 0 ); } sum += message->value; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "MpscQueue", label, rate );
+    }
+    {
+        LockedQueue queue;
+        double rate = millionsPerSecond( threads, 1,
+            [&]( unsigned, size_t i ) { queue.tryPush( i ); },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "mutex + std::deque", label, rate );
+    }
+
+    std::snprintf( label, sizeof( label ), "%u:%u", threads, threads );
+    {
+        MpmcQueue< size_t > queue( 4096 );
+        double rate = millionsPerSecond( threads, threads,
+            [&]( unsigned, size_t i ) { while( !queue.tryPush( i ) ) { std::this_thread::yield(); } },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "MpmcQueue", label, rate );
+    }
+    {
+        LockedQueue queue;
+        double rate = millionsPerSecond( threads, threads,
+            [&]( unsigned, size_t i ) { queue.tryPush( i ); },
+            [&]( size_t& sum ) { size_t item; if( !queue.tryPop( item ) ) { return size_t( 0 ); } sum += item; return size_t( 1 ); } );
+        std::printf( "%-34s %10s %10.1f\n", "mutex + std::deque", label, rate );
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include <Core/Clock.hpp>
+#include <Core/VirtualMemory.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined( __linux__ )
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+using namespace cobalt::core;
+
+// Dependent random reads across a large region, the access pattern of a big
+// heap or arena, on normal, transparent huge and explicit huge pages.  Reports
+// nanoseconds per read and, where perf events are permitted, data TLB misses
+// per read.
+// Usage: cobalt_virtual_memory_benchmark [MiB]
+
+static const size_t kReads = 20000000;
+
+// Keeps the reads from being optimized away
+static volatile uint64_t sSink;
+
+/// Counts data TLB read misses for the calling thread, if the kernel lets us
+class TlbMissCounter
+{
+public:
+    TlbMissCounter()
+    {
+#if defined( __linux__ )
+        perf_event_attr attributes;
+        std::memset( &attributes, 0, sizeof( attributes ) );
+        attributes.size = sizeof( attributes );
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        mFile = static_cast< int >( syscall( __NR_perf_event_open, &attributes, 0, -1, -1, 0 ) );
+#endif
+    }
+
+    ~TlbMissCounter()
+    {
+#if defined( __linux__ )
+        if( mFile >= 0 )
+        {
+            close( mFile );
+        }
+#endif
+    }
+
+    bool isAvailable() const { return mFile >= 0; }
+
+    void start()
+    {
+#if defined( __linux__ )
+        if( mFile >= 0 )
+        {
+            ioctl( mFile, PERF_EVENT_IOC_RESET, 0 );
+            ioctl( mFile, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+#endif
+    }
+
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+#if defined( __linux__ )
+        if( mFile >= 0 )
+        {
+            ioctl( mFile, PERF_EVENT_IOC_DISABLE, 0 );
+            if( read( mFile, &count, sizeof( count ) ) != sizeof( count ) )
+            {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    int mFile = -1;
+};
+
+static const char* pagesName( VirtualMemory::Pages pages )
+{
+    switch( pages )
+    {
+        case VirtualMemory::Pages::Normal: return "normal";
+        case VirtualMemory::Pages::TransparentHuge: return "transparent huge";
+        case VirtualMemory::Pages::ExplicitHuge: return "explicit huge";
+    }
+    return "?";
+}
+
+static void measure( size_t bytes, VirtualMemory::Pages requested, TlbMissCounter& counter )
+{
+    VirtualMemory::Region region = VirtualMemory::allocate( bytes, requested );
+    if( !region.isValid() )
+    {
+        std::printf( "%-18s couldn't allocate\n", pagesName( requested ) );
+        return;
+    }
+
+    // Fault everything in, and give each word a value so reads depend on
+    // the previous one and can't be overlapped
+    uint64_t* words = reinterpret_cast< uint64_t* >( region.base );
+    size_t count = region.size / sizeof( uint64_t );
+    for( size_t i = 0; i < count; ++i )
+    {
+        words[ i ] = i * 2654435761u;
+    }
+
+    counter.start();
+    int64_t start = Clock::nowNs();
+    uint64_t position = 0;
+    for( size_t i = 0; i < kReads; ++i )
+    {
+        // High bits of the LCG; its low bits repeat with short periods
+        position = position * 6364136223846793005ull + 1442695040888963407ull + words[ ( position >> 24 ) % count ];
+    }
+    double seconds = Clock::toSeconds( Clock::nowNs() - start );
+    uint64_t misses = counter.stop();
+    sSink = position;
+
+    char missText[ 32 ] = "n/a";
+    if( counter.isAvailable() )
+    {
+        std::snprintf( missText, sizeof( missText ), "%.3f", double( misses ) / kReads );
+    }
+    std::printf( "%-18s %-18s %12.1f %16s\n", pagesName( requested ), pagesName( region.pages ),
+                 seconds * 1e9 / kReads, missText );
+    VirtualMemory::release( region );
+}
+
+int main( int argc, char* argv[] )
+{
+    size_t mebibytes = argc > 1 ? static_cast< size_t >( std::atoi( argv[ 1 ] ) ) : 1024;
+    size_t bytes = mebibytes * 1024 * 1024;
+    TlbMissCounter counter;
+
+    std::printf( "%zu MiB region, %zu dependent random reads; page size %zu, huge page size %zu\n",
+                 mebibytes, kReads, VirtualMemory::pageSize(), VirtualMemory::hugePageSize() );
+    std::printf( "%-18s %-18s %12s %16s\n", "requested", "got", "ns/read", "dTLB misses/read" );
+    measure( bytes, VirtualMemory::Pages::Normal, counter );
+    measure( bytes, VirtualMemory::Pages::TransparentHuge, counter );
+    measure( bytes, VirtualMemory::Pages::ExplicitHuge, counter );
+    return 0;
+}
@@ -7,8 +7,21 @@ enable_language(CXX)
 
 set( CMAKE_MODULE_PATH "./cmake" "${CMAKE_SOURCE_DIR}/cmake" ${CMAKE_MODULE_PATH} )
 
+# Must match the COBALT_LOG_LEVEL_* defines in Core/Log.hpp
+set( COBALT_LOG_LEVEL_NAMES DEBUG INFO WARN ERROR FATAL OFF )
+
 macro( cobalt_use_modern_cpp )
     include(CheckCXXCompilerFlag)
+    # Prefer C++20 (coroutines, see Core/Task.hpp), then C++17 (e.g., floating
+    # point std::to_chars in Core/Format.cpp)
+    CHECK_CXX_COMPILER_FLAG("-std=c++20" COMPILER_SUPPORTS_CXX20)
+    if(COMPILER_SUPPORTS_CXX20)
+        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++20")
+    else(COMPILER_SUPPORTS_CXX20)
+    CHECK_CXX_COMPILER_FLAG("-std=c++17" COMPILER_SUPPORTS_CXX17)
+    if(COMPILER_SUPPORTS_CXX17)
+        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++17")
+    else(COMPILER_SUPPORTS_CXX17)
     CHECK_CXX_COMPILER_FLAG("-std=c++1y" COMPILER_SUPPORTS_CXX1Y)
     if(COMPILER_SUPPORTS_CXX1Y)
         set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++1y")
@@ -25,8 +38,10 @@ macro( cobalt_use_modern_cpp )
             endif(COMPILER_SUPPORTS_CXX0X)
         endif(COMPILER_SUPPORTS_CXX11)
     endif(COMPILER_SUPPORTS_CXX1Y)
+    endif(COMPILER_SUPPORTS_CXX17)
+    endif(COMPILER_SUPPORTS_CXX20)
     if( APPLE )
-        set(CMAKE_XCODE_ATTRIBUTE_CLANG_CXX_LANGUAGE_STANDARD "c++1y" )
+        set(CMAKE_XCODE_ATTRIBUTE_CLANG_CXX_LANGUAGE_STANDARD "c++20" )
         set(CMAKE_XCODE_ATTRIBUTE_CLANG_CXX_LIBRARY "libc++")
     endif( APPLE )
 endmacro()
@@ -49,6 +64,48 @@ macro( cobalt_set_threading_support )
     endif()
 endmacro()
 
+macro( cobalt_set_headless )
+    if( COBALT_HEADLESS )
+        add_definitions( -DCOBALT_HEADLESS=1 )
+    else()
+        add_definitions( -DCOBALT_HEADLESS=0 )
+    endif()
+    # Headless without an offscreen context needs no GL stack at all, so it
+    # configures and builds on machines without GLFW, GLEW or OpenGL
+    if( COBALT_HEADLESS AND NOT COBALT_OFFSCREEN_GL )
+        set( COBALT_NO_GL ON )
+        add_definitions( -DCOBALT_NO_GL=1 )
+    else()
+        set( COBALT_NO_GL OFF )
+        add_definitions( -DCOBALT_NO_GL=0 )
+    endif()
+endmacro()
+
+macro( cobalt_set_profiler )
+    if( COBALT_PROFILER )
+        add_definitions( -DCOBALT_PROFILER=1 )
+    else()
+        add_definitions( -DCOBALT_PROFILER=0 )
+    endif()
+endmacro()
+
+macro( cobalt_set_memory_tracking )
+    if( COBALT_MEMORY_TRACKING )
+        add_definitions( -DCOBALT_MEMORY_TRACKING=1 )
+    else()
+        add_definitions( -DCOBALT_MEMORY_TRACKING=0 )
+    endif()
+endmacro()
+
+macro( cobalt_set_min_log_level )
+    string( TOUPPER "${COBALT_MIN_LOG_LEVEL}" COBALT_MIN_LOG_LEVEL_UPPER )
+    list( FIND COBALT_LOG_LEVEL_NAMES "${COBALT_MIN_LOG_LEVEL_UPPER}" COBALT_MIN_LOG_LEVEL_INDEX )
+    if( COBALT_MIN_LOG_LEVEL_INDEX EQUAL -1 )
+        message( FATAL_ERROR "Unknown COBALT_MIN_LOG_LEVEL '${COBALT_MIN_LOG_LEVEL}'" )
+    endif()
+    add_definitions( -DCOBALT_MIN_LOG_LEVEL=COBALT_LOG_LEVEL_${COBALT_MIN_LOG_LEVEL_UPPER} )
+endmacro()
+
 macro( cobalt_add_shaders_to_project SHADER_DIR )
     file(GLOB VERT_SHADER_FILES RELATIVE 
       ${SHADER_DIR} "${SHADER_DIR}/*.vert" )
@@ -78,6 +135,10 @@ macro( cobalt_compiler_settings )
     cobalt_use_modern_cpp()
     cobalt_set_extensions()
     cobalt_set_threading_support()
+    cobalt_set_headless()
+    cobalt_set_profiler()
+    cobalt_set_memory_tracking()
+    cobalt_set_min_log_level()
 
     if( COBALT_EMSCRIPTEN )
         add_definitions( -DCOBALT_EMSCRIPTEN )
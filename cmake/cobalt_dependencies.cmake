@@ -7,6 +7,8 @@ macro( cobalt_include_glm )
     add_definitions( -DGLM_FORCE_RADIANS )
     if( COBALT_EMSCRIPTEN )
         #include_directories( "./ext/glm" )
+    elseif( COBALT_NO_GL )
+        # Only graphics code uses GLM
     else()
         # GLM -- on Windows: depends on env var: GLM_ROOT_DIR
         find_package(glm REQUIRED)
@@ -25,6 +27,8 @@ endmacro()
 macro( cobalt_include_glew )
   if( COBALT_EMSCRIPTEN )
     # Nothing to do?
+  elseif( COBALT_NO_GL )
+    # Headless without an offscreen context
   else()
       find_package(glew REQUIRED)
       if( GLEW_FOUND )
@@ -49,6 +53,8 @@ macro( cobalt_include_glfw )
     #   https://github.com/kripken/emscripten/blob/master/src/settings.js
     #set( COBALT_GLFW_LIBRARIES "-s USE_GLFW=3 -s USE_WEBGL2=1" )
     set( COBALT_GLFW_LIBRARIES "-s USE_GLFW=3 -s LEGACY_GL_EMULATION=1" )
+  elseif( COBALT_NO_GL )
+    # Headless without an offscreen context
   else()
     # TODO -- what about windows?  should GLFW be included in ext?
 
@@ -76,6 +82,8 @@ endmacro()
 macro( cobalt_include_opengl )
     if( COBALT_EMSCRIPTEN )
         # Nothing to do?
+    elseif( COBALT_NO_GL )
+        # Headless without an offscreen context
     else()
         find_package( OpenGL REQUIRED )
         include_directories( ${OPENGL_INCLUDE_DIR} )
@@ -104,5 +112,31 @@ macro( cobalt_link_external_libraries EXECUTABLE_NAME )
     target_link_libraries( ${EXECUTABLE_NAME} ${COBALT_GLEW_LIBRARIES} )
     target_link_libraries( ${EXECUTABLE_NAME} ${COBALT_OPENGL_LIBRARIES} )
     target_link_libraries( ${EXECUTABLE_NAME} ${COBALT_GLFW_LIBRARIES} )
+    target_link_libraries( ${EXECUTABLE_NAME} ${COBALT_THREAD_LIBRARIES} )
+    target_link_libraries( ${EXECUTABLE_NAME} ${COBALT_TBB_LIBRARIES} )
 endmacro()
 
+
+macro( cobalt_include_threads )
+    if( NOT COBALT_NO_THREADS )
+        find_package( Threads REQUIRED )
+        set( COBALT_THREAD_LIBRARIES ${CMAKE_THREAD_LIBS_INIT} )
+    endif()
+endmacro()
+
+macro( cobalt_include_tbb )
+    set( COBALT_TBB_LIBRARIES "" )
+    if( COBALT_USE_TBB AND NOT COBALT_NO_THREADS )
+        find_package( TBB )
+        if( TBB_FOUND )
+            include_directories( ${TBB_INCLUDE_DIRS} )
+            set( COBALT_TBB_LIBRARIES ${TBB_LIBRARIES} )
+            add_definitions( -DCOBALT_USE_TBB=1 )
+        else()
+            message( WARNING "COBALT_USE_TBB is ON but TBB was not found; using the built-in job scheduler" )
+            add_definitions( -DCOBALT_USE_TBB=0 )
+        endif()
+    else()
+        add_definitions( -DCOBALT_USE_TBB=0 )
+    endif()
+endmacro()
@@ -2,7 +2,15 @@
 # Options meant to be user-configurable
 #
 
-set( COBALT_BUILD_EXAMPLES  ON  CACHE BOOL "If ON, then examples will be built." )
-set( COBALT_NO_THREADS      OFF CACHE BOOL "If ON, then no threading will be used (e.g., for emscripten)" )
-
+set( COBALT_BUILD_EXAMPLES   ON  CACHE BOOL "If ON, then examples will be built." )
+set( COBALT_BUILD_BENCHMARKS ON  CACHE BOOL "If ON, then micro-benchmarks will be built." )
+set( COBALT_BUILD_TOOLS      ON  CACHE BOOL "If ON, then command line tools (e.g., log decoder) will be built." )
+set( COBALT_NO_THREADS       OFF CACHE BOOL "If ON, then no threading will be used (e.g., for emscripten)" )
+set( COBALT_HEADLESS         OFF CACHE BOOL "If ON, then applications run without a window or GL context (servers, CI, benchmarks)" )
+set( COBALT_OFFSCREEN_GL     OFF CACHE BOOL "If ON with COBALT_HEADLESS, then GLFW, GLEW and OpenGL are still required, for WindowConfiguration::hasOffscreenContext" )
+set( COBALT_PROFILER         OFF CACHE BOOL "If ON, then cobalt_profile_zone instrumentation is compiled in (see Core/Profiler.hpp)" )
+set( COBALT_MEMORY_TRACKING  ON  CACHE BOOL "If ON, then allocators report to Core/MemoryTracker.hpp; OFF compiles the tracking out" )
+set( COBALT_USE_TBB          OFF CACHE BOOL "If ON and TBB is found, then the job system runs on TBB's scheduler (see Core/JobSystem.hpp)" )
 
+set( COBALT_MIN_LOG_LEVEL    Debug CACHE STRING "cobalt_log_* statements below this level are compiled out (Debug, Info, Warn, Error, Fatal, Off)" )
+set_property( CACHE COBALT_MIN_LOG_LEVEL PROPERTY STRINGS Debug Info Warn Error Fatal Off )
@@ -4,6 +4,6 @@ using namespace cobalt::core;
 
 int main( int argc, char* argv[] )
 {
-    Log::debug( "Hello %s!", "World" );
+    cobalt_log_debug( "Hello %s!", "World" );
     return 0;
 }
@@ -33,7 +33,7 @@ void TrivialApplication::startup()
 void TrivialApplication::update( double dt )
 {
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-    Log::info( "%2.4g seconds since last onUpdate()", dt );
+    cobalt_log_throttled_debug( Log::Frame, 1.0, "%2.4g seconds since last onUpdate()", dt );
 }
 
 void TrivialApplication::shutdown()
@@ -49,9 +49,12 @@ void TrivialApplication::shutdown()
 
 int main( int argc, char* argv[] )
 {
-    Log::info( "Application initializing." );
+    // update() logs every frame, so keep stdout off the frame thread
+    Log::startAsync();
+    cobalt_log_info( "Application initializing." );
     TrivialApplication app;
     launchCobaltApplication( &app );
+    Log::stopAsync();
     return 0;
 }
 
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <Core/Clock.hpp>
+#include <Core/Log.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#define cobalt_log_deferred_at( levelIndex, level, ... ) do{ COBALT_CHECK_FORMAT( __VA_ARGS__ ); if( COBALT_MIN_LOG_LEVEL <= (levelIndex) && cobalt::core::Log::isEnabled( level ) ) { cobalt::core::BinaryLog::log( level, __VA_ARGS__ ); } } while(false)
+#define cobalt_log_deferred_debug( ... ) cobalt_log_deferred_at( COBALT_LOG_LEVEL_DEBUG, cobalt::core::Log::Level::Debug, __VA_ARGS__ )
+#define cobalt_log_deferred_info( ... )  cobalt_log_deferred_at( COBALT_LOG_LEVEL_INFO,  cobalt::core::Log::Level::Info,  __VA_ARGS__ )
+#define cobalt_log_deferred_warn( ... )  cobalt_log_deferred_at( COBALT_LOG_LEVEL_WARN,  cobalt::core::Log::Level::Warn,  __VA_ARGS__ )
+#define cobalt_log_deferred_error( ... ) cobalt_log_deferred_at( COBALT_LOG_LEVEL_ERROR, cobalt::core::Log::Level::Error, __VA_ARGS__ )
+
+namespace cobalt { namespace core {
+
+/// Deferred binary logging.
+/// The calling thread only records the format string pointer, a timestamp and
+/// the raw bytes of the arguments; formatting (cobalt::core::format) happens
+/// later on the Log drain thread, or offline with cobalt_log_decoder when a
+/// binary file is being written.  Only worthwhile together with Log::startAsync();
+/// in synchronous mode records are formatted immediately.  While the
+/// FlightRecorder is open, records are also copied into it, still encoded, on
+/// the calling thread, so they survive a crash before the drain thread gets
+/// to them; cobalt_flight_recorder_dump decodes them.
+///
+/// The format string must outlive the process' logging (i.e., be a literal).
+/// Supported arguments are integers, enums, floating point, C strings,
+/// std::string and pointers.  Strings are copied, so temporaries are fine.
+///
+/// Example:
+///     cobalt_log_deferred_debug( "particles=%d dt=%.3f", count, dt );
+class BinaryLog
+{
+public:
+    /// Signed32 marks signed operands of int width or less, stored as 64 bits
+    /// like Signed, so negative values print at their width with %x and %u
+    enum class ArgType : uint8_t { Signed, Unsigned, Double, String, Pointer, Signed32 };
+
+    /// Size limit of one encoded record; long strings are truncated to fit.
+    static const size_t kMaxRecordSize = 512;
+
+    /// Event header as stored in the ring and in binary log files.
+    struct EventHeader
+    {
+        uint64_t format;     // format string address, used as its id
+        int64_t timestampNs;
+        uint8_t level;
+        uint8_t argCount;
+        uint16_t argBytes;
+        uint32_t reserved = 0; // makes the padding explicit, so no stack garbage reaches the files
+    };
+
+    static_assert( sizeof( EventHeader ) == 24, "EventHeader must have no hidden padding" );
+
+    template< typename... Args >
+    static void log( Log::Level level, const char* format, const Args&... args );
+
+    /// While open, deferred records are written in binary to `path` instead of
+    /// being formatted.  Decode with cobalt_log_decoder.
+    static bool openFile( const char* path );
+    static void closeFile();
+
+    /// Format an encoded argument block with cobalt::core::format.  Returns the
+    /// length written (excluding the terminator), truncated to outSize - 1.
+    static size_t format( char* out, size_t outSize, const char* format,
+                          const char* args, size_t argBytes, size_t argCount );
+
+    /// Called by the Log drainer for each deferred record.
+    static void drain( const char* record, size_t size, std::FILE* textOutput );
+
+    /// Binary file layout: kFileMagic, then a sequence of records each starting
+    /// with a RecordTag byte.  A format record (uint64 id, uint32 length, bytes)
+    /// precedes the first event that uses that format.  An event record is an
+    /// EventHeader followed by argBytes of encoded arguments.
+    static const char kFileMagic[ 8 ];
+    enum RecordTag : uint8_t { FormatRecord = 'F', EventRecord = 'E' };
+
+private:
+    struct Encoder
+    {
+        char* cursor;
+        char* end;
+        uint8_t count;
+
+        void put( ArgType type, const void* bytes, size_t size )
+        {
+            if( cursor + 1 + size > end )
+            {
+                return;
+            }
+            *cursor++ = static_cast< char >( type );
+            std::memcpy( cursor, bytes, size );
+            cursor += size;
+            ++count;
+        }
+
+        void putString( const char* str, size_t length )
+        {
+            if( cursor + 1 + sizeof( uint16_t ) > end )
+            {
+                return;
+            }
+            size_t room = static_cast< size_t >( end - cursor ) - 1 - sizeof( uint16_t );
+            uint16_t stored = static_cast< uint16_t >( length < room ? length : room );
+            *cursor++ = static_cast< char >( ArgType::String );
+            std::memcpy( cursor, &stored, sizeof( stored ) );
+            cursor += sizeof( stored );
+            std::memcpy( cursor, str, stored );
+            cursor += stored;
+            ++count;
+        }
+    };
+
+    template< typename T >
+    static typename std::enable_if< std::is_integral< T >::value && std::is_signed< T >::value >::type
+    encode( Encoder& e, T value ) { int64_t v = value; e.put( sizeof( T ) <= sizeof( int32_t ) ? ArgType::Signed32 : ArgType::Signed, &v, sizeof( v ) ); }
+
+    template< typename T >
+    static typename std::enable_if< std::is_integral< T >::value && !std::is_signed< T >::value >::type
+    encode( Encoder& e, T value ) { uint64_t v = value; e.put( ArgType::Unsigned, &v, sizeof( v ) ); }
+
+    template< typename T >
+    static typename std::enable_if< std::is_enum< T >::value >::type
+    encode( Encoder& e, T value ) { encode( e, static_cast< typename std::underlying_type< T >::type >( value ) ); }
+
+    template< typename T >
+    static typename std::enable_if< std::is_floating_point< T >::value >::type
+    encode( Encoder& e, T value ) { double v = value; e.put( ArgType::Double, &v, sizeof( v ) ); }
+
+    static void encode( Encoder& e, const char* str ) { str ? e.putString( str, std::strlen( str ) ) : e.putString( "(null)", 6 ); }
+    static void encode( Encoder& e, char* str ) { encode( e, static_cast< const char* >( str ) ); }
+    static void encode( Encoder& e, const std::string& str ) { e.putString( str.data(), str.size() ); }
+
+    template< typename T >
+    static void encode( Encoder& e, T* ptr ) { uint64_t v = reinterpret_cast< uintptr_t >( ptr ); e.put( ArgType::Pointer, &v, sizeof( v ) ); }
+
+    static void encodeAll( Encoder& ) {}
+
+    template< typename First, typename... Rest >
+    static void encodeAll( Encoder& e, const First& first, const Rest&... rest )
+    {
+        encode( e, first );
+        encodeAll( e, rest... );
+    }
+
+    static void commit( const char* record, size_t size );
+};
+
+template< typename... Args >
+void BinaryLog::log( Log::Level level, const char* format, const Args&... args )
+{
+    char record[ kMaxRecordSize ];
+    EventHeader header;
+    header.format = reinterpret_cast< uintptr_t >( format );
+    header.timestampNs = Clock::nowNs();
+    header.level = static_cast< uint8_t >( level );
+
+    Encoder encoder{ record + sizeof( header ), record + sizeof( record ), 0 };
+    encodeAll( encoder, args... );
+
+    header.argCount = encoder.count;
+    header.argBytes = static_cast< uint16_t >( encoder.cursor - ( record + sizeof( header ) ) );
+    std::memcpy( record, &header, sizeof( header ) );
+    commit( record, static_cast< size_t >( encoder.cursor - record ) );
+}
+
+} }
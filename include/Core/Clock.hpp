@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cobalt { namespace core {
+
+/// Monotonic high-resolution clock in integer nanoseconds.
+/// On x86 with an invariant TSC, reading the clock is a single rdtsc scaled
+/// by a rate calibrated against CLOCK_MONOTONIC when the library is loaded.
+/// Elsewhere it is clock_gettime( CLOCK_MONOTONIC ), or std::chrono's
+/// steady_clock where that doesn't exist.  Needs no initialization, so it is
+/// usable before the window (or anything else) exists.
+///
+/// Example:
+///     int64_t start = Clock::nowNs();
+///     ...
+///     double seconds = Clock::toSeconds( Clock::nowNs() - start );
+class Clock
+{
+public:
+    /// Nanoseconds since an arbitrary, fixed point in the past
+    static int64_t nowNs();
+
+    static double toSeconds( int64_t ns ) { return ns * 1e-9; }
+    static int64_t fromSeconds( double seconds ) { return static_cast< int64_t >( seconds * 1e9 ); }
+
+    /// True if nowNs() reads the TSC rather than calling into the OS
+    static bool isTscBased() { return sIsTscBased; }
+    /// Calibrated TSC rate, 0 when not TSC based
+    static double tscTicksPerSecond() { return sIsTscBased ? 1e9 / sNsPerTick : 0.0; }
+
+private:
+    static void calibrate();
+    static int64_t osNowNs();
+
+    // Set once during static initialization; until then nowNs() uses the OS
+    // clock, which the TSC timeline is anchored to so there is no jump
+    static bool sIsTscBased;
+    static double sNsPerTick;
+    static uint64_t sBaseTicks;
+    static int64_t sBaseNs;
+
+    friend struct ClockCalibration;
+};
+
+} }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+    #include <immintrin.h>
+    #define COBALT_CPU_RELAX() _mm_pause()
+#elif defined( __aarch64__ ) || defined( __arm__ )
+    #define COBALT_CPU_RELAX() __asm__ __volatile__( "yield" )
+#else
+    #define COBALT_CPU_RELAX() do{} while(false)
+#endif
+
+namespace cobalt { namespace core {
+
+/// Size to pad or align shared data to so that independently written fields
+/// don't false-share a cache line
+static const size_t kCacheLineSize = 64;
+
+/// Hint to the CPU that we're in a spin-wait loop
+inline void cpuRelax()
+{
+    COBALT_CPU_RELAX();
+}
+
+} }
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace cobalt { namespace core {
+
+/// Two copies of a frame's state: one being written by the simulation and
+/// one, the last published, being read by rendering.  Lets update() and
+/// render() run concurrently (see WindowConfiguration::isPipelined) without
+/// locks; publish() must be called while neither side is using it, which is
+/// what Application::swapFrameState() is for.
+///
+/// Example:
+///     DoubleBuffered< Particles > mParticles;
+///     void update( double dt ) override   { simulate( mParticles.write(), dt ); }
+///     void swapFrameState() override      { mParticles.publish(); }
+///     void render( double alpha ) override { draw( mParticles.read() ); }
+template< typename T >
+class DoubleBuffered
+{
+public:
+    DoubleBuffered() = default;
+    explicit DoubleBuffered( const T& initial ) : mBuffers{ initial, initial } {}
+
+    T& write() { return mBuffers[ mWriteIndex ]; }
+    const T& read() const { return mBuffers[ mWriteIndex ^ 1 ]; }
+
+    /// Make the written state readable; the next frame is simulated starting
+    /// from a copy of it
+    void publish()
+    {
+        mWriteIndex ^= 1;
+        mBuffers[ mWriteIndex ] = mBuffers[ mWriteIndex ^ 1 ];
+    }
+
+private:
+    T mBuffers[ 2 ];
+    unsigned mWriteIndex = 0;
+};
+
+} }
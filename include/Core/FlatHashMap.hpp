@@ -0,0 +1,846 @@
+#pragma once
+
+#include <Core/Hash.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Define as 0 to use the portable group matching everywhere
+#if !defined( COBALT_FLAT_HASH_SSE2 )
+    #if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+        #define COBALT_FLAT_HASH_SSE2 1
+    #else
+        #define COBALT_FLAT_HASH_SSE2 0
+    #endif
+#endif
+
+#if COBALT_FLAT_HASH_SSE2
+    #include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace cobalt { namespace core {
+
+namespace detail {
+
+    /// One byte per slot: kEmpty, kDeleted, or for full slots the low 7 bits
+    /// of the key's hash, so most mismatches never touch the slot itself
+    typedef int8_t Control;
+    static const Control kEmpty = -128;
+    static const Control kDeleted = -2;
+
+    inline unsigned lowestSetBit( uint64_t value )
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+    #if defined( _M_X64 )
+        _BitScanForward64( &index, value );
+    #else
+        if( !_BitScanForward( &index, static_cast< unsigned long >( value ) ) )
+        {
+            _BitScanForward( &index, static_cast< unsigned long >( value >> 32 ) );
+            index += 32;
+        }
+    #endif
+        return static_cast< unsigned >( index );
+#else
+        return static_cast< unsigned >( __builtin_ctzll( value ) );
+#endif
+    }
+
+    /// Slots of a group that matched, lowest first
+    template< typename Bits, unsigned Shift >
+    class BitMask
+    {
+    public:
+        explicit BitMask( Bits bits ) : mBits( bits ) {}
+
+        bool any() const { return mBits != 0; }
+        unsigned lowest() const { return lowestSetBit( mBits ) >> Shift; }
+        void removeLowest() { mBits &= mBits - 1; }
+
+    private:
+        Bits mBits;
+    };
+
+#if COBALT_FLAT_HASH_SSE2
+    /// 16 control bytes compared at once
+    class Group
+    {
+    public:
+        static const size_t kWidth = 16;
+        typedef BitMask< uint32_t, 0 > Mask;
+
+        explicit Group( const Control* controls ) : mControls( _mm_loadu_si128( reinterpret_cast< const __m128i* >( controls ) ) ) {}
+
+        Mask match( Control h2 ) const { return Mask( static_cast< uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( h2 ), mControls ) ) ) ); }
+        Mask matchEmpty() const { return match( kEmpty ); }
+        /// Empty or deleted: the only negative control values
+        Mask matchFree() const { return Mask( static_cast< uint32_t >( _mm_movemask_epi8( mControls ) ) ); }
+
+    private:
+        __m128i mControls;
+    };
+#else
+    /// 8 control bytes compared at once in a 64-bit word, for targets
+    /// without SSE2 such as Emscripten.  Assumes a little-endian load.
+    class Group
+    {
+    public:
+        static const size_t kWidth = 8;
+        typedef BitMask< uint64_t, 3 > Mask;
+
+        explicit Group( const Control* controls ) { std::memcpy( &mControls, controls, sizeof( mControls ) ); }
+
+        Mask match( Control h2 ) const
+        {
+            // Flags the zero bytes of x.  The borrow can also flag the byte
+            // after a true match, but only if it holds a full slot, whose
+            // key comparison then fails.
+            uint64_t x = mControls ^ ( kLowBits * static_cast< uint8_t >( h2 ) );
+            return Mask( ( x - kLowBits ) & ~x & kHighBits );
+        }
+        /// kEmpty is the only value with the high bit set and bit 1 clear
+        Mask matchEmpty() const { return Mask( mControls & ( ~mControls << 6 ) & kHighBits ); }
+        Mask matchFree() const { return Mask( mControls & kHighBits ); }
+
+    private:
+        static const uint64_t kLowBits = 0x0101010101010101ull;
+        static const uint64_t kHighBits = 0x8080808080808080ull;
+
+        uint64_t mControls;
+    };
+#endif
+
+    template< typename... >
+    struct MakeVoid { typedef void type; };
+
+    template< typename HashFn, typename Equal, typename = void >
+    struct IsTransparent : std::false_type {};
+
+    template< typename HashFn, typename Equal >
+    struct IsTransparent< HashFn, Equal, typename MakeVoid< typename HashFn::is_transparent, typename Equal::is_transparent >::type > : std::true_type {};
+
+    /// The type lookups take: whatever the caller passes when the hash and
+    /// equality are transparent, the key type otherwise
+    template< bool isTransparent >
+    struct KeyArg
+    {
+        template< typename Lookup, typename Key >
+        using type = Lookup;
+    };
+
+    template<>
+    struct KeyArg< false >
+    {
+        template< typename Lookup, typename Key >
+        using type = Key;
+    };
+
+    template< typename K, typename V >
+    struct MapPolicy
+    {
+        typedef K key_type;
+        typedef std::pair< const K, V > value_type;
+        typedef value_type Slot;
+        static const bool kIsKeyOnly = false;
+
+        static const K& key( const Slot& slot ) { return slot.first; }
+
+        static void transfer( Slot* to, Slot* from )
+        {
+            // The key is const only to users; the old slot is destroyed
+            // straight after, so moving out of it is safe
+            new( to ) Slot( std::move( const_cast< K& >( from->first ) ), std::move( from->second ) );
+            from->~Slot();
+        }
+    };
+
+    template< typename K >
+    struct SetPolicy
+    {
+        typedef K key_type;
+        typedef K value_type;
+        typedef K Slot;
+        static const bool kIsKeyOnly = true;
+
+        static const K& key( const Slot& slot ) { return slot; }
+
+        static void transfer( Slot* to, Slot* from )
+        {
+            new( to ) Slot( std::move( *from ) );
+            from->~Slot();
+        }
+    };
+
+    /// Open-addressing table shared by FlatHashMap and FlatHashSet
+    template< typename Policy, typename HashFn, typename Equal >
+    class FlatHashTable
+    {
+        typedef typename Policy::Slot Slot;
+        static const bool kIsTransparent = IsTransparent< HashFn, Equal >::value;
+
+    public:
+        typedef typename Policy::key_type key_type;
+        typedef typename Policy::value_type value_type;
+        typedef HashFn hasher;
+        typedef Equal key_equal;
+        typedef size_t size_type;
+
+        template< typename Lookup >
+        using LookupKey = typename KeyArg< kIsTransparent >::template type< Lookup, key_type >;
+
+        template< bool isConst >
+        class Iterator
+        {
+            typedef typename std::conditional< isConst || Policy::kIsKeyOnly, const typename Policy::value_type, typename Policy::value_type >::type Element;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef typename Policy::value_type value_type;
+            typedef ptrdiff_t difference_type;
+            typedef Element* pointer;
+            typedef Element& reference;
+
+            Iterator() = default;
+            /// iterator to const_iterator
+            template< bool wasConst, typename = typename std::enable_if< isConst && !wasConst >::type >
+            Iterator( const Iterator< wasConst >& other ) : mControl( other.mControl ), mSlot( other.mSlot ) {}
+
+            reference operator*() const { return *mSlot; }
+            pointer operator->() const { return mSlot; }
+
+            Iterator& operator++()
+            {
+                ++mControl;
+                ++mSlot;
+                skipFree();
+                return *this;
+            }
+
+            Iterator operator++( int )
+            {
+                Iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+
+            bool operator==( const Iterator& other ) const { return mControl == other.mControl; }
+            bool operator!=( const Iterator& other ) const { return mControl != other.mControl; }
+
+        private:
+            friend class FlatHashTable;
+            template< bool > friend class Iterator;
+
+            Iterator( const Control* control, Slot* slot ) : mControl( control ), mSlot( slot ) {}
+
+            /// Stops at the first full slot or the sentinel after the last
+            void skipFree()
+            {
+                while( *mControl < 0 )
+                {
+                    ++mControl;
+                    ++mSlot;
+                }
+            }
+
+            const Control* mControl = nullptr;
+            Slot* mSlot = nullptr;
+        };
+
+        typedef Iterator< false > iterator;
+        typedef Iterator< true > const_iterator;
+
+        FlatHashTable() = default;
+
+        explicit FlatHashTable( size_t count, const HashFn& hash = HashFn(), const Equal& equal = Equal() )
+            : mHash( hash ), mEqual( equal )
+        {
+            reserve( count );
+        }
+
+        FlatHashTable( std::initializer_list< value_type > values )
+        {
+            reserve( values.size() );
+            for( const value_type& value : values )
+            {
+                insert( value );
+            }
+        }
+
+        FlatHashTable( const FlatHashTable& other ) : mHash( other.mHash ), mEqual( other.mEqual )
+        {
+            copyFrom( other );
+        }
+
+        FlatHashTable( FlatHashTable&& other ) noexcept : mHash( other.mHash ), mEqual( other.mEqual )
+        {
+            takeFrom( other );
+        }
+
+        FlatHashTable& operator=( const FlatHashTable& other )
+        {
+            if( this != &other )
+            {
+                release();
+                mHash = other.mHash;
+                mEqual = other.mEqual;
+                copyFrom( other );
+            }
+            return *this;
+        }
+
+        FlatHashTable& operator=( FlatHashTable&& other ) noexcept
+        {
+            if( this != &other )
+            {
+                release();
+                mHash = other.mHash;
+                mEqual = other.mEqual;
+                takeFrom( other );
+            }
+            return *this;
+        }
+
+        ~FlatHashTable()
+        {
+            release();
+        }
+
+        iterator begin() { iterator it( mControls, mSlots ); it.skipFree(); return it; }
+        iterator end() { return iterator( mControls + mCapacity, mSlots + mCapacity ); }
+        const_iterator begin() const { const_iterator it( mControls, mSlots ); it.skipFree(); return it; }
+        const_iterator end() const { return const_iterator( mControls + mCapacity, mSlots + mCapacity ); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+        /// Slots allocated; a power of two, or 0 before the first insert
+        size_t capacity() const { return mCapacity; }
+        size_t bucket_count() const { return mCapacity; }
+        float load_factor() const { return mCapacity ? float( mSize ) / float( mCapacity ) : 0.0f; }
+        static float max_load_factor() { return 7.0f / 8.0f; }
+
+        hasher hash_function() const { return mHash; }
+        key_equal key_eq() const { return mEqual; }
+
+        std::pair< iterator, bool > insert( const value_type& value )
+        {
+            std::pair< size_t, bool > found = findOrPrepareInsert( Policy::key( value ) );
+            if( found.second )
+            {
+                new( mSlots + found.first ) Slot( value );
+            }
+            return std::make_pair( iteratorAt( found.first ), found.second );
+        }
+
+        std::pair< iterator, bool > insert( value_type&& value )
+        {
+            std::pair< size_t, bool > found = findOrPrepareInsert( Policy::key( value ) );
+            if( found.second )
+            {
+                new( mSlots + found.first ) Slot( std::move( value ) );
+            }
+            return std::make_pair( iteratorAt( found.first ), found.second );
+        }
+
+        template< typename InputIterator >
+        void insert( InputIterator first, InputIterator last )
+        {
+            for( ; first != last; ++first )
+            {
+                insert( *first );
+            }
+        }
+
+        /// Builds the value before looking it up; FlatHashMap::try_emplace()
+        /// avoids that
+        template< typename... Args >
+        std::pair< iterator, bool > emplace( Args&&... args )
+        {
+            return insert( value_type( std::forward< Args >( args )... ) );
+        }
+
+        template< typename Lookup = key_type >
+        iterator find( const LookupKey< Lookup >& key )
+        {
+            size_t index = findIndex( key, mHash( key ) );
+            return index == kNotFound ? end() : iteratorAt( index );
+        }
+
+        template< typename Lookup = key_type >
+        const_iterator find( const LookupKey< Lookup >& key ) const
+        {
+            size_t index = findIndex( key, mHash( key ) );
+            return index == kNotFound ? end() : const_iterator( mControls + index, mSlots + index );
+        }
+
+        template< typename Lookup = key_type >
+        bool contains( const LookupKey< Lookup >& key ) const
+        {
+            return findIndex( key, mHash( key ) ) != kNotFound;
+        }
+
+        template< typename Lookup = key_type >
+        size_t count( const LookupKey< Lookup >& key ) const
+        {
+            return contains< Lookup >( key ) ? 1 : 0;
+        }
+
+        /// Iterator to the next value; other iterators stay valid
+        iterator erase( const_iterator position )
+        {
+            size_t index = static_cast< size_t >( position.mControl - mControls );
+            eraseAt( index );
+            iterator next = iteratorAt( index );
+            next.skipFree();
+            return next;
+        }
+
+        iterator erase( iterator position )
+        {
+            return erase( const_iterator( position ) );
+        }
+
+        template< typename Lookup = key_type >
+        size_t erase( const LookupKey< Lookup >& key )
+        {
+            size_t index = findIndex( key, mHash( key ) );
+            if( index == kNotFound )
+            {
+                return 0;
+            }
+            eraseAt( index );
+            return 1;
+        }
+
+        /// Destroy every value but keep the memory
+        void clear()
+        {
+            if( mCapacity == 0 )
+            {
+                return;
+            }
+            destroyAll();
+            std::memset( mControls, kEmpty, mCapacity );
+            mSize = 0;
+            mGrowthLeft = maxLoad( mCapacity );
+        }
+
+        /// Make room for `count` values without rehashing
+        void reserve( size_t count )
+        {
+            size_t capacity = capacityFor( count );
+            if( capacity > mCapacity )
+            {
+                resize( capacity );
+            }
+        }
+
+        /// Resize to fit at least `count` slots and the current values,
+        /// shrinking if that is smaller; rehash( 0 ) shrinks to fit
+        void rehash( size_t count )
+        {
+            size_t capacity = capacityFor( mSize );
+            size_t requested = count ? normalizeCapacity( count ) : 0;
+            capacity = requested > capacity ? requested : capacity;
+            if( capacity == 0 )
+            {
+                release();
+            }
+            else if( capacity != mCapacity )
+            {
+                resize( capacity );
+            }
+        }
+
+        void swap( FlatHashTable& other )
+        {
+            std::swap( mHash, other.mHash );
+            std::swap( mEqual, other.mEqual );
+            std::swap( mControls, other.mControls );
+            std::swap( mSlots, other.mSlots );
+            std::swap( mCapacity, other.mCapacity );
+            std::swap( mSize, other.mSize );
+            std::swap( mGrowthLeft, other.mGrowthLeft );
+        }
+
+    protected:
+        static const size_t kNotFound = ~size_t( 0 );
+
+        iterator iteratorAt( size_t index )
+        {
+            return iterator( mControls + index, mSlots + index );
+        }
+
+        Slot* slotAt( size_t index )
+        {
+            return mSlots + index;
+        }
+
+        /// Index of the key, or of a newly claimed slot that the caller must
+        /// construct a value in; true in the second case
+        template< typename Key >
+        std::pair< size_t, bool > findOrPrepareInsert( const Key& key )
+        {
+            size_t hash = mHash( key );
+            size_t index = findIndex( key, hash );
+            if( index != kNotFound )
+            {
+                return std::make_pair( index, false );
+            }
+            return std::make_pair( prepareInsert( hash ), true );
+        }
+
+    private:
+        static const size_t kWidth = Group::kWidth;
+
+        /// Groups are probed in triangular steps, which visits every group
+        /// of a power of two count.  Lookups stop at the first group with an
+        /// empty slot; there always is one, as at most 7/8 of the slots can
+        /// be full or deleted.
+        template< typename Key >
+        size_t findIndex( const Key& key, size_t hash ) const
+        {
+            if( mCapacity == 0 )
+            {
+                return kNotFound;
+            }
+            Control h2 = static_cast< Control >( hash & 0x7f );
+            size_t groupMask = mCapacity / kWidth - 1;
+            size_t group = ( hash >> 7 ) & groupMask;
+            for( size_t step = 1; ; ++step )
+            {
+                size_t first = group * kWidth;
+                Group controls( mControls + first );
+                for( typename Group::Mask match = controls.match( h2 ); match.any(); match.removeLowest() )
+                {
+                    size_t index = first + match.lowest();
+                    if( mEqual( Policy::key( mSlots[ index ] ), key ) )
+                    {
+                        return index;
+                    }
+                }
+                if( controls.matchEmpty().any() )
+                {
+                    return kNotFound;
+                }
+                group = ( group + step ) & groupMask;
+            }
+        }
+
+        size_t findFree( size_t hash ) const
+        {
+            size_t groupMask = mCapacity / kWidth - 1;
+            size_t group = ( hash >> 7 ) & groupMask;
+            for( size_t step = 1; ; ++step )
+            {
+                size_t first = group * kWidth;
+                typename Group::Mask free = Group( mControls + first ).matchFree();
+                if( free.any() )
+                {
+                    return first + free.lowest();
+                }
+                group = ( group + step ) & groupMask;
+            }
+        }
+
+        /// Claim a free slot for a key with this hash, growing or clearing
+        /// out deleted slots if reusing an empty one would go over the load
+        /// limit
+        size_t prepareInsert( size_t hash )
+        {
+            size_t index = mCapacity ? findFree( hash ) : 0;
+            if( mCapacity == 0 || ( mGrowthLeft == 0 && mControls[ index ] == kEmpty ) )
+            {
+                // Mostly deleted slots: rebuilding at the same size is enough
+                bool isCrowded = mSize + 1 > maxLoad( mCapacity ) / 2;
+                resize( mCapacity == 0 ? kWidth : isCrowded ? mCapacity * 2 : mCapacity );
+                index = findFree( hash );
+            }
+            if( mControls[ index ] == kEmpty )
+            {
+                --mGrowthLeft;
+            }
+            mControls[ index ] = static_cast< Control >( hash & 0x7f );
+            ++mSize;
+            return index;
+        }
+
+        void eraseAt( size_t index )
+        {
+            mSlots[ index ].~Slot();
+            --mSize;
+            // A group with an empty slot never sent a probe on to the next
+            // group, so nothing can be found beyond this slot and it can be
+            // empty again; otherwise leave a tombstone
+            if( Group( mControls + ( index & ~( kWidth - 1 ) ) ).matchEmpty().any() )
+            {
+                mControls[ index ] = kEmpty;
+                ++mGrowthLeft;
+            }
+            else
+            {
+                mControls[ index ] = kDeleted;
+            }
+        }
+
+        static size_t maxLoad( size_t capacity )
+        {
+            return capacity - capacity / 8;
+        }
+
+        static size_t normalizeCapacity( size_t count )
+        {
+            size_t capacity = kWidth;
+            while( capacity < count )
+            {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+
+        static size_t capacityFor( size_t count )
+        {
+            if( count == 0 )
+            {
+                return 0;
+            }
+            size_t capacity = normalizeCapacity( count );
+            while( maxLoad( capacity ) < count )
+            {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+
+        /// Controls, a sentinel that stops iteration, then the slots
+        static size_t slotsOffset( size_t capacity )
+        {
+            return ( capacity + 1 + alignof( Slot ) - 1 ) & ~( alignof( Slot ) - 1 );
+        }
+
+        void allocate( size_t capacity )
+        {
+            static_assert( alignof( Slot ) <= alignof( std::max_align_t ), "Over-aligned values aren't supported" );
+            size_t offset = slotsOffset( capacity );
+            char* memory = static_cast< char* >( ::operator new( offset + capacity * sizeof( Slot ) ) );
+            mControls = reinterpret_cast< Control* >( memory );
+            mSlots = reinterpret_cast< Slot* >( memory + offset );
+            std::memset( mControls, kEmpty, capacity );
+            mControls[ capacity ] = 0;
+            mCapacity = capacity;
+            mGrowthLeft = maxLoad( capacity ) - mSize;
+        }
+
+        void resize( size_t capacity )
+        {
+            Control* oldControls = mControls;
+            Slot* oldSlots = mSlots;
+            size_t oldCapacity = mCapacity;
+            allocate( capacity );
+            for( size_t i = 0; i < oldCapacity; ++i )
+            {
+                if( oldControls[ i ] >= 0 )
+                {
+                    size_t hash = mHash( Policy::key( oldSlots[ i ] ) );
+                    size_t index = findFree( hash );
+                    mControls[ index ] = static_cast< Control >( hash & 0x7f );
+                    Policy::transfer( mSlots + index, oldSlots + i );
+                }
+            }
+            if( oldCapacity )
+            {
+                ::operator delete( oldControls );
+            }
+        }
+
+        void destroyAll()
+        {
+            if( !std::is_trivially_destructible< Slot >::value )
+            {
+                for( size_t i = 0; i < mCapacity; ++i )
+                {
+                    if( mControls[ i ] >= 0 )
+                    {
+                        mSlots[ i ].~Slot();
+                    }
+                }
+            }
+        }
+
+        void release()
+        {
+            if( mCapacity )
+            {
+                destroyAll();
+                ::operator delete( mControls );
+            }
+            mControls = emptyControls();
+            mSlots = nullptr;
+            mCapacity = 0;
+            mSize = 0;
+            mGrowthLeft = 0;
+        }
+
+        void copyFrom( const FlatHashTable& other )
+        {
+            reserve( other.mSize );
+            for( const value_type& value : other )
+            {
+                size_t hash = mHash( Policy::key( value ) );
+                size_t index = prepareInsert( hash );
+                new( mSlots + index ) Slot( value );
+            }
+        }
+
+        void takeFrom( FlatHashTable& other )
+        {
+            mControls = other.mControls;
+            mSlots = other.mSlots;
+            mCapacity = other.mCapacity;
+            mSize = other.mSize;
+            mGrowthLeft = other.mGrowthLeft;
+            other.mControls = emptyControls();
+            other.mSlots = nullptr;
+            other.mCapacity = 0;
+            other.mSize = 0;
+            other.mGrowthLeft = 0;
+        }
+
+        /// Just the sentinel, so an empty table needs no allocation
+        static Control* emptyControls()
+        {
+            static Control sSentinel = 0;
+            return &sSentinel;
+        }
+
+        HashFn mHash;
+        Equal mEqual;
+        Control* mControls = emptyControls();
+        Slot* mSlots = nullptr;
+        size_t mCapacity = 0;
+        size_t mSize = 0;
+        size_t mGrowthLeft = 0; // empty slots that can still be filled
+    };
+
+}
+
+/// Swiss-table style hash map: open addressing over one flat array, for
+/// lookups by resource name, uniform name or ID.
+///
+/// Each slot has a control byte holding 7 bits of its key's hash.  A lookup
+/// compares a whole group of control bytes against the hash at once, 16
+/// with SSE2 or 8 with the scalar fallback used under Emscripten, and
+/// only compares keys for the bytes that match, so a miss rarely reads a
+/// slot at all.  The table grows by doubling at 7/8 full.
+///
+/// With a transparent hash and equality (the default Hash< std::string >
+/// and std::equal_to<> are) find(), contains(), erase(), try_emplace() and
+/// operator[] take anything comparable with the key, such as a string
+/// literal, without building a key.  Pass another hasher for a different
+/// hash function; it should spread its results over all bits.
+///
+/// Unlike std::unordered_map, inserting can move values, invalidating
+/// pointers, references and iterators; erasing invalidates only the
+/// erased value.
+///
+/// Example:
+///     FlatHashMap< std::string, GLint > uniforms;
+///     uniforms.try_emplace( "uModelView", location );
+///     auto found = uniforms.find( "uModelView" );   // no std::string built
+template< typename K, typename V, typename HashFn = Hash< K >, typename Equal = std::equal_to<> >
+class FlatHashMap : public detail::FlatHashTable< detail::MapPolicy< K, V >, HashFn, Equal >
+{
+    typedef detail::FlatHashTable< detail::MapPolicy< K, V >, HashFn, Equal > Table;
+
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef typename Table::value_type value_type;
+    typedef typename Table::iterator iterator;
+    typedef typename Table::const_iterator const_iterator;
+
+    template< typename Lookup >
+    using LookupKey = typename Table::template LookupKey< Lookup >;
+
+    using Table::Table;
+
+    FlatHashMap() = default;
+
+    /// Constructs the value only if the key isn't there yet
+    template< typename Key, typename... Args >
+    std::pair< iterator, bool > try_emplace( Key&& key, Args&&... args )
+    {
+        std::pair< size_t, bool > found = this->findOrPrepareInsert( key );
+        if( found.second )
+        {
+            new( this->slotAt( found.first ) ) value_type( std::piecewise_construct, std::forward_as_tuple( std::forward< Key >( key ) ),
+                                                           std::forward_as_tuple( std::forward< Args >( args )... ) );
+        }
+        return std::make_pair( this->iteratorAt( found.first ), found.second );
+    }
+
+    template< typename Key, typename Value >
+    std::pair< iterator, bool > insert_or_assign( Key&& key, Value&& value )
+    {
+        std::pair< iterator, bool > result = try_emplace( std::forward< Key >( key ), std::forward< Value >( value ) );
+        if( !result.second )
+        {
+            result.first->second = std::forward< Value >( value );
+        }
+        return result;
+    }
+
+    template< typename Lookup = key_type >
+    V& operator[]( const LookupKey< Lookup >& key )
+    {
+        return try_emplace( key ).first->second;
+    }
+
+    V& operator[]( key_type&& key )
+    {
+        return try_emplace( std::move( key ) ).first->second;
+    }
+
+    /// Null if the key isn't there
+    template< typename Lookup = key_type >
+    V* findValue( const LookupKey< Lookup >& key )
+    {
+        iterator found = this->template find< Lookup >( key );
+        return found == this->end() ? nullptr : &found->second;
+    }
+
+    template< typename Lookup = key_type >
+    const V* findValue( const LookupKey< Lookup >& key ) const
+    {
+        const_iterator found = this->template find< Lookup >( key );
+        return found == this->end() ? nullptr : &found->second;
+    }
+};
+
+/// Swiss-table style hash set; see FlatHashMap
+template< typename K, typename HashFn = Hash< K >, typename Equal = std::equal_to<> >
+class FlatHashSet : public detail::FlatHashTable< detail::SetPolicy< K >, HashFn, Equal >
+{
+    typedef detail::FlatHashTable< detail::SetPolicy< K >, HashFn, Equal > Table;
+
+public:
+    using Table::Table;
+
+    FlatHashSet() = default;
+};
+
+} }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Core/Log.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cobalt { namespace core {
+
+/// Crash-safe log sink backed by a fixed-size memory-mapped ring file.
+/// While open, every emitted log line is also copied into the next ring slot
+/// with plain memory stores (no syscalls), and because the mapping is shared
+/// with the file the OS persists it even if the process dies.  Assertion
+/// failures are flagged so post-mortem tools can find them; read a ring with
+/// cobalt_flight_recorder_dump.
+///
+/// Deferred (BinaryLog) records are stored still encoded, flagged as binary,
+/// so the logging thread never formats them.  Their format strings go once
+/// per run into a table after the ring, keyed by address and run, where the
+/// dump tool looks them up to decode the records.
+///
+/// Example:
+///     FlightRecorder::open( "/var/tmp/myapp.flight" );
+class FlightRecorder
+{
+public:
+    static const size_t kRecordSize = 256;
+    static const size_t kDefaultRecordCount = 16384; // 4 MiB ring
+    static const size_t kTextSize = kRecordSize - 24;
+    static const size_t kFormatCount = 1024; // format table slots, 256 KiB
+
+    /// BinaryFlag records hold a BinaryLog::EventHeader and its encoded
+    /// arguments instead of text
+    enum RecordFlags : uint8_t { AssertFlag = 1, BinaryFlag = 2 };
+
+    /// `sequence` of a slot a writer has claimed and is still filling in
+    static const uint64_t kBusySequence = UINT64_MAX;
+
+    /// One ring slot.  `sequence` is written last and is 1 + the record's
+    /// global index, so 0 marks a slot never written.  A slot left at
+    /// kBusySequence, or whose sequence doesn't map back to it, was torn by
+    /// a crash mid-write.
+    struct Record
+    {
+        std::atomic< uint64_t > sequence;
+        int64_t wallTimeNs; // since the Unix epoch
+        uint8_t level;
+        uint8_t flags;
+        uint16_t length;
+        uint32_t run; // Header::run of the process that wrote it
+        char text[ kTextSize ];
+    };
+
+    /// One format table slot.  `id` is the format string's address, stored
+    /// last; kBusySequence while being filled in.
+    struct Format
+    {
+        std::atomic< uint64_t > id;
+        uint32_t run;
+        uint32_t length;
+        char text[ kRecordSize - 16 ];
+    };
+
+    struct Header
+    {
+        char magic[ 8 ];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t recordCount;
+        std::atomic< uint64_t > nextIndex;
+        std::atomic< uint64_t > lastAssertSequence; // 0 if none
+        uint64_t processId;
+        uint64_t formatCount; // Format slots after the records
+        uint32_t run;         // counts the opens of this file
+        uint32_t reserved;
+        char padding[ kRecordSize - 64 ];
+    };
+
+    static const char kMagic[ 8 ];
+    static const uint32_t kVersion = 2;
+
+    /// Create (or reuse) the ring file at `path` and map it.
+    static bool open( const char* path, size_t recordCount = kDefaultRecordCount );
+    static void close();
+    static bool isOpen() { return sHeader.load( std::memory_order_acquire ) != nullptr; }
+
+    /// Append one line; used by Log, which strips the trailing newline.
+    static void write( Log::Level level, const char* text, size_t length, uint8_t flags = 0 );
+    /// Append an encoded BinaryLog record of at most kTextSize bytes; `format`
+    /// must be the literal its header refers to.
+    static void writeBinary( Log::Level level, const char* format, const char* record, size_t length );
+
+private:
+    static std::atomic< Header* > sHeader;
+};
+
+} }
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/// Compile-time check that a literal format string matches the types of its
+/// arguments, e.g. COBALT_CHECK_FORMAT( "%d items", count );
+#define COBALT_CHECK_FORMAT( ... ) static_assert( cobalt::core::detail::checkFormat( COBALT_FORMAT_STRING( __VA_ARGS__ ), decltype( cobalt::core::detail::formatSignature( __VA_ARGS__ ) )::classes ), "Format string does not match its arguments" )
+#define COBALT_FORMAT_STRING( ... ) COBALT_FORMAT_STRING_( __VA_ARGS__, 0 )
+#define COBALT_FORMAT_STRING_( format, ... ) format
+
+namespace cobalt { namespace core {
+
+/// One type-erased formatting argument.  Built on the caller's stack by
+/// format(), so formatting never touches the heap.
+struct FormatArg
+{
+    enum class Type : uint8_t { None, Signed, Unsigned, Char, Bool, Double, String, Pointer };
+
+    Type type;
+    uint8_t size; // bytes in the integer operand, for unsigned conversions of negative values
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+        struct { const char* data; size_t size; } s;
+    };
+
+    FormatArg() : type( Type::None ), size( 0 ), u( 0 ) {}
+    FormatArg( bool value ) : type( Type::Bool ), size( 1 ), u( value ) {}
+    FormatArg( char value ) : type( Type::Char ), size( 1 ), i( value ) {}
+    FormatArg( const char* value ) : type( Type::String ), size( 0 ) { s.data = value ? value : "(null)"; s.size = SIZE_MAX; }
+    FormatArg( char* value ) : FormatArg( static_cast< const char* >( value ) ) {}
+    FormatArg( const std::string& value ) : type( Type::String ), size( 0 ) { s.data = value.data(); s.size = value.size(); }
+
+    template< typename T, typename std::enable_if< std::is_integral< T >::value && std::is_signed< T >::value, int >::type = 0 >
+    FormatArg( T value ) : type( Type::Signed ), size( sizeof( T ) ), i( value ) {}
+
+    template< typename T, typename std::enable_if< std::is_integral< T >::value && !std::is_signed< T >::value, int >::type = 0 >
+    FormatArg( T value ) : type( Type::Unsigned ), size( sizeof( T ) ), u( value ) {}
+
+    template< typename T, typename std::enable_if< std::is_enum< T >::value, int >::type = 0 >
+    FormatArg( T value ) : FormatArg( static_cast< typename std::underlying_type< T >::type >( value ) ) {}
+
+    template< typename T, typename std::enable_if< std::is_floating_point< T >::value, int >::type = 0 >
+    FormatArg( T value ) : type( Type::Double ), size( 0 ), d( static_cast< double >( value ) ) {}
+
+    template< typename T >
+    FormatArg( T* value ) : type( Type::Pointer ), size( 0 ), p( value ) {}
+};
+
+/// printf-style formatting without printf.
+/// Supports %d %i %u %x %X %o %c %s %p %f %F %e %E %g %G %a %A and %% with
+/// the usual flags, width and precision (including '*'); length modifiers
+/// such as l, ll and z are accepted and ignored because the argument types
+/// are known.  A %g without a precision or '#' prints the shortest text that
+/// reads back as the same double, rather than printf's 6 significant digits.
+/// Negative integers under %u, %x and %o print as printf would, in two's
+/// complement at the operand's width.
+///
+/// Writes at most outSize - 1 characters plus a terminator into `out` and
+/// returns the number of characters written.
+size_t formatArgs( char* out, size_t outSize, const char* format, const FormatArg* args, size_t argCount );
+
+template< typename... Args >
+size_t format( char* out, size_t outSize, const char* format, const Args&... args )
+{
+    const FormatArg argArray[] = { FormatArg( args )..., FormatArg() };
+    return formatArgs( out, outSize, format, argArray, sizeof...( Args ) );
+}
+
+namespace detail {
+
+    // Argument classes for compile-time format checking:
+    // 'i' integer, 'c' char, 'b' bool, 'f' floating point, 's' string, 'p' pointer
+    template< typename T, typename Enable = void > struct FormatClass;
+    template<> struct FormatClass< bool > { static constexpr char value = 'b'; };
+    template<> struct FormatClass< char > { static constexpr char value = 'c'; };
+    template<> struct FormatClass< char* > { static constexpr char value = 's'; };
+    template<> struct FormatClass< const char* > { static constexpr char value = 's'; };
+    template<> struct FormatClass< std::string > { static constexpr char value = 's'; };
+    template< typename T > struct FormatClass< T, typename std::enable_if< std::is_integral< T >::value && !std::is_same< T, bool >::value && !std::is_same< T, char >::value >::type > { static constexpr char value = 'i'; };
+    template< typename T > struct FormatClass< T, typename std::enable_if< std::is_enum< T >::value >::type > { static constexpr char value = 'i'; };
+    template< typename T > struct FormatClass< T, typename std::enable_if< std::is_floating_point< T >::value >::type > { static constexpr char value = 'f'; };
+    template< typename T > struct FormatClass< T*, typename std::enable_if< !std::is_same< typename std::remove_cv< T >::type, char >::value >::type > { static constexpr char value = 'p'; };
+
+    template< typename... Args >
+    struct FormatSignature
+    {
+        static constexpr char classes[ sizeof...( Args ) + 1 ] = { FormatClass< typename std::decay< Args >::type >::value..., '\0' };
+    };
+    template< typename... Args >
+    constexpr char FormatSignature< Args... >::classes[ sizeof...( Args ) + 1 ];
+
+    // Only used in unevaluated context, to name the argument types
+    template< typename... Args >
+    FormatSignature< Args... > formatSignature( const char* format, const Args&... args );
+
+    constexpr bool isIn( char c, const char* set )
+    {
+        while( *set )
+        {
+            if( *set++ == c )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr bool isCompatible( char conversion, char argClass )
+    {
+        return conversion == 's' ? true
+             : conversion == 'p' ? argClass == 'p'
+             : isIn( conversion, "diuxXoc" ) ? isIn( argClass, "icb" )
+             : isIn( conversion, "fFeEgGaA" ) ? isIn( argClass, "icf" )
+             : false;
+    }
+
+    constexpr bool checkFormat( const char* format, const char* classes )
+    {
+        size_t arg = 0;
+        const char* p = format;
+        while( *p )
+        {
+            if( *p++ != '%' )
+            {
+                continue;
+            }
+            if( *p == '%' )
+            {
+                ++p;
+                continue;
+            }
+            while( isIn( *p, "-+ #0" ) ) { ++p; }
+            if( *p == '*' )
+            {
+                if( !classes[ arg ] || !isIn( classes[ arg++ ], "ic" ) ) { return false; }
+                ++p;
+            }
+            while( *p >= '0' && *p <= '9' ) { ++p; }
+            if( *p == '.' )
+            {
+                ++p;
+                if( *p == '*' )
+                {
+                    if( !classes[ arg ] || !isIn( classes[ arg++ ], "ic" ) ) { return false; }
+                    ++p;
+                }
+                while( *p >= '0' && *p <= '9' ) { ++p; }
+            }
+            while( isIn( *p, "hlLqjzt" ) ) { ++p; }
+            if( !*p || !classes[ arg ] || !isCompatible( *p, classes[ arg ] ) )
+            {
+                return false;
+            }
+            ++arg;
+            ++p;
+        }
+        return classes[ arg ] == '\0';
+    }
+}
+
+} }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cobalt { namespace core {
+
+/// Linear allocator for data that only lives for a frame or two: command
+/// lists, culling results, scratch strings.  Allocation bumps a pointer and
+/// nothing is freed individually; a buffer is reset wholesale when the
+/// arena cycles back to it.
+///
+/// There are bufferCount buffers used round-robin, one per frame, so data
+/// allocated in frame N stays valid until nextFrame() has been called
+/// bufferCount times, e.g. 2 lets rendering read the frame the simulation
+/// just finished and 3 covers the pipelined update thread running a frame
+/// ahead (Application sizes the global arena accordingly).
+///
+/// Threads carve kThreadChunkSize pieces out of the shared buffer with one
+/// atomic add and then bump privately, so allocating takes no locks.  When
+/// a buffer runs out, allocations fall back to the heap until it is reset,
+/// and are counted in overflowBytes().  Destructors are never run.
+///
+/// Buffers are VirtualMemory regions on transparent huge pages where the
+/// system has them, since they are large and touched all over each frame.
+///
+/// Example:
+///     FrameVector< DrawCommand > commands;   // uses FrameArena::global()
+///     commands.reserve( visibleCount );
+///     char* label = FrameArena::global().allocateArray< char >( 64 );
+class FrameArena
+{
+public:
+    static const size_t kThreadChunkSize = 64 * 1024;
+
+    explicit FrameArena( size_t bytesPerBuffer = 8 * 1024 * 1024, unsigned bufferCount = 2 );
+    ~FrameArena();
+    FrameArena( const FrameArena& ) = delete;
+    FrameArena& operator=( const FrameArena& ) = delete;
+
+    /// The arena impl::gblUpdate advances each frame; created on first use
+    /// from any thread
+    static FrameArena& global();
+    /// Size the global arena.  Takes effect if nothing has been allocated
+    /// from it yet; otherwise the existing arena is kept and a warning logged.
+    static void configureGlobal( size_t bytesPerBuffer, unsigned bufferCount );
+
+    void* allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+    template< typename T >
+    T* allocateArray( size_t count )
+    {
+        return static_cast< T* >( allocate( count * sizeof( T ), alignof( T ) ) );
+    }
+
+    template< typename T, typename... Args >
+    T* create( Args&&... args )
+    {
+        static_assert( std::is_trivially_destructible< T >::value, "FrameArena never runs destructors" );
+        return new ( allocate( sizeof( T ), alignof( T ) ) ) T( std::forward< Args >( args )... );
+    }
+
+    /// Start the next frame, resetting the buffer it will use.  No other
+    /// thread may still be using that buffer's data.
+    void nextFrame();
+
+    uint64_t frameIndex() const { return mFrameIndex.load( std::memory_order_relaxed ); }
+    unsigned bufferCount() const { return mBufferCount; }
+    size_t capacity() const { return mCapacity; }
+
+    /// Bytes handed out this frame, counting chunks threads have reserved
+    size_t bytesUsed() const;
+    /// Of bytesUsed(), how many came from the heap because the buffer was full
+    size_t overflowBytes() const;
+    /// Most bytes any finished frame used
+    size_t highWaterMark() const { return mHighWaterMark.load( std::memory_order_relaxed ); }
+
+private:
+    struct Buffer;
+
+    Buffer& currentBuffer() const;
+    void* allocateShared( size_t size, size_t alignment );
+
+    std::unique_ptr< Buffer[] > mBuffers;
+    unsigned mBufferCount;
+    size_t mCapacity;
+    uint64_t mId; // tells arenas apart in the per-thread chunk caches
+    std::atomic< uint64_t > mFrameIndex{ 0 };
+    std::atomic< size_t > mHighWaterMark{ 0 };
+};
+
+/// STL allocator drawing from a FrameArena (the global one by default);
+/// deallocate() does nothing.  Containers using it must not outlive the
+/// arena buffer they were filled in.
+template< typename T >
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator() : mArena( &FrameArena::global() ) {}
+    explicit FrameAllocator( FrameArena& arena ) : mArena( &arena ) {}
+    template< typename U >
+    FrameAllocator( const FrameAllocator< U >& other ) : mArena( other.arena() ) {}
+
+    T* allocate( size_t count ) { return mArena->allocateArray< T >( count ); }
+    void deallocate( T*, size_t ) {}
+
+    FrameArena* arena() const { return mArena; }
+
+    template< typename U >
+    bool operator==( const FrameAllocator< U >& other ) const { return mArena == other.arena(); }
+    template< typename U >
+    bool operator!=( const FrameAllocator< U >& other ) const { return mArena != other.arena(); }
+
+private:
+    FrameArena* mArena;
+};
+
+template< typename T >
+using FrameVector = std::vector< T, FrameAllocator< T > >;
+typedef std::basic_string< char, std::char_traits< char >, FrameAllocator< char > > FrameString;
+
+} }
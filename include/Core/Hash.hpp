@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#if defined( __cpp_lib_string_view )
+    #include <string_view>
+#endif
+
+#if defined( _MSC_VER ) && defined( _M_X64 )
+    #include <intrin.h>
+#endif
+
+namespace cobalt { namespace core {
+
+/// Full 128-bit product of a and b
+inline void multiply128( uint64_t a, uint64_t b, uint64_t& low, uint64_t& high )
+{
+#if defined( __SIZEOF_INT128__ )
+    __uint128_t product = static_cast< __uint128_t >( a ) * b;
+    low = static_cast< uint64_t >( product );
+    high = static_cast< uint64_t >( product >> 64 );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    low = _umul128( a, b, &high );
+#else
+    uint64_t aLow = a & 0xffffffffu, aHigh = a >> 32;
+    uint64_t bLow = b & 0xffffffffu, bHigh = b >> 32;
+    uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+    uint64_t middle = ( lowLow >> 32 ) + ( lowHigh & 0xffffffffu ) + ( highLow & 0xffffffffu );
+    low = ( lowLow & 0xffffffffu ) | ( middle << 32 );
+    high = highHigh + ( lowHigh >> 32 ) + ( highLow >> 32 ) + ( middle >> 32 );
+#endif
+}
+
+/// Mix two 64-bit values by folding their 128-bit product; every input bit
+/// affects every output bit
+inline uint64_t hashMix( uint64_t a, uint64_t b )
+{
+    uint64_t low;
+    uint64_t high;
+    multiply128( a, b, low, high );
+    return low ^ high;
+}
+
+inline uint64_t hashInteger( uint64_t value )
+{
+    return hashMix( value ^ 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull );
+}
+
+/// wyhash-style hash of a byte string: a few multiplies per 16 bytes, no
+/// tables, good enough distribution for hash tables (not for security)
+uint64_t hashBytes( const void* data, size_t length, uint64_t seed = 0 );
+
+/// Hashes std::string, string literals and (from C++17) std::string_view
+/// alike, so tables keyed on std::string can be searched without building
+/// a string
+struct StringHash
+{
+    typedef void is_transparent;
+
+    size_t operator()( const std::string& text ) const { return static_cast< size_t >( hashBytes( text.data(), text.size() ) ); }
+    size_t operator()( const char* text ) const { return static_cast< size_t >( hashBytes( text, std::strlen( text ) ) ); }
+#if defined( __cpp_lib_string_view )
+    size_t operator()( std::string_view text ) const { return static_cast< size_t >( hashBytes( text.data(), text.size() ) ); }
+#endif
+};
+
+/// Default hash for FlatHashMap and FlatHashSet.  Unlike std::hash, which
+/// is the identity for integers on common standard libraries, every result
+/// is well mixed across all bits, which the tables rely on.  Types without
+/// a specialization go through std::hash and are mixed afterwards.
+template< typename T, typename Enable = void >
+struct Hash
+{
+    size_t operator()( const T& value ) const { return static_cast< size_t >( hashInteger( std::hash< T >()( value ) ) ); }
+};
+
+template< typename T >
+struct Hash< T, typename std::enable_if< std::is_integral< T >::value || std::is_enum< T >::value >::type >
+{
+    size_t operator()( T value ) const { return static_cast< size_t >( hashInteger( static_cast< uint64_t >( value ) ) ); }
+};
+
+template< typename T >
+struct Hash< T* >
+{
+    size_t operator()( const T* pointer ) const { return static_cast< size_t >( hashInteger( reinterpret_cast< uintptr_t >( pointer ) ) ); }
+};
+
+template<>
+struct Hash< std::string > : StringHash {};
+
+#if defined( __cpp_lib_string_view )
+template<>
+struct Hash< std::string_view > : StringHash {};
+#endif
+
+} }
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cobalt { namespace core {
+
+struct Job;
+
+/// Tracks a group of jobs: counts up when a job is run against it and down
+/// when that job finishes.  Wait for it with JobSystem::wait() or make other
+/// jobs depend on it with JobSystem::runAfter().  Don't reuse a counter for a
+/// new batch until the previous one has been waited for.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    ~JobCounter();
+    JobCounter( const JobCounter& ) = delete;
+    JobCounter& operator=( const JobCounter& ) = delete;
+
+    bool isDone() const { return mCount.load( std::memory_order_acquire ) == 0; }
+
+private:
+    friend class JobSystem;
+
+    // Low bits count outstanding jobs; the flag marks queued continuations,
+    // and stays set until they have been handed off, so isDone() (and with
+    // it the counter's owner) waits for that too
+    static const uint32_t kHasContinuations = 1u << 31;
+    static const uint32_t kCountMask = kHasContinuations - 1;
+
+    std::atomic< uint32_t > mCount{ 0 };
+    std::atomic_flag mContinuationLock = ATOMIC_FLAG_INIT;
+    Job* mContinuations = nullptr;        // guarded by mContinuationLock
+    std::atomic< void* > mBackend{ nullptr }; // TBB task_group, when built with TBB
+};
+
+/// A job: a callable stored inline, plus the counter it reports to
+struct Job
+{
+    static const size_t kStorageSize = 48;
+
+    void ( *invoke )( Job& job ) = nullptr;
+    JobCounter* counter = nullptr;
+    Job* next = nullptr;
+    void* owner = nullptr; // free list of the thread that allocated the job
+    std::aligned_storage< kStorageSize >::type storage;
+};
+
+/// Work-stealing job system.
+/// Each worker, and the thread that called startup(), owns a Chase-Lev deque:
+/// it pushes and pops jobs at the bottom (LIFO, cache-warm) while idle threads
+/// steal from the top.  Jobs run from other threads go through a shared
+/// queue.  wait() keeps executing jobs until its counter completes, so
+/// waiting inside a job doesn't tie up a worker.
+///
+/// Built with COBALT_NO_THREADS, or before startup(), jobs simply run inline
+/// when they are submitted.  With COBALT_USE_TBB, TBB's scheduler runs them.
+///
+/// Example:
+///     JobSystem::startup();
+///     JobCounter counter;
+///     for( auto& chunk : chunks )
+///     {
+///         JobSystem::run( [&chunk]() { simulate( chunk ); }, &counter );
+///     }
+///     JobSystem::runAfter( counter, [&]() { gatherResults(); } );
+///     JobSystem::wait( counter );
+class JobSystem
+{
+public:
+    struct Config
+    {
+        unsigned workerCount = 0;  // 0: one per hardware thread, besides the calling thread
+        unsigned dequeCapacity = 4096; // per thread, rounded up to a power of two; jobs overflowing it run inline
+        /// Called on each worker thread, numbered from 0, before it runs
+        /// jobs, e.g. to pin it (see platform::ThreadPlacement); not called
+        /// with TBB
+        std::function< void( unsigned worker ) > onWorkerStart;
+    };
+
+    static void startup();
+    static void startup( const Config& config );
+    /// Finishes all outstanding jobs, then stops the workers
+    static void shutdown();
+    static bool isRunning();
+    static unsigned workerCount();
+
+    /// Queue `function` (a callable taking no arguments, whose captures fit
+    /// in Job::kStorageSize); `counter` may be null.
+    template< typename Function >
+    static void run( Function&& function, JobCounter* counter = nullptr )
+    {
+        submit( makeJob( std::forward< Function >( function ), counter ), nullptr );
+    }
+
+    /// Queue `function` once every job counted by `dependency` has finished
+    template< typename Function >
+    static void runAfter( JobCounter& dependency, Function&& function, JobCounter* counter = nullptr )
+    {
+        submit( makeJob( std::forward< Function >( function ), counter ), &dependency );
+    }
+
+    /// Return once `counter` is done, running queued jobs meanwhile
+    static void wait( JobCounter& counter );
+
+private:
+    template< typename Function >
+    static Job* makeJob( Function&& function, JobCounter* counter )
+    {
+        typedef typename std::decay< Function >::type Callable;
+        static_assert( sizeof( Callable ) <= Job::kStorageSize, "Job captures too large; capture a pointer or reference instead" );
+        static_assert( alignof( Callable ) <= alignof( decltype( Job::storage ) ), "Job captures over-aligned" );
+
+        Job* job = allocateJob();
+        new ( &job->storage ) Callable( std::forward< Function >( function ) );
+        job->invoke = []( Job& j )
+        {
+            Callable& callable = *reinterpret_cast< Callable* >( &j.storage );
+            callable();
+            callable.~Callable();
+        };
+        job->counter = counter;
+        return job;
+    }
+
+    static Job* allocateJob();
+    static void submit( Job* job, JobCounter* dependency );
+    static void enqueue( Job* job );
+    static void execute( Job* job );
+};
+
+} }
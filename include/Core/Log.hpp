@@ -1,7 +1,54 @@
 #pragma once
 
-#define cobalt_assert( cond ) do{ if(!(cond)) { cobalt::Core::Log::assert( #cond, nullptr, __FILE__, __LINE__, __PRETTY_FUNCTION__);  } } while(false)
-#define cobalt_assert_msg( cond, msg ) do{ if(!(cond)) { cobalt::Core::Log::assert( #cond, #msg, __FILE__, __LINE__, __PRETTY_FUNCTION__);  } } while(false)
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <Core/Format.hpp>
+
+/// Compile-time log level floor, set by the COBALT_MIN_LOG_LEVEL CMake option.
+/// The cobalt_log_* macros below this level compile to nothing and never
+/// evaluate their arguments; levels at or above it are still filtered at
+/// runtime by Log::sMinLogLevel.  Format strings must be literals and are
+/// checked against the argument types at compile time.
+#define COBALT_LOG_LEVEL_DEBUG 0
+#define COBALT_LOG_LEVEL_INFO  1
+#define COBALT_LOG_LEVEL_WARN  2
+#define COBALT_LOG_LEVEL_ERROR 3
+#define COBALT_LOG_LEVEL_FATAL 4
+#define COBALT_LOG_LEVEL_OFF   5
+
+#ifndef COBALT_MIN_LOG_LEVEL
+    #define COBALT_MIN_LOG_LEVEL COBALT_LOG_LEVEL_DEBUG
+#endif
+
+#define cobalt_log_at( levelIndex, level, ... ) do{ COBALT_CHECK_FORMAT( __VA_ARGS__ ); if( COBALT_MIN_LOG_LEVEL <= (levelIndex) && cobalt::core::Log::isEnabled( level ) ) { cobalt::core::Log::log( level, __VA_ARGS__ ); } } while(false)
+#define cobalt_log_debug( ... ) cobalt_log_at( COBALT_LOG_LEVEL_DEBUG, cobalt::core::Log::Level::Debug, __VA_ARGS__ )
+#define cobalt_log_info( ... )  cobalt_log_at( COBALT_LOG_LEVEL_INFO,  cobalt::core::Log::Level::Info,  __VA_ARGS__ )
+#define cobalt_log_warn( ... )  cobalt_log_at( COBALT_LOG_LEVEL_WARN,  cobalt::core::Log::Level::Warn,  __VA_ARGS__ )
+#define cobalt_log_error( ... ) cobalt_log_at( COBALT_LOG_LEVEL_ERROR, cobalt::core::Log::Level::Error, __VA_ARGS__ )
+#define cobalt_log_fatal( ... ) cobalt_log_at( COBALT_LOG_LEVEL_FATAL, cobalt::core::Log::Level::Fatal, __VA_ARGS__ )
+
+/// Category-filtered logging, e.g. cobalt_log_cat_debug( Log::Graphics, "%d draws", n );
+/// The category check is a single mask test against Log::sEnabledCategories.
+#define cobalt_log_cat_at( levelIndex, level, category, ... ) do{ COBALT_CHECK_FORMAT( __VA_ARGS__ ); if( COBALT_MIN_LOG_LEVEL <= (levelIndex) && cobalt::core::Log::isEnabled( level, category ) ) { cobalt::core::Log::log( level, __VA_ARGS__ ); } } while(false)
+#define cobalt_log_cat_debug( category, ... ) cobalt_log_cat_at( COBALT_LOG_LEVEL_DEBUG, cobalt::core::Log::Level::Debug, category, __VA_ARGS__ )
+#define cobalt_log_cat_info( category, ... )  cobalt_log_cat_at( COBALT_LOG_LEVEL_INFO,  cobalt::core::Log::Level::Info,  category, __VA_ARGS__ )
+#define cobalt_log_cat_warn( category, ... )  cobalt_log_cat_at( COBALT_LOG_LEVEL_WARN,  cobalt::core::Log::Level::Warn,  category, __VA_ARGS__ )
+#define cobalt_log_cat_error( category, ... ) cobalt_log_cat_at( COBALT_LOG_LEVEL_ERROR, cobalt::core::Log::Level::Error, category, __VA_ARGS__ )
+
+/// Rate-limited logging for per-frame call sites: each call site logs at most
+/// once per `seconds`, and the next line it does log reports how many were
+/// swallowed in between, e.g. cobalt_log_throttled_warn( Log::Frame, 1.0, "slow frame" );
+#define cobalt_log_throttled_at( levelIndex, level, category, seconds, ... ) do{ COBALT_CHECK_FORMAT( __VA_ARGS__ ); if( COBALT_MIN_LOG_LEVEL <= (levelIndex) && cobalt::core::Log::isEnabled( level, category ) ) { static cobalt::core::LogThrottle cobaltLogThrottle( seconds ); uint32_t cobaltLogRepeated; if( cobaltLogThrottle.allow( cobaltLogRepeated ) ) { cobalt::core::Log::logRepeated( level, cobaltLogRepeated, __VA_ARGS__ ); } } } while(false)
+#define cobalt_log_throttled_debug( category, seconds, ... ) cobalt_log_throttled_at( COBALT_LOG_LEVEL_DEBUG, cobalt::core::Log::Level::Debug, category, seconds, __VA_ARGS__ )
+#define cobalt_log_throttled_info( category, seconds, ... )  cobalt_log_throttled_at( COBALT_LOG_LEVEL_INFO,  cobalt::core::Log::Level::Info,  category, seconds, __VA_ARGS__ )
+#define cobalt_log_throttled_warn( category, seconds, ... )  cobalt_log_throttled_at( COBALT_LOG_LEVEL_WARN,  cobalt::core::Log::Level::Warn,  category, seconds, __VA_ARGS__ )
+#define cobalt_log_throttled_error( category, seconds, ... ) cobalt_log_throttled_at( COBALT_LOG_LEVEL_ERROR, cobalt::core::Log::Level::Error, category, seconds, __VA_ARGS__ )
+
+#define cobalt_assert( cond ) do{ if(!(cond)) { cobalt::core::Log::assertFailed( #cond, nullptr, __FILE__, __LINE__, __PRETTY_FUNCTION__);  } } while(false)
+#define cobalt_assert_msg( cond, msg ) do{ if(!(cond)) { cobalt::core::Log::assertFailed( #cond, #msg, __FILE__, __LINE__, __PRETTY_FUNCTION__);  } } while(false)
 
 namespace cobalt
 {
@@ -14,17 +61,103 @@ namespace core
         enum class Level { Debug, Info, Warn, Error, Fatal };
         static Level sMinLogLevel;
 
-        static void log( Level level, const char* msg, ... );
+        /// Category bits for the cobalt_log_cat_* and cobalt_log_throttled_*
+        /// macros.  Bits from UserCategory up are free for applications.
+        enum Category : uint32_t
+        {
+            General      = 1u << 0,
+            Platform     = 1u << 1,
+            Graphics     = 1u << 2,
+            Frame        = 1u << 3,
+            UserCategory = 1u << 16,
+            AllCategories = 0xffffffffu
+        };
+        static uint32_t sEnabledCategories;
+
+        static bool isEnabled( Level level ) { return sMinLogLevel <= level; }
+        static bool isEnabled( Level level, uint32_t category ) { return sMinLogLevel <= level && ( sEnabledCategories & category ) != 0; }
+        static void enableCategories( uint32_t categories ) { sEnabledCategories |= categories; }
+        static void disableCategories( uint32_t categories ) { sEnabledCategories &= ~categories; }
+
+        /// printf-style logging, formatted type-safely by cobalt::core::format
+        template< typename... Args >
+        static void log( Level level, const char* msg, const Args&... args );
+
+        template< typename... Args > static void debug( const char* msg, const Args&... args ) { log( Level::Debug, msg, args... ); }
+        template< typename... Args > static void info( const char* msg, const Args&... args ) { log( Level::Info, msg, args... ); }
+        template< typename... Args > static void warn( const char* msg, const Args&... args ) { log( Level::Warn, msg, args... ); }
+        template< typename... Args > static void error( const char* msg, const Args&... args ) { log( Level::Error, msg, args... ); }
+        template< typename... Args > static void fatal( const char* msg, const Args&... args ) { log( Level::Fatal, msg, args... ); }
+
+        /// log() with a "(repeated N times)" suffix when `repeated` is non-zero
+        template< typename... Args >
+        static void logRepeated( Level level, uint32_t repeated, const char* msg, const Args&... args );
+
+        /// Non-template core of log(): format and emit one line.
+        static void logArgs( Level level, const char* msg, const FormatArg* args, size_t argCount, uint32_t repeated = 0 );
+
+        /// Switch to asynchronous output.
+        /// Each logging thread formats into its own lock-free ring buffer and
+        /// never touches stdio; a background thread drains the rings to output
+        /// (stdout if null).  With COBALT_NO_THREADS there is no background
+        /// thread and the rings are drained by flush(), which the main loop
+        /// calls once per frame.
+        static void startAsync( std::FILE* output = nullptr );
+
+        /// Drain anything still buffered and return to synchronous output.
+        static void stopAsync();
 
-        static void debug( const char* msg, ... );
-        static void info( const char* msg, ... );
-        static void warn( const char* msg, ... );
-        static void error( const char* msg, ... );
-        static void fatal( const char* msg, ... );
+        /// Write out all buffered lines now.  Safe to call from any thread.
+        static void flush();
+
+        static bool isAsync();
+
+        /// Number of lines discarded because a thread's ring buffer was full.
+        static unsigned long droppedCount();
+
+        /// Reports a failed cobalt_assert; also flags the FlightRecorder ring
+        static void assertFailed( const char* condition, const char* message, const char* file, int line, const char* function );
     private:
-        static void assert( const char* condition, const char* message, const char* file, int line, const char* function );
+        friend class BinaryLog;
+        static void commitDeferred( const char* record, size_t size );
+
+    };
+
+    /// Per-call-site rate limiter behind the cobalt_log_throttled_* macros.
+    /// Lock-free; concurrent callers race for the next slot and losers count
+    /// as suppressed.
+    class LogThrottle
+    {
+    public:
+        explicit LogThrottle( double intervalSeconds );
 
+        /// True if the caller should log now.  `suppressed` receives the number
+        /// of calls swallowed since the last one that was allowed.
+        bool allow( uint32_t& suppressed );
+    private:
+        int64_t mIntervalNs;
+        std::atomic< int64_t > mNextAllowedNs{ 0 };
+        std::atomic< uint32_t > mSuppressed{ 0 };
     };
+
+    template< typename... Args >
+    void Log::log( Level level, const char* msg, const Args&... args )
+    {
+        if( isEnabled( level ) )
+        {
+            const FormatArg argArray[] = { FormatArg( args )..., FormatArg() };
+            logArgs( level, msg, argArray, sizeof...( Args ) );
+        }
+    }
+
+    template< typename... Args >
+    void Log::logRepeated( Level level, uint32_t repeated, const char* msg, const Args&... args )
+    {
+        if( isEnabled( level ) )
+        {
+            const FormatArg argArray[] = { FormatArg( args )..., FormatArg() };
+            logArgs( level, msg, argArray, sizeof...( Args ), repeated );
+        }
+    }
 }
 }
-
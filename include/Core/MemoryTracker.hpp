@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// COBALT_MEMORY_TRACKING is set from the CMake option of the same name; when
+// 0 the cobalt_memory_* macros expand to nothing.
+#ifndef COBALT_MEMORY_TRACKING
+    #define COBALT_MEMORY_TRACKING 0
+#endif
+
+#if COBALT_MEMORY_TRACKING
+    /// Report `bytes` allocated for MemoryTracker tag `tag`
+    #define cobalt_memory_allocated( tag, bytes ) cobalt::core::MemoryTracker::recordAllocation( tag, bytes )
+    /// Report `bytes` freed for MemoryTracker tag `tag`
+    #define cobalt_memory_freed( tag, bytes ) cobalt::core::MemoryTracker::recordFree( tag, bytes )
+#else
+    #define cobalt_memory_allocated( tag, bytes ) do{} while(false)
+    #define cobalt_memory_freed( tag, bytes ) do{} while(false)
+#endif
+
+namespace cobalt { namespace core {
+
+/// Per-subsystem memory accounting.
+/// Allocators report what they hand out under a tag; the tracker keeps live
+/// bytes, peak, and allocations per frame for each tag, and warns through
+/// Log when a tag goes over its budget.
+///
+/// Recording only writes counters owned by the calling thread, so it takes
+/// no locks and causes no cache-line contention.  nextFrame(), called by
+/// impl::gblUpdate, adds up every thread's counters once per frame; that is
+/// when peaks are sampled and budgets checked.  Application logs a snapshot
+/// along with its periodic frame time report.
+///
+/// Example:
+///     static const unsigned kMeshes = MemoryTracker::UserTag;
+///     MemoryTracker::setTagName( kMeshes, "Meshes" );
+///     MemoryTracker::setBudget( kMeshes, 256 * 1024 * 1024 );
+///     cobalt_memory_allocated( kMeshes, vertexBytes );
+class MemoryTracker
+{
+public:
+    /// Tags used by Cobalt's allocators.  Tags from UserTag up to kMaxTags
+    /// are free for applications.
+    enum Tag : unsigned
+    {
+        General,
+        FrameArena,
+        ObjectPools,
+        Heaps,
+        UserTag = 8,
+        kMaxTags = 32
+    };
+
+    struct TagStats
+    {
+        unsigned tag = 0;
+        const char* name = nullptr;
+        size_t liveBytes = 0;
+        size_t peakBytes = 0;      // highest liveBytes seen at a frame boundary
+        size_t budget = 0;         // 0 when there is none
+        uint64_t allocations = 0;  // since startup
+        uint64_t frameAllocations = 0; // during the last finished frame
+        uint64_t frameBytes = 0;
+        uint64_t heaviestFrameBytes = 0; // most bytes allocated in one frame, and which
+        uint64_t heaviestFrame = 0;
+    };
+
+    struct Snapshot
+    {
+        uint64_t frame = 0;
+        size_t liveBytes = 0;
+        std::vector< TagStats > tags; // only tags that have seen allocations
+    };
+
+    static void recordAllocation( unsigned tag, size_t bytes );
+    static void recordFree( unsigned tag, size_t bytes );
+
+    static void setTagName( unsigned tag, const char* name );
+    static const char* tagName( unsigned tag );
+    /// Warn when the tag's live bytes exceed `bytes` at the end of a frame; 0 removes the budget
+    static void setBudget( unsigned tag, size_t bytes );
+
+    /// Close the current frame's statistics and check budgets
+    static void nextFrame();
+
+    static Snapshot snapshot();
+    static void logSnapshot();
+};
+
+} }
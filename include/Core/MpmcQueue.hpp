@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Core/Concurrency.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cobalt { namespace core {
+
+/// Bounded lock-free multi-producer, multi-consumer queue (Vyukov).
+/// Each cell carries a sequence number saying whether it is ready to be
+/// written or read for a given lap of the ring, so producers and consumers
+/// each claim a cell with one compare-exchange on their own index and never
+/// wait on each other unless the queue is full or empty.
+///
+/// Example:
+///     MpmcQueue< Request > requests( 1024 );
+///     // any thread:  if( !requests.tryPush( request ) ) { ... full ... }
+///     // any thread:  Request r; while( requests.tryPop( r ) ) { ... }
+template< typename T >
+class MpmcQueue
+{
+public:
+    /// Capacity is rounded up to a power of two
+    explicit MpmcQueue( size_t capacity )
+    {
+        size_t size = 2;
+        while( size < capacity )
+        {
+            size *= 2;
+        }
+        mCells.reset( new Cell[ size ] );
+        for( size_t i = 0; i < size; ++i )
+        {
+            mCells[ i ].sequence.store( i, std::memory_order_relaxed );
+        }
+        mMask = size - 1;
+    }
+
+    ~MpmcQueue()
+    {
+        size_t tail = mEnqueuePosition.load( std::memory_order_relaxed );
+        for( size_t head = mDequeuePosition.load( std::memory_order_relaxed ); head != tail; ++head )
+        {
+            reinterpret_cast< T* >( &mCells[ head & mMask ].storage )->~T();
+        }
+    }
+
+    MpmcQueue( const MpmcQueue& ) = delete;
+    MpmcQueue& operator=( const MpmcQueue& ) = delete;
+
+    size_t capacity() const { return mMask + 1; }
+
+    /// False when full
+    template< typename... Args >
+    bool tryEmplace( Args&&... args )
+    {
+        size_t position = mEnqueuePosition.load( std::memory_order_relaxed );
+        Cell* cell;
+        while( true )
+        {
+            cell = &mCells[ position & mMask ];
+            size_t sequence = cell->sequence.load( std::memory_order_acquire );
+            intptr_t difference = static_cast< intptr_t >( sequence ) - static_cast< intptr_t >( position );
+            if( difference == 0 )
+            {
+                if( mEnqueuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if( difference < 0 )
+            {
+                return false;
+            }
+            else
+            {
+                position = mEnqueuePosition.load( std::memory_order_relaxed );
+            }
+        }
+        new ( &cell->storage ) T( std::forward< Args >( args )... );
+        cell->sequence.store( position + 1, std::memory_order_release );
+        return true;
+    }
+
+    bool tryPush( const T& item ) { return tryEmplace( item ); }
+    bool tryPush( T&& item ) { return tryEmplace( std::move( item ) ); }
+
+    /// False when empty
+    bool tryPop( T& out )
+    {
+        size_t position = mDequeuePosition.load( std::memory_order_relaxed );
+        Cell* cell;
+        while( true )
+        {
+            cell = &mCells[ position & mMask ];
+            size_t sequence = cell->sequence.load( std::memory_order_acquire );
+            intptr_t difference = static_cast< intptr_t >( sequence ) - static_cast< intptr_t >( position + 1 );
+            if( difference == 0 )
+            {
+                if( mDequeuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if( difference < 0 )
+            {
+                return false;
+            }
+            else
+            {
+                position = mDequeuePosition.load( std::memory_order_relaxed );
+            }
+        }
+        T& item = *reinterpret_cast< T* >( &cell->storage );
+        out = std::move( item );
+        item.~T();
+        cell->sequence.store( position + mMask + 1, std::memory_order_release );
+        return true;
+    }
+
+    /// Pushes items in order until one doesn't fit; returns how many went in.
+    /// Other producers' items may interleave.
+    size_t pushBatch( const T* items, size_t count )
+    {
+        size_t pushed = 0;
+        while( pushed < count && tryPush( items[ pushed ] ) )
+        {
+            ++pushed;
+        }
+        return pushed;
+    }
+
+    /// Pops up to `maxCount` items into `out` and returns how many
+    size_t popBatch( T* out, size_t maxCount )
+    {
+        size_t popped = 0;
+        while( popped < maxCount && tryPop( out[ popped ] ) )
+        {
+            ++popped;
+        }
+        return popped;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic< size_t > sequence;
+        typename std::aligned_storage< sizeof( T ), alignof( T ) >::type storage;
+    };
+
+    std::unique_ptr< Cell[] > mCells;
+    size_t mMask = 0;
+    char mPadding0[ kCacheLineSize ];
+    std::atomic< size_t > mEnqueuePosition{ 0 };
+    char mPadding1[ kCacheLineSize ];
+    std::atomic< size_t > mDequeuePosition{ 0 };
+    char mPadding2[ kCacheLineSize ];
+};
+
+} }
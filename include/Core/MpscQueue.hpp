@@ -0,0 +1,123 @@
+#pragma once
+
+#include <Core/Concurrency.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+namespace cobalt { namespace core {
+
+/// Link embedded in the items of an MpscQueue
+struct MpscNode
+{
+    std::atomic< MpscNode* > mpscNext{ nullptr };
+};
+
+/// Unbounded intrusive multi-producer, single-consumer queue (Vyukov).
+/// Items derive from MpscNode, so pushing never allocates; the queue holds
+/// pointers and never owns the items.  Any thread may push, a single
+/// exchange each (or per batch); only one thread may pop.
+///
+/// pop() can report empty while a producer is between its exchange and
+/// its link store; the item shows up on a later pop().
+///
+/// Example:
+///     struct LoadedAsset : MpscNode { ... };
+///     MpscQueue< LoadedAsset > loaded;
+///     // loader threads:  loaded.push( asset );
+///     // main thread:     while( LoadedAsset* asset = loaded.pop() ) { ... }
+template< typename T >
+class MpscQueue
+{
+public:
+    MpscQueue() : mHead( &mStub ), mTail( &mStub ) {}
+
+    MpscQueue( const MpscQueue& ) = delete;
+    MpscQueue& operator=( const MpscQueue& ) = delete;
+
+    void push( T* item )
+    {
+        pushChain( item, item );
+    }
+
+    /// Push `count` items in order with one exchange
+    void pushBatch( T* const* items, size_t count )
+    {
+        if( count == 0 )
+        {
+            return;
+        }
+        for( size_t i = 0; i + 1 < count; ++i )
+        {
+            static_cast< MpscNode* >( items[ i ] )->mpscNext.store( items[ i + 1 ], std::memory_order_relaxed );
+        }
+        pushChain( items[ 0 ], items[ count - 1 ] );
+    }
+
+    /// Consumer only; null when empty
+    T* pop()
+    {
+        MpscNode* tail = mTail;
+        MpscNode* next = tail->mpscNext.load( std::memory_order_acquire );
+        if( tail == &mStub )
+        {
+            if( !next )
+            {
+                return nullptr;
+            }
+            mTail = next;
+            tail = next;
+            next = next->mpscNext.load( std::memory_order_acquire );
+        }
+        if( next )
+        {
+            mTail = next;
+            return static_cast< T* >( tail );
+        }
+        if( tail != mHead.load( std::memory_order_acquire ) )
+        {
+            // A push is in flight
+            return nullptr;
+        }
+        // tail is the last item; put the stub behind it so it can be taken
+        pushChain( &mStub, &mStub );
+        next = tail->mpscNext.load( std::memory_order_acquire );
+        if( next )
+        {
+            mTail = next;
+            return static_cast< T* >( tail );
+        }
+        return nullptr;
+    }
+
+    /// Consumer only; pops up to `maxCount` items into `out` and returns how many
+    size_t popBatch( T** out, size_t maxCount )
+    {
+        size_t count = 0;
+        while( count < maxCount )
+        {
+            T* item = pop();
+            if( !item )
+            {
+                break;
+            }
+            out[ count++ ] = item;
+        }
+        return count;
+    }
+
+private:
+    void pushChain( MpscNode* first, MpscNode* last )
+    {
+        last->mpscNext.store( nullptr, std::memory_order_relaxed );
+        MpscNode* previous = mHead.exchange( last, std::memory_order_acq_rel );
+        previous->mpscNext.store( first, std::memory_order_release );
+    }
+
+    std::atomic< MpscNode* > mHead; // producers
+    char mPadding[ kCacheLineSize ];
+    MpscNode* mTail;                // consumer
+    MpscNode mStub;
+};
+
+} }
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <Core/MemoryTracker.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cobalt { namespace core {
+
+/// Allocator for blocks of a single size, for objects that are created and
+/// destroyed all the time (entities, particle emitters, resource records).
+///
+/// Blocks are carved out of slabs of blocksPerSlab, and a free block holds
+/// the link to the next free one, so the pool needs no memory of its own
+/// per block.  Each thread keeps a small cache of free blocks and only
+/// touches the shared free list, under a spinlock, to move a batch of
+/// kCacheBatch in or out; blocks freed on one thread can be reused on any.
+///
+/// With isPoisoning, freed blocks are filled with a pattern that is checked
+/// when they are handed out again, catching writes after free; it is on by
+/// default in builds without NDEBUG.
+///
+/// Memory goes back to the system only when the pool is destroyed.
+class FixedSizePool
+{
+public:
+    static const size_t kCacheBatch = 32;
+
+    struct Config
+    {
+        size_t blockSize = 0;
+        size_t alignment = alignof( std::max_align_t );
+        size_t blocksPerSlab = 256;
+        unsigned memoryTag = MemoryTracker::ObjectPools;
+#ifdef NDEBUG
+        bool isPoisoning = false;
+#else
+        bool isPoisoning = true;
+#endif
+    };
+
+    /// Blocks in use, where blocks sitting in threads' caches count as used
+    struct Stats
+    {
+        size_t blockSize = 0;
+        size_t slabCount = 0;
+        size_t capacity = 0;  // blocks in all slabs
+        size_t used = 0;
+        size_t peakUsed = 0;
+    };
+
+    explicit FixedSizePool( const Config& config );
+    ~FixedSizePool();
+    FixedSizePool( const FixedSizePool& ) = delete;
+    FixedSizePool& operator=( const FixedSizePool& ) = delete;
+
+    void* allocate();
+    void deallocate( void* block );
+
+    size_t blockSize() const { return mBlockSize; }
+    Stats stats() const;
+
+    /// Return the calling thread's cached blocks to the shared free list
+    void flushThreadCache();
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+    friend struct PoolThreadCaches;
+
+    void refill( FreeBlock*& head, size_t& count );
+    void release( FreeBlock* head, size_t count );
+    void addSlab();
+    void poison( void* block ) const;
+    void checkPoison( void* block ) const;
+
+    size_t mBlockSize;
+    size_t mAlignment;
+    size_t mBlocksPerSlab;
+    bool mIsPoisoning;
+    unsigned mMemoryTag;
+    uint64_t mId; // tells pools apart in the per-thread caches
+
+    mutable std::atomic_flag mLock = ATOMIC_FLAG_INIT;
+    // Guarded by mLock
+    FreeBlock* mFreeList = nullptr;
+    std::vector< void* > mSlabs;
+    size_t mFreeCount = 0; // blocks on mFreeList
+    size_t mPeakUsed = 0;
+};
+
+/// Typed front end for FixedSizePool.
+///
+/// Example:
+///     ObjectPool< Emitter > emitters;
+///     Emitter* emitter = emitters.create( position, rate );
+///     ...
+///     emitters.destroy( emitter );
+template< typename T >
+class ObjectPool
+{
+public:
+    explicit ObjectPool( size_t blocksPerSlab = 256, unsigned memoryTag = MemoryTracker::ObjectPools )
+        : mPool( makeConfig( blocksPerSlab, memoryTag ) )
+    {
+    }
+
+    template< typename... Args >
+    T* create( Args&&... args )
+    {
+        return new ( mPool.allocate() ) T( std::forward< Args >( args )... );
+    }
+
+    void destroy( T* object )
+    {
+        if( object )
+        {
+            object->~T();
+            mPool.deallocate( object );
+        }
+    }
+
+    FixedSizePool::Stats stats() const { return mPool.stats(); }
+    void flushThreadCache() { mPool.flushThreadCache(); }
+
+private:
+    static FixedSizePool::Config makeConfig( size_t blocksPerSlab, unsigned memoryTag )
+    {
+        FixedSizePool::Config config;
+        config.blockSize = sizeof( T );
+        config.alignment = alignof( T );
+        config.blocksPerSlab = blocksPerSlab;
+        config.memoryTag = memoryTag;
+        return config;
+    }
+
+    FixedSizePool mPool;
+};
+
+} }
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <Core/JobSystem.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/// Data-parallel algorithms over index ranges and contiguous arrays, run on
+/// the JobSystem.
+///
+/// Work is cut into chunks of `grain` elements; with grain 0 (the default)
+/// it is picked from the element count alone, aiming for about
+/// kParallelTargetChunks chunks of at least kParallelMinGrain elements.
+/// Chunking never depends on the number of workers or on timing, and
+/// partial results are combined in chunk order, so results are identical
+/// from run to run and machine to machine, including for floating point
+/// reductions.  Pass a smaller grain for expensive per-element work.
+///
+/// Without a running JobSystem (or built with COBALT_NO_THREADS) the same
+/// chunks are processed serially on the calling thread.
+///
+/// Example:
+///     parallelFor( 0, particles.size(), [&]( size_t i ) { integrate( particles[ i ], dt ); } );
+///     double energy = parallelReduce( 0, particles.size(), 0.0,
+///         [&]( double sum, size_t i ) { return sum + kineticEnergy( particles[ i ] ); },
+///         []( double a, double b ) { return a + b; } );
+namespace cobalt { namespace core {
+
+static const size_t kParallelTargetChunks = 256;
+static const size_t kParallelMinGrain = 64;
+
+/// The chunk size used for `count` elements when `grain` is 0
+inline size_t parallelGrain( size_t count, size_t grain = 0 )
+{
+    if( grain > 0 )
+    {
+        return grain;
+    }
+    size_t perChunk = ( count + kParallelTargetChunks - 1 ) / kParallelTargetChunks;
+    return perChunk > kParallelMinGrain ? perChunk : kParallelMinGrain;
+}
+
+namespace detail {
+
+    template< typename Function >
+    struct ChunkContext
+    {
+        const Function* function;
+        size_t begin;
+        size_t end;
+        size_t grain;
+    };
+
+    /// Calls function( chunkIndex, chunkBegin, chunkEnd ) for each chunk of
+    /// [begin, end) and returns once all have run
+    template< typename Function >
+    void forEachChunk( size_t begin, size_t end, size_t grain, const Function& function )
+    {
+        if( end <= begin )
+        {
+            return;
+        }
+        size_t chunkCount = ( end - begin + grain - 1 ) / grain;
+        if( chunkCount == 1 || !JobSystem::isRunning() )
+        {
+            for( size_t chunk = 0; chunk < chunkCount; ++chunk )
+            {
+                size_t chunkBegin = begin + chunk * grain;
+                function( chunk, chunkBegin, std::min( chunkBegin + grain, end ) );
+            }
+            return;
+        }
+
+        ChunkContext< Function > context{ &function, begin, end, grain };
+        const ChunkContext< Function >* shared = &context;
+        JobCounter counter;
+        for( size_t chunk = 1; chunk < chunkCount; ++chunk )
+        {
+            JobSystem::run( [shared, chunk]()
+            {
+                size_t chunkBegin = shared->begin + chunk * shared->grain;
+                ( *shared->function )( chunk, chunkBegin, std::min( chunkBegin + shared->grain, shared->end ) );
+            }, &counter );
+        }
+        function( 0, begin, std::min( begin + grain, end ) );
+        JobSystem::wait( counter );
+    }
+
+    /// Runs `first` as a job and `second` here, returning once both are done
+    template< typename First, typename Second >
+    void forkJoin( const First& first, const Second& second )
+    {
+        if( !JobSystem::isRunning() )
+        {
+            first();
+            second();
+            return;
+        }
+        const First* shared = &first;
+        JobCounter counter;
+        JobSystem::run( [shared]() { ( *shared )(); }, &counter );
+        second();
+        JobSystem::wait( counter );
+    }
+
+    /// Stable merge of the sorted runs [a, aEnd) and [b, bEnd) into out,
+    /// moving elements; large merges are split around a pivot and run in
+    /// parallel
+    template< typename T, typename Compare >
+    void parallelMerge( T* a, T* aEnd, T* b, T* bEnd, T* out, const Compare& compare, size_t grain )
+    {
+        size_t aCount = aEnd - a;
+        size_t bCount = bEnd - b;
+        if( aCount + bCount <= grain )
+        {
+            std::merge( std::make_move_iterator( a ), std::make_move_iterator( aEnd ),
+                        std::make_move_iterator( b ), std::make_move_iterator( bEnd ), out, compare );
+            return;
+        }
+        // Pivot on the middle of the longer run.  Ties go left for a and
+        // right for b, keeping a's elements first as std::merge does
+        T* aSplit;
+        T* bSplit;
+        if( aCount >= bCount )
+        {
+            aSplit = a + aCount / 2;
+            bSplit = std::lower_bound( b, bEnd, *aSplit, compare );
+        }
+        else
+        {
+            bSplit = b + bCount / 2;
+            aSplit = std::upper_bound( a, aEnd, *bSplit, compare );
+        }
+        T* outSplit = out + ( aSplit - a ) + ( bSplit - b );
+        forkJoin( [=, &compare]() { parallelMerge( a, aSplit, b, bSplit, out, compare, grain ); },
+                  [=, &compare]() { parallelMerge( aSplit, aEnd, bSplit, bEnd, outSplit, compare, grain ); } );
+    }
+
+    /// Sorts [data, data + count), leaving the result in data or, if
+    /// intoScratch, in the matching part of scratch
+    template< typename T, typename Compare >
+    void parallelMergeSort( T* data, T* scratch, size_t count, bool intoScratch, const Compare& compare, size_t grain )
+    {
+        if( count <= grain )
+        {
+            std::sort( data, data + count, compare );
+            if( intoScratch )
+            {
+                std::move( data, data + count, scratch );
+            }
+            return;
+        }
+        // Sort the halves into the other buffer, then merge them back
+        size_t half = count / 2;
+        forkJoin( [=, &compare]() { parallelMergeSort( data, scratch, half, !intoScratch, compare, grain ); },
+                  [=, &compare]() { parallelMergeSort( data + half, scratch + half, count - half, !intoScratch, compare, grain ); } );
+        T* source = intoScratch ? data : scratch;
+        T* destination = intoScratch ? scratch : data;
+        parallelMerge( source, source + half, source + half, source + count, destination, compare, grain );
+    }
+
+}
+
+/// Calls function( i ) for every i in [begin, end)
+template< typename Function >
+void parallelFor( size_t begin, size_t end, const Function& function, size_t grain = 0 )
+{
+    detail::forEachChunk( begin, end, parallelGrain( end > begin ? end - begin : 0, grain ),
+        [&function]( size_t, size_t chunkBegin, size_t chunkEnd )
+        {
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                function( i );
+            }
+        } );
+}
+
+/// Folds [begin, end) as accumulate( accumulate( identity, i ), i + 1 )...
+/// within each chunk, then combines the chunk results in order, starting
+/// from identity.  `combine` must be associative and `identity` its
+/// identity element; T must be default constructible.
+template< typename T, typename Accumulate, typename Combine >
+T parallelReduce( size_t begin, size_t end, const T& identity, const Accumulate& accumulate, const Combine& combine, size_t grain = 0 )
+{
+    size_t count = end > begin ? end - begin : 0;
+    grain = parallelGrain( count, grain );
+    size_t chunkCount = ( count + grain - 1 ) / grain;
+    // Not std::vector, whose bool specialization has no data()
+    std::unique_ptr< T[] > partials( new T[ chunkCount ] );
+    T* partial = partials.get();
+    detail::forEachChunk( begin, end, grain,
+        [&]( size_t chunk, size_t chunkBegin, size_t chunkEnd )
+        {
+            T value = identity;
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                value = accumulate( value, i );
+            }
+            partial[ chunk ] = value;
+        } );
+    T result = identity;
+    for( size_t chunk = 0; chunk < chunkCount; ++chunk )
+    {
+        result = combine( result, partial[ chunk ] );
+    }
+    return result;
+}
+
+/// Inclusive prefix scan: out[ i ] = in[ 0 ] op in[ 1 ] op ... op in[ i ].
+/// `op` must be associative with identity `identity`; out may equal in.
+/// T must be default constructible.
+template< typename T, typename Op >
+void parallelScan( const T* in, T* out, size_t count, const T& identity, const Op& op, size_t grain = 0 )
+{
+    grain = parallelGrain( count, grain );
+    size_t chunkCount = ( count + grain - 1 ) / grain;
+    if( chunkCount <= 1 )
+    {
+        T running = identity;
+        for( size_t i = 0; i < count; ++i )
+        {
+            running = op( running, in[ i ] );
+            out[ i ] = running;
+        }
+        return;
+    }
+
+    // Total each chunk, scan the totals, then scan each chunk from its offset
+    std::unique_ptr< T[] > offsets( new T[ chunkCount ] );
+    T* offset = offsets.get();
+    detail::forEachChunk( 0, count, grain,
+        [&]( size_t chunk, size_t chunkBegin, size_t chunkEnd )
+        {
+            T total = identity;
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                total = op( total, in[ i ] );
+            }
+            offset[ chunk ] = total;
+        } );
+    T running = identity;
+    for( size_t chunk = 0; chunk < chunkCount; ++chunk )
+    {
+        T total = offset[ chunk ];
+        offset[ chunk ] = running;
+        running = op( running, total );
+    }
+    detail::forEachChunk( 0, count, grain,
+        [&]( size_t chunk, size_t chunkBegin, size_t chunkEnd )
+        {
+            T value = offset[ chunk ];
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                value = op( value, in[ i ] );
+                out[ i ] = value;
+            }
+        } );
+}
+
+/// Sorts [first, last) with a parallel merge sort.  Not stable, but the
+/// order of equivalent elements depends only on the input and grain.  Uses
+/// a temporary copy of the range, so T must be copyable.
+template< typename T, typename Compare >
+void parallelSort( T* first, T* last, const Compare& compare, size_t grain = 0 )
+{
+    size_t count = last - first;
+    // Leaves are sorted serially, so they need to be bigger than a loop body
+    grain = grain > 0 ? grain : std::max( parallelGrain( count ), size_t( 4096 ) );
+    if( count <= grain )
+    {
+        std::sort( first, last, compare );
+        return;
+    }
+    std::vector< T > scratch( first, last );
+    detail::parallelMergeSort( first, scratch.data(), count, false, compare, grain );
+}
+
+template< typename T >
+void parallelSort( T* first, T* last )
+{
+    parallelSort( first, last, std::less< T >() );
+}
+
+/// Stable partition: moves the elements satisfying `predicate` to the
+/// front, keeping the relative order within both groups, and returns the
+/// partition point.  `predicate` is called exactly once per element.
+template< typename T, typename Predicate >
+T* parallelPartition( T* first, T* last, const Predicate& predicate, size_t grain = 0 )
+{
+    size_t count = last - first;
+    grain = parallelGrain( count, grain );
+    size_t chunkCount = ( count + grain - 1 ) / grain;
+    if( chunkCount <= 1 || !JobSystem::isRunning() )
+    {
+        return std::stable_partition( first, last, predicate );
+    }
+
+    // Evaluate and count per chunk, scan the counts into destinations, then
+    // scatter into a copy and move back
+    std::vector< uint8_t > matches( count );
+    std::vector< size_t > matchCounts( chunkCount );
+    uint8_t* match = matches.data();
+    size_t* matchCount = matchCounts.data();
+    detail::forEachChunk( 0, count, grain,
+        [&]( size_t chunk, size_t chunkBegin, size_t chunkEnd )
+        {
+            size_t n = 0;
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                match[ i ] = predicate( first[ i ] ) ? 1 : 0;
+                n += match[ i ];
+            }
+            matchCount[ chunk ] = n;
+        } );
+    std::vector< size_t > matchOffsets( chunkCount );
+    size_t* matchOffset = matchOffsets.data();
+    size_t totalMatches = 0;
+    for( size_t chunk = 0; chunk < chunkCount; ++chunk )
+    {
+        matchOffset[ chunk ] = totalMatches;
+        totalMatches += matchCount[ chunk ];
+    }
+
+    std::vector< T > scratch( std::make_move_iterator( first ), std::make_move_iterator( last ) );
+    T* source = scratch.data();
+    detail::forEachChunk( 0, count, grain,
+        [&]( size_t chunk, size_t chunkBegin, size_t chunkEnd )
+        {
+            T* matched = first + matchOffset[ chunk ];
+            T* unmatched = first + totalMatches + ( chunkBegin - matchOffset[ chunk ] );
+            for( size_t i = chunkBegin; i < chunkEnd; ++i )
+            {
+                if( match[ i ] )
+                {
+                    *matched++ = std::move( source[ i ] );
+                }
+                else
+                {
+                    *unmatched++ = std::move( source[ i ] );
+                }
+            }
+        } );
+    return first + totalMatches;
+}
+
+} }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Core/Clock.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// COBALT_PROFILER is set from the CMake option of the same name; when 0 the
+// cobalt_profile_* macros expand to nothing.
+#ifndef COBALT_PROFILER
+    #define COBALT_PROFILER 0
+#endif
+
+#define COBALT_PROFILE_CONCAT_IMPL( a, b ) a##b
+#define COBALT_PROFILE_CONCAT( a, b ) COBALT_PROFILE_CONCAT_IMPL( a, b )
+
+#if COBALT_PROFILER
+    /// Times the rest of the enclosing scope; `name` must be a string literal
+    #define cobalt_profile_zone( name ) cobalt::core::ProfileZone COBALT_PROFILE_CONCAT( cobaltProfileZone, __LINE__ )( "" name )
+    /// Labels the calling thread in exported traces; `name` must be a string literal
+    #define cobalt_profile_thread_name( name ) cobalt::core::Profiler::setThreadName( "" name )
+#else
+    #define cobalt_profile_zone( name ) do{} while(false)
+    #define cobalt_profile_thread_name( name ) do{} while(false)
+#endif
+
+namespace cobalt { namespace core {
+
+/// Scoped-zone CPU profiler.
+/// Zones are recorded into a per-thread ring buffer, so the hot path takes no
+/// locks: a disabled check on entry and, when capturing, two clock reads and
+/// one store on exit.  Nesting is implied by the zone times.  Export a capture
+/// as Chrome trace-event JSON and open it in chrome://tracing or Perfetto.
+///
+/// Example:
+///     Profiler::start();
+///     {
+///         cobalt_profile_zone( "Particles::simulate" );
+///         ...
+///     }
+///     Profiler::stop();
+///     Profiler::writeChromeTrace( "capture.json" );
+class Profiler
+{
+public:
+    /// Zones kept per thread; older ones are overwritten.
+    static const size_t kEventsPerThread = 64 * 1024;
+
+    /// Begin a capture; zones recorded before this are discarded.
+    static void start();
+    /// Stop recording zones.  Export after stop() so threads aren't still writing.
+    static void stop();
+    static bool isCapturing() { return sIsCapturing.load( std::memory_order_relaxed ); }
+
+    static bool writeChromeTrace( const char* path );
+    static bool writeChromeTrace( std::FILE* out );
+
+    static void setThreadName( const char* name );
+
+    /// Used by ProfileZone; times are Clock::nowNs()
+    static void record( const char* name, int64_t startNs, int64_t endNs );
+
+private:
+    static std::atomic< bool > sIsCapturing;
+};
+
+#if COBALT_PROFILER
+class ProfileZone
+{
+public:
+    explicit ProfileZone( const char* name )
+    : mName( name ),
+      mStartNs( Profiler::isCapturing() ? Clock::nowNs() : 0 )
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if( mStartNs )
+        {
+            Profiler::record( mName, mStartNs, Clock::nowNs() );
+        }
+    }
+
+    ProfileZone( const ProfileZone& ) = delete;
+    ProfileZone& operator=( const ProfileZone& ) = delete;
+
+private:
+    const char* mName;
+    int64_t mStartNs;
+};
+#endif
+
+} }
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <Core/Concurrency.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cobalt { namespace core {
+
+/// Index plus generation packed in one integer.  Generations start at 1, so
+/// a default-constructed handle is null and never valid.
+template< typename Storage, unsigned IndexBits >
+class SlotHandle
+{
+public:
+    typedef Storage StorageType;
+    static const unsigned kIndexBits = IndexBits;
+    static const unsigned kGenerationBits = sizeof( Storage ) * 8 - IndexBits;
+    static const Storage kMaxIndex = ( Storage( 1 ) << IndexBits ) - 1;
+    static const Storage kMaxGeneration = ( Storage( 1 ) << kGenerationBits ) - 1;
+
+    SlotHandle() = default;
+    SlotHandle( Storage index, Storage generation ) : mValue( ( generation << IndexBits ) | index ) {}
+
+    Storage index() const { return mValue & kMaxIndex; }
+    Storage generation() const { return mValue >> IndexBits; }
+    Storage value() const { return mValue; }
+    bool isNull() const { return mValue == 0; }
+
+    static SlotHandle fromValue( Storage value ) { SlotHandle handle; handle.mValue = value; return handle; }
+
+    bool operator==( const SlotHandle& other ) const { return mValue == other.mValue; }
+    bool operator!=( const SlotHandle& other ) const { return mValue != other.mValue; }
+    bool operator<( const SlotHandle& other ) const { return mValue < other.mValue; }
+
+private:
+    Storage mValue = 0;
+};
+
+/// 1M slots, each reusable 4095 times
+typedef SlotHandle< uint32_t, 20 > SlotHandle32;
+/// 4G slots, each reusable 4G times
+typedef SlotHandle< uint64_t, 32 > SlotHandle64;
+
+/// Container handing out generational handles instead of pointers.
+///
+/// Values live packed in one vector, so iterating them is a linear scan;
+/// erase() moves the last value into the hole.  A sparse slot array maps
+/// handle indices to positions in it, and each slot's generation goes up
+/// when its value is erased, so a stale handle is caught by one compare.
+/// Insert, erase and lookup are O(1).  Pointers and iterators are
+/// invalidated by insert and erase; handles stay valid until their value
+/// is erased.  A slot whose generation runs out is retired, not reused.
+///
+/// Example:
+///     SlotMap< Mesh > meshes;
+///     SlotHandle64 cube = meshes.insert( makeCube() );
+///     if( Mesh* mesh = meshes.get( cube ) ) { ... }
+///     for( Mesh& mesh : meshes ) { ... }
+///     meshes.erase( cube );   // meshes.get( cube ) is now null
+template< typename T, typename Handle = SlotHandle64 >
+class SlotMap
+{
+public:
+    typedef typename Handle::StorageType Storage;
+    typedef typename std::vector< T >::iterator iterator;
+    typedef typename std::vector< T >::const_iterator const_iterator;
+
+    template< typename... Args >
+    Handle emplace( Args&&... args )
+    {
+        Storage slotIndex;
+        if( mFreeHead != kNone )
+        {
+            slotIndex = mFreeHead;
+            mFreeHead = mSlots[ slotIndex ].position;
+        }
+        else
+        {
+            slotIndex = static_cast< Storage >( mSlots.size() );
+            if( slotIndex > Handle::kMaxIndex )
+            {
+                return Handle();
+            }
+            mSlots.push_back( Slot() );
+        }
+        Slot& slot = mSlots[ slotIndex ];
+        slot.position = static_cast< Storage >( mValues.size() );
+        mValues.emplace_back( std::forward< Args >( args )... );
+        mSlotOfValue.push_back( slotIndex );
+        return Handle( slotIndex, slot.generation );
+    }
+
+    Handle insert( const T& value ) { return emplace( value ); }
+    Handle insert( T&& value ) { return emplace( std::move( value ) ); }
+
+    /// False if the handle was stale
+    bool erase( Handle handle )
+    {
+        if( !contains( handle ) )
+        {
+            return false;
+        }
+        Slot& slot = mSlots[ handle.index() ];
+        Storage position = slot.position;
+        Storage last = static_cast< Storage >( mValues.size() - 1 );
+        if( position != last )
+        {
+            mValues[ position ] = std::move( mValues[ last ] );
+            mSlotOfValue[ position ] = mSlotOfValue[ last ];
+            mSlots[ mSlotOfValue[ position ] ].position = position;
+        }
+        mValues.pop_back();
+        mSlotOfValue.pop_back();
+
+        if( slot.generation == Handle::kMaxGeneration )
+        {
+            // Reusing it would make old handles valid again
+            slot.generation = 0;
+            slot.position = kNone;
+            return true;
+        }
+        ++slot.generation;
+        slot.position = mFreeHead;
+        mFreeHead = handle.index();
+        return true;
+    }
+
+    bool contains( Handle handle ) const
+    {
+        Storage index = handle.index();
+        return index < mSlots.size() && mSlots[ index ].generation == handle.generation() && handle.generation() != 0;
+    }
+
+    /// Null for stale handles
+    T* get( Handle handle ) { return contains( handle ) ? &mValues[ mSlots[ handle.index() ].position ] : nullptr; }
+    const T* get( Handle handle ) const { return contains( handle ) ? &mValues[ mSlots[ handle.index() ].position ] : nullptr; }
+
+    /// Handle of the value at `position` in iteration order
+    Handle handleAt( size_t position ) const
+    {
+        Storage slotIndex = mSlotOfValue[ position ];
+        return Handle( slotIndex, mSlots[ slotIndex ].generation );
+    }
+
+    size_t size() const { return mValues.size(); }
+    bool empty() const { return mValues.empty(); }
+    T* data() { return mValues.data(); }
+    const T* data() const { return mValues.data(); }
+
+    iterator begin() { return mValues.begin(); }
+    iterator end() { return mValues.end(); }
+    const_iterator begin() const { return mValues.begin(); }
+    const_iterator end() const { return mValues.end(); }
+
+    void reserve( size_t count )
+    {
+        mValues.reserve( count );
+        mSlotOfValue.reserve( count );
+        mSlots.reserve( count );
+    }
+
+    /// Erase everything; every outstanding handle becomes stale
+    void clear()
+    {
+        while( !mValues.empty() )
+        {
+            erase( handleAt( mValues.size() - 1 ) );
+        }
+    }
+
+private:
+    static const Storage kNone = ~Storage( 0 );
+
+    struct Slot
+    {
+        Storage position = kNone; // in mValues while live, next free slot while free
+        Storage generation = 1;   // 0 once retired
+    };
+
+    std::vector< T > mValues;
+    std::vector< Storage > mSlotOfValue; // parallel to mValues
+    std::vector< Slot > mSlots;
+    Storage mFreeHead = kNone;
+};
+
+/// Lock-free handle allocation, for systems that create and destroy
+/// handles from many threads and keep their data in their own arrays
+/// indexed by handle.index().  Capacity is fixed up front.
+///
+/// allocate() pops a slot off a free stack (tagged against ABA) or takes a
+/// never-used one; deallocate() bumps the slot's generation with a
+/// compare-exchange, so a second deallocate() of the same handle fails.
+///
+/// Example:
+///     ConcurrentHandleAllocator< SlotHandle32 > ids( 65536 );
+///     SlotHandle32 id = ids.allocate();   // any thread
+///     sounds[ id.index() ] = ...;
+///     ids.deallocate( id );               // any thread
+template< typename Handle = SlotHandle64 >
+class ConcurrentHandleAllocator
+{
+public:
+    typedef typename Handle::StorageType Storage;
+
+    explicit ConcurrentHandleAllocator( size_t capacity )
+        : mCapacity( capacity < size_t( maxCapacity() ) ? capacity : size_t( maxCapacity() ) )
+        , mGenerations( new std::atomic< Storage >[ mCapacity ] )
+        , mNextFree( new std::atomic< uint32_t >[ mCapacity ] )
+    {
+        for( size_t i = 0; i < mCapacity; ++i )
+        {
+            mGenerations[ i ].store( 1, std::memory_order_relaxed );
+            mNextFree[ i ].store( kNone, std::memory_order_relaxed );
+        }
+    }
+
+    ConcurrentHandleAllocator( const ConcurrentHandleAllocator& ) = delete;
+    ConcurrentHandleAllocator& operator=( const ConcurrentHandleAllocator& ) = delete;
+
+    /// Null handle when every slot is in use
+    Handle allocate()
+    {
+        uint64_t head = mFreeHead.load( std::memory_order_acquire );
+        while( static_cast< uint32_t >( head ) != kNone )
+        {
+            uint32_t index = static_cast< uint32_t >( head );
+            uint64_t next = ( ( head >> 32 ) + 1 ) << 32 | mNextFree[ index ].load( std::memory_order_relaxed );
+            if( mFreeHead.compare_exchange_weak( head, next, std::memory_order_acquire, std::memory_order_acquire ) )
+            {
+                return Handle( index, mGenerations[ index ].load( std::memory_order_relaxed ) );
+            }
+        }
+        size_t index = mNextUnused.fetch_add( 1, std::memory_order_relaxed );
+        if( index >= mCapacity )
+        {
+            return Handle();
+        }
+        return Handle( static_cast< Storage >( index ), 1 );
+    }
+
+    /// False if the handle was stale, already deallocated or never allocated
+    bool deallocate( Handle handle )
+    {
+        Storage index = handle.index();
+        // A slot allocate() hasn't reached yet would otherwise go on the free
+        // stack and later be handed out from both
+        if( index >= mCapacity || index >= mNextUnused.load( std::memory_order_relaxed ) || handle.generation() == 0 )
+        {
+            return false;
+        }
+        Storage generation = handle.generation();
+        bool isRetiring = generation == Handle::kMaxGeneration;
+        if( !mGenerations[ index ].compare_exchange_strong( generation, isRetiring ? 0 : generation + 1, std::memory_order_acq_rel ) )
+        {
+            return false;
+        }
+        if( isRetiring )
+        {
+            return true;
+        }
+        uint64_t head = mFreeHead.load( std::memory_order_relaxed );
+        uint64_t next;
+        do
+        {
+            mNextFree[ index ].store( static_cast< uint32_t >( head ), std::memory_order_relaxed );
+            next = ( ( head >> 32 ) + 1 ) << 32 | static_cast< uint32_t >( index );
+        }
+        while( !mFreeHead.compare_exchange_weak( head, next, std::memory_order_release, std::memory_order_relaxed ) );
+        return true;
+    }
+
+    bool isValid( Handle handle ) const
+    {
+        Storage index = handle.index();
+        return index < mCapacity && handle.generation() != 0 &&
+               mGenerations[ index ].load( std::memory_order_acquire ) == handle.generation();
+    }
+
+    size_t capacity() const { return mCapacity; }
+
+private:
+    static const uint32_t kNone = ~uint32_t( 0 );
+
+    /// Free stack links are 32-bit, with kNone marking the end
+    static uint64_t maxCapacity()
+    {
+        return uint64_t( Handle::kMaxIndex ) < kNone ? uint64_t( Handle::kMaxIndex ) + 1 : uint64_t( kNone );
+    }
+
+    size_t mCapacity;
+    std::unique_ptr< std::atomic< Storage >[] > mGenerations;
+    std::unique_ptr< std::atomic< uint32_t >[] > mNextFree;
+    // Low 32 bits: first free index; high 32: tag bumped on every change
+    std::atomic< uint64_t > mFreeHead{ kNone };
+    char mPadding[ kCacheLineSize ];
+    std::atomic< size_t > mNextUnused{ 0 };
+};
+
+} }
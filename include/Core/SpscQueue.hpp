@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Core/Concurrency.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cobalt { namespace core {
+
+/// Bounded lock-free single-producer, single-consumer ring.
+/// One thread pushes and one thread pops; neither ever blocks or allocates.
+/// Each side keeps a private copy of the other's index and only re-reads
+/// the shared one when the copy says full (or empty), so in steady state a
+/// push or pop touches no cache line written by the other thread.
+/// Batched push and pop publish many items with a single index store.
+///
+/// Example:
+///     SpscQueue< ResizeEvent > resizes( 64 );
+///     // GLFW callback, main thread:   resizes.tryPush( { width, height } );
+///     // update thread:                 ResizeEvent e; while( resizes.tryPop( e ) ) { ... }
+template< typename T >
+class SpscQueue
+{
+public:
+    /// Capacity is rounded up to a power of two
+    explicit SpscQueue( size_t capacity )
+    {
+        size_t size = 2;
+        while( size < capacity )
+        {
+            size *= 2;
+        }
+        mSlots.reset( new Slot[ size ] );
+        mMask = size - 1;
+    }
+
+    ~SpscQueue()
+    {
+        size_t tail = mTail.load( std::memory_order_acquire );
+        for( size_t head = mHead.load( std::memory_order_relaxed ); head != tail; ++head )
+        {
+            reinterpret_cast< T* >( &mSlots[ head & mMask ] )->~T();
+        }
+    }
+
+    SpscQueue( const SpscQueue& ) = delete;
+    SpscQueue& operator=( const SpscQueue& ) = delete;
+
+    size_t capacity() const { return mMask + 1; }
+
+    /// Producer only; false when full
+    template< typename... Args >
+    bool tryEmplace( Args&&... args )
+    {
+        size_t tail = mTail.load( std::memory_order_relaxed );
+        if( tail - mCachedHead > mMask )
+        {
+            mCachedHead = mHead.load( std::memory_order_acquire );
+            if( tail - mCachedHead > mMask )
+            {
+                return false;
+            }
+        }
+        new ( &mSlots[ tail & mMask ] ) T( std::forward< Args >( args )... );
+        mTail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    bool tryPush( const T& item ) { return tryEmplace( item ); }
+    bool tryPush( T&& item ) { return tryEmplace( std::move( item ) ); }
+
+    /// Producer only; pushes as many of `items` as fit and returns how many
+    size_t pushBatch( const T* items, size_t count )
+    {
+        size_t tail = mTail.load( std::memory_order_relaxed );
+        size_t space = capacity() - ( tail - mCachedHead );
+        if( space < count )
+        {
+            mCachedHead = mHead.load( std::memory_order_acquire );
+            space = capacity() - ( tail - mCachedHead );
+        }
+        size_t pushed = count < space ? count : space;
+        for( size_t i = 0; i < pushed; ++i )
+        {
+            new ( &mSlots[ ( tail + i ) & mMask ] ) T( items[ i ] );
+        }
+        mTail.store( tail + pushed, std::memory_order_release );
+        return pushed;
+    }
+
+    /// Consumer only; false when empty
+    bool tryPop( T& out )
+    {
+        size_t head = mHead.load( std::memory_order_relaxed );
+        if( head == mCachedTail )
+        {
+            mCachedTail = mTail.load( std::memory_order_acquire );
+            if( head == mCachedTail )
+            {
+                return false;
+            }
+        }
+        T& item = *reinterpret_cast< T* >( &mSlots[ head & mMask ] );
+        out = std::move( item );
+        item.~T();
+        mHead.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    /// Consumer only; pops up to `maxCount` items into `out` and returns how many
+    size_t popBatch( T* out, size_t maxCount )
+    {
+        size_t head = mHead.load( std::memory_order_relaxed );
+        if( mCachedTail - head < maxCount )
+        {
+            mCachedTail = mTail.load( std::memory_order_acquire );
+        }
+        size_t available = mCachedTail - head;
+        size_t popped = available < maxCount ? available : maxCount;
+        for( size_t i = 0; i < popped; ++i )
+        {
+            T& item = *reinterpret_cast< T* >( &mSlots[ ( head + i ) & mMask ] );
+            out[ i ] = std::move( item );
+            item.~T();
+        }
+        mHead.store( head + popped, std::memory_order_release );
+        return popped;
+    }
+
+    /// Approximate when called while the other side is active
+    bool isEmpty() const { return mHead.load( std::memory_order_acquire ) == mTail.load( std::memory_order_acquire ); }
+
+private:
+    typedef typename std::aligned_storage< sizeof( T ), alignof( T ) >::type Slot;
+
+    std::unique_ptr< Slot[] > mSlots;
+    size_t mMask = 0;
+    char mPadding0[ kCacheLineSize ];
+
+    // Consumer side
+    std::atomic< size_t > mHead{ 0 };
+    size_t mCachedTail = 0;
+    char mPadding1[ kCacheLineSize ];
+
+    // Producer side
+    std::atomic< size_t > mTail{ 0 };
+    size_t mCachedHead = 0;
+    char mPadding2[ kCacheLineSize ];
+};
+
+/// Unbounded single-producer, single-consumer queue: a chain of SpscQueue
+/// sized segments.  The producer links a new segment when the current one
+/// fills; the consumer frees segments it has drained.  Pushing allocates
+/// only when crossing into a new segment.
+template< typename T >
+class UnboundedSpscQueue
+{
+public:
+    explicit UnboundedSpscQueue( size_t segmentCapacity = 1024 )
+        : mSegmentCapacity( segmentCapacity )
+    {
+        mHead = mTail = new Segment( segmentCapacity );
+    }
+
+    ~UnboundedSpscQueue()
+    {
+        while( mHead )
+        {
+            Segment* next = mHead->next.load( std::memory_order_relaxed );
+            delete mHead;
+            mHead = next;
+        }
+    }
+
+    UnboundedSpscQueue( const UnboundedSpscQueue& ) = delete;
+    UnboundedSpscQueue& operator=( const UnboundedSpscQueue& ) = delete;
+
+    /// Producer only
+    template< typename... Args >
+    void emplace( Args&&... args )
+    {
+        if( !mTail->queue.tryEmplace( std::forward< Args >( args )... ) )
+        {
+            Segment* segment = new Segment( mSegmentCapacity );
+            segment->queue.tryEmplace( std::forward< Args >( args )... );
+            mTail->next.store( segment, std::memory_order_release );
+            mTail = segment;
+        }
+    }
+
+    void push( const T& item ) { emplace( item ); }
+    void push( T&& item ) { emplace( std::move( item ) ); }
+
+    /// Consumer only; false when empty
+    bool tryPop( T& out )
+    {
+        while( true )
+        {
+            if( mHead->queue.tryPop( out ) )
+            {
+                return true;
+            }
+            // The producer has moved on only once this segment filled, and
+            // everything it pushed here is visible by the time next is
+            Segment* next = mHead->next.load( std::memory_order_acquire );
+            if( !next )
+            {
+                return false;
+            }
+            if( mHead->queue.tryPop( out ) )
+            {
+                return true;
+            }
+            delete mHead;
+            mHead = next;
+        }
+    }
+
+private:
+    struct Segment
+    {
+        explicit Segment( size_t capacity ) : queue( capacity ) {}
+        SpscQueue< T > queue;
+        std::atomic< Segment* > next{ nullptr };
+    };
+
+    size_t mSegmentCapacity;
+    Segment* mHead; // consumer
+    char mPadding[ kCacheLineSize ];
+    Segment* mTail; // producer
+};
+
+} }
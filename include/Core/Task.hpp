@@ -0,0 +1,315 @@
+#pragma once
+
+/// COBALT_HAS_COROUTINES is 1 when the compiler supports C++20 coroutines;
+/// everything in this header is only defined then.
+#if defined( __has_include )
+    #if __has_include( <coroutine> ) && defined( __cpp_impl_coroutine )
+        #define COBALT_HAS_COROUTINES 1
+    #endif
+#endif
+#ifndef COBALT_HAS_COROUTINES
+    #define COBALT_HAS_COROUTINES 0
+#endif
+
+#if COBALT_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace cobalt { namespace core {
+
+/// Pooled storage for coroutine frames, so starting a Task doesn't hit the
+/// heap.  Frames up to kMaxPooledSize come from per-size-class free lists
+/// that are refilled in kChunkSize blocks and never returned to the OS;
+/// larger ones fall back to operator new.
+class CoroutineFrameAllocator
+{
+public:
+    static const size_t kMaxPooledSize = 4096;
+    static const size_t kChunkSize = 64 * 1024;
+
+    static void* allocate( size_t size );
+    static void deallocate( void* frame, size_t size );
+};
+
+/// Where suspended coroutines get resumed.
+/// The main loop (impl::gblUpdate) calls pump() once per frame, before
+/// Application::onUpdate(); applications running their own loop must call
+/// it themselves.  Without threads (emscripten) this is the only place
+/// coroutines resume, other than inline.
+class TaskScheduler
+{
+public:
+    /// Resumes the coroutines waiting for this frame, then those sent to
+    /// the main thread, until none are left
+    static void pump();
+    /// The main thread is the one that called setMainThread(), or else the
+    /// first to call pump()
+    static void setMainThread();
+    static bool isMainThread();
+    /// Frames pumped so far
+    static uint64_t frameIndex();
+
+    static void resumeOnMainThread( std::coroutine_handle<> handle );
+    static void resumeNextFrame( std::coroutine_handle<> handle );
+    /// On a JobSystem worker; inline if the JobSystem isn't running
+    static void resumeOnWorkerPool( std::coroutine_handle<> handle );
+};
+
+template< typename T = void >
+class Task;
+
+namespace detail {
+
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::atomic< bool > isDone{ false };
+
+        static void* operator new( size_t size ) { return CoroutineFrameAllocator::allocate( size ); }
+        static void operator delete( void* frame, size_t size ) { CoroutineFrameAllocator::deallocate( frame, size ); }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            template< typename Promise >
+            std::coroutine_handle<> await_suspend( std::coroutine_handle< Promise > handle ) noexcept
+            {
+                // Read before publishing isDone: a polling owner may destroy
+                // the frame as soon as it sees it
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                handle.promise().isDone.store( true, std::memory_order_release );
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        // Tasks are lazy: they run when awaited or start()ed
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        // Engine code doesn't throw
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    template< typename T >
+    struct TaskPromise : TaskPromiseBase
+    {
+        std::optional< T > value;
+
+        Task< T > get_return_object();
+        template< typename U >
+        void return_value( U&& result ) { value.emplace( std::forward< U >( result ) ); }
+    };
+
+    template<>
+    struct TaskPromise< void > : TaskPromiseBase
+    {
+        Task< void > get_return_object();
+        void return_void() {}
+    };
+
+}
+
+/// A lazily started coroutine producing a T.
+/// co_await it from another coroutine, or start() it and poll isDone()
+/// (e.g. once per update()); a started task must not be destroyed before
+/// it is done.  Use spawn() for fire-and-forget work.
+///
+/// Example:
+///     Task< Mesh > loadMesh( const char* path )
+///     {
+///         IoRequest request( path );          // completes request.completion
+///         co_await request.completion;        // back on the awaiting thread
+///         co_await onWorkerPool();
+///         Mesh mesh = parseMesh( request.data() );
+///         co_await onMainThread();
+///         mesh.upload();                      // GL calls need the main thread
+///         co_return mesh;
+///     }
+template< typename T >
+class Task
+{
+public:
+    typedef detail::TaskPromise< T > promise_type;
+
+    Task() = default;
+    explicit Task( std::coroutine_handle< promise_type > handle ) : mHandle( handle ) {}
+    Task( Task&& other ) noexcept : mHandle( std::exchange( other.mHandle, nullptr ) ) {}
+    Task& operator=( Task&& other ) noexcept
+    {
+        if( this != &other )
+        {
+            reset();
+            mHandle = std::exchange( other.mHandle, nullptr );
+        }
+        return *this;
+    }
+    Task( const Task& ) = delete;
+    Task& operator=( const Task& ) = delete;
+    ~Task() { reset(); }
+
+    bool isValid() const { return static_cast< bool >( mHandle ); }
+    bool isDone() const { return mHandle && mHandle.promise().isDone.load( std::memory_order_acquire ); }
+
+    /// Run until its first suspension, on this thread
+    void start() { mHandle.resume(); }
+
+    /// Only once isDone()
+    template< typename U = T >
+    typename std::enable_if< !std::is_void< U >::value, U& >::type result() { return *mHandle.promise().value; }
+
+    struct Awaiter
+    {
+        std::coroutine_handle< promise_type > handle;
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+        T await_resume()
+        {
+            if constexpr( !std::is_void< T >::value )
+            {
+                return std::move( *handle.promise().value );
+            }
+        }
+    };
+
+    Awaiter operator co_await() && noexcept { return Awaiter{ mHandle }; }
+
+private:
+    void reset()
+    {
+        if( mHandle )
+        {
+            mHandle.destroy();
+            mHandle = nullptr;
+        }
+    }
+
+    std::coroutine_handle< promise_type > mHandle;
+};
+
+namespace detail {
+
+    template< typename T >
+    Task< T > TaskPromise< T >::get_return_object()
+    {
+        return Task< T >( std::coroutine_handle< TaskPromise< T > >::from_promise( *this ) );
+    }
+
+    inline Task< void > TaskPromise< void >::get_return_object()
+    {
+        return Task< void >( std::coroutine_handle< TaskPromise< void > >::from_promise( *this ) );
+    }
+
+    /// Owns a spawned task; its frame frees itself when it finishes
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            static void* operator new( size_t size ) { return CoroutineFrameAllocator::allocate( size ); }
+            static void operator delete( void* frame, size_t size ) { CoroutineFrameAllocator::deallocate( frame, size ); }
+
+            DetachedTask get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    inline DetachedTask runDetached( Task<> task )
+    {
+        co_await std::move( task );
+    }
+
+}
+
+/// Start `task` now, on this thread, and let it finish on its own
+inline void spawn( Task<> task )
+{
+    detail::runDetached( std::move( task ) );
+}
+
+struct NextFrameAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend( std::coroutine_handle<> handle ) { TaskScheduler::resumeNextFrame( handle ); }
+    void await_resume() noexcept {}
+};
+
+struct MainThreadAwaiter
+{
+    bool await_ready() const noexcept { return TaskScheduler::isMainThread(); }
+    void await_suspend( std::coroutine_handle<> handle ) { TaskScheduler::resumeOnMainThread( handle ); }
+    void await_resume() noexcept {}
+};
+
+struct WorkerPoolAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend( std::coroutine_handle<> handle ) { TaskScheduler::resumeOnWorkerPool( handle ); }
+    void await_resume() noexcept {}
+};
+
+/// co_await nextFrame(): resume on the main thread at the start of the next frame
+inline NextFrameAwaiter nextFrame() { return {}; }
+/// co_await onMainThread(): continue on the main thread, this frame if possible
+inline MainThreadAwaiter onMainThread() { return {}; }
+/// co_await onWorkerPool(): continue on a JobSystem worker
+inline WorkerPoolAwaiter onWorkerPool() { return {}; }
+
+/// One-shot completion signal for work finished outside coroutines, e.g.
+/// an I/O request completing on an I/O thread.  A single coroutine may
+/// co_await it; it resumes on the main thread if it was waiting there, and
+/// on the worker pool otherwise.  complete() may be called from any thread,
+/// before or after the co_await.
+class IoCompletion
+{
+public:
+    IoCompletion() = default;
+    IoCompletion( const IoCompletion& ) = delete;
+    IoCompletion& operator=( const IoCompletion& ) = delete;
+
+    void complete();
+    bool isComplete() const { return mState.load( std::memory_order_acquire ) == completedState(); }
+    /// Make it awaitable again; only while nothing is waiting on it
+    void reset() { mState.store( nullptr, std::memory_order_relaxed ); }
+
+    struct Awaiter
+    {
+        IoCompletion& completion;
+
+        bool await_ready() const noexcept { return completion.isComplete(); }
+        bool await_suspend( std::coroutine_handle<> handle ) noexcept
+        {
+            completion.mIsWaitingOnMainThread = TaskScheduler::isMainThread();
+            void* expected = nullptr;
+            // False, resuming right away, if it completed meanwhile
+            return completion.mState.compare_exchange_strong( expected, handle.address(), std::memory_order_acq_rel );
+        }
+        void await_resume() noexcept {}
+    };
+
+    Awaiter operator co_await() noexcept { return Awaiter{ *this }; }
+
+private:
+    const void* completedState() const { return this; }
+
+    // null, the waiting coroutine's address, or completedState()
+    std::atomic< void* > mState{ nullptr };
+    bool mIsWaitingOnMainThread = false;
+};
+
+} }
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Core/MemoryTracker.hpp>
+#include <Core/VirtualMemory.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cobalt { namespace core {
+
+/// General purpose heap with bounded-time allocate and deallocate
+/// (Two-Level Segregated Fit, Masmano et al.).
+///
+/// Free blocks are kept in lists bucketed first by power of two and then
+/// by 32 linear steps within it; two levels of bitmaps say which lists are
+/// non-empty, so finding a fitting block is a couple of bit scans rather
+/// than a search.  Neighbouring free blocks are merged immediately, which
+/// keeps fragmentation low over long sessions.  Every operation takes the
+/// same handful of steps whatever the heap's size or history, so there are
+/// no latency spikes like malloc's occasional trims and consolidations.
+///
+/// A heap manages one or more pools of memory it is given or allocates up
+/// front and never grows by itself; allocate() returns null when nothing
+/// fits.  Give each subsystem its own heap to keep their lifetimes and
+/// fragmentation apart.  TlsfHeap is not thread-safe; LockedTlsfHeap is.
+///
+/// Example:
+///     TlsfHeap meshHeap( 64 * 1024 * 1024 );
+///     void* vertices = meshHeap.allocate( vertexBytes );
+///     ...
+///     meshHeap.deallocate( vertices );
+class TlsfHeap
+{
+public:
+    static const size_t kAlignment = 16;
+    /// Largest single allocation
+    static const size_t kMaxAllocation = size_t( 1 ) << 39;
+
+    struct Stats
+    {
+        size_t capacity = 0;     // bytes in all pools, minus block headers
+        size_t usedBytes = 0;
+        size_t peakUsedBytes = 0;
+        size_t freeBytes = 0;
+        size_t largestFreeBlock = 0;
+        size_t usedBlocks = 0;
+        size_t freeBlocks = 0;
+
+        /// 0 when all free memory is one block, approaching 1 as it is
+        /// scattered into pieces too small for big allocations
+        double fragmentation() const { return freeBytes ? 1.0 - double( largestFreeBlock ) / double( freeBytes ) : 0.0; }
+    };
+
+    /// A heap with no pools; add some with addPool()
+    TlsfHeap();
+    /// A heap owning one pool of `bytes`, on transparent huge pages where
+    /// the system has them
+    explicit TlsfHeap( size_t bytes, VirtualMemory::Pages pages = VirtualMemory::Pages::TransparentHuge );
+    ~TlsfHeap();
+    TlsfHeap( const TlsfHeap& ) = delete;
+    TlsfHeap& operator=( const TlsfHeap& ) = delete;
+
+    /// Manage `bytes` of caller memory too; it must outlive the heap
+    void addPool( void* memory, size_t bytes );
+    /// MemoryTracker tag allocations are reported under; MemoryTracker::Heaps by default
+    void setMemoryTag( unsigned tag ) { mMemoryTag = tag; }
+
+    /// Null when no free block is big enough
+    void* allocate( size_t size, size_t alignment = kAlignment );
+    void deallocate( void* pointer );
+    /// Bytes usable at `pointer`; at least what was asked for
+    size_t usableSize( const void* pointer ) const;
+
+    /// Walks every block, so meant for reports rather than every frame
+    Stats stats() const;
+    size_t usedBytes() const { return mUsedBytes; }
+    /// Checks block links and free lists, logging the first problem found
+    bool validate() const;
+
+private:
+    struct Block;
+
+    static const unsigned kSecondLevelLog2 = 5;
+    static const unsigned kSecondLevelCount = 1u << kSecondLevelLog2;
+    static const unsigned kFirstLevelShift = kSecondLevelLog2 + 4; // log2( kAlignment )
+    static const unsigned kFirstLevelCount = 40 - kFirstLevelShift + 1;
+
+    /// The free list a block of `size` belongs in
+    static void mapSize( size_t size, unsigned& firstLevel, unsigned& secondLevel );
+    void insertFreeBlock( Block* block );
+    void removeFreeBlock( Block* block );
+    Block* findFreeBlock( size_t size );
+    void splitAfter( Block* block, size_t size );
+    Block* mergeWithNeighbours( Block* block );
+
+    uint32_t mFirstLevelBitmap = 0;
+    uint32_t mSecondLevelBitmaps[ kFirstLevelCount ] = {};
+    Block* mFreeLists[ kFirstLevelCount ][ kSecondLevelCount ] = {};
+
+    struct Pool
+    {
+        void* memory;
+        size_t bytes;
+        VirtualMemory::Region region; // when the heap owns it
+    };
+    std::vector< Pool > mPools;
+    size_t mUsedBytes = 0;
+    size_t mPeakUsedBytes = 0;
+    unsigned mMemoryTag = MemoryTracker::Heaps;
+};
+
+/// TlsfHeap behind a spinlock, for heaps shared between threads
+class LockedTlsfHeap
+{
+public:
+    LockedTlsfHeap() = default;
+    explicit LockedTlsfHeap( size_t bytes, VirtualMemory::Pages pages = VirtualMemory::Pages::TransparentHuge ) : mHeap( bytes, pages ) {}
+
+    void addPool( void* memory, size_t bytes );
+    void setMemoryTag( unsigned tag ) { mHeap.setMemoryTag( tag ); }
+    void* allocate( size_t size, size_t alignment = TlsfHeap::kAlignment );
+    void deallocate( void* pointer );
+    size_t usableSize( const void* pointer ) const;
+    TlsfHeap::Stats stats() const;
+
+private:
+    void lock() const;
+    void unlock() const;
+
+    mutable std::atomic_flag mLock = ATOMIC_FLAG_INIT;
+    TlsfHeap mHeap;
+};
+
+} }
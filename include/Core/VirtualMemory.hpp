@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cobalt { namespace core {
+
+/// Address space reservations committed on demand, optionally backed by
+/// huge pages to cut TLB misses over large heaps and arenas.
+///
+/// reserve() claims address space without memory behind it; commit() and
+/// decommit() back and release page ranges within it.  Pages asks for
+/// 2 MiB pages on Linux: TransparentHuge marks the range with
+/// madvise( MADV_HUGEPAGE ) so the kernel backs it with huge pages where it
+/// can, ExplicitHuge maps from the reserved hugetlbfs pool (MAP_HUGETLB),
+/// committed up front.  Whatever isn't available falls back a step, down to
+/// normal pages; Region::pages says what was obtained.  On Windows normal
+/// pages are used; under Emscripten memory comes from the heap.
+///
+/// Builds without NDEBUG put an inaccessible guard page on either side of
+/// normal and transparent huge page regions, so overruns fault immediately.
+///
+/// Example:
+///     VirtualMemory::Region region = VirtualMemory::reserve( 1024 * 1024 * 1024, VirtualMemory::Pages::TransparentHuge );
+///     VirtualMemory::commit( region, 0, 64 * 1024 * 1024 );
+///     ...
+///     VirtualMemory::release( region );
+class VirtualMemory
+{
+public:
+    enum class Pages
+    {
+        Normal,
+        TransparentHuge,
+        ExplicitHuge
+    };
+
+    struct Region
+    {
+        char* base = nullptr;
+        size_t size = 0;               // rounded up to the page size used
+        Pages pages = Pages::Normal;   // what the region actually got
+
+        // The whole mapping, guard pages included
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+
+        bool isValid() const { return base != nullptr; }
+    };
+
+    static size_t pageSize();
+    /// 0 where huge pages aren't supported
+    static size_t hugePageSize();
+
+    /// Null region on failure
+    static Region reserve( size_t bytes, Pages pages = Pages::Normal );
+    /// Back [offset, offset + bytes) of the region with memory, rounded out
+    /// to whole pages; the new memory reads as zero.  ExplicitHuge regions
+    /// are committed from the start.
+    static bool commit( const Region& region, size_t offset, size_t bytes );
+    /// Give the memory back to the system, keeping the addresses reserved
+    static void decommit( const Region& region, size_t offset, size_t bytes );
+    static void release( Region& region );
+
+    /// reserve() and commit() the whole region
+    static Region allocate( size_t bytes, Pages pages = Pages::Normal );
+};
+
+} }
@@ -1,4 +1,9 @@
 #include <Core/Log.hpp>
+#include <Platform/FramePacer.hpp>
+#include <Platform/FrameStats.hpp>
+
+#include <atomic>
+#include <memory>
 
 using namespace cobalt::core;
 
@@ -14,6 +19,23 @@ struct WindowConfiguration
     const char* name = "Hello World";
     bool isFullscreen = false;
     bool isMaximized = false; // overrides width and height
+    double frameStatsReportInterval = 10.0; // seconds between frame time reports, 0 disables
+    double frameHitchThreshold = 1.0 / 30.0; // seconds; longer frames count as hitches
+    bool isHeadless = false; // no window, GL context or events; always on with the COBALT_HEADLESS build option
+    bool hasOffscreenContext = false; // headless only: create a GL context on a hidden window; COBALT_HEADLESS builds need COBALT_OFFSCREEN_GL for it
+    double fixedTimestep = 0.0; // seconds per update() when > 0, e.g. 1.0 / 30.0; 0 means one update( dt ) per frame
+    int maxUpdatesPerFrame = 5; // fixed timestep only: catch-up limit, older backlog is dropped
+    int swapInterval = 1; // vsync: buffer swaps wait this many refreshes, 0 doesn't wait
+    double targetFps = 0.0; // caps the frame rate when > 0 (sleeps, then spins the last bit)
+    // On-demand rendering calls glfwWaitEventsTimeout and glfwPostEmptyEvent, so
+    // desktop builds need GLFW 3.2 or later; Emscripten's GLFW 3.0 is fine, as
+    // the browser loop never waits for events
+    bool isOnDemand = false; // with a window: sleep in the event loop after each frame until input or invalidate()
+    double onDemandTimeout = 0.0; // on demand only: when > 0, seconds after which a frame is drawn anyway
+    bool isPipelined = false; // update() runs on a worker thread while the main thread renders and presents the previous frame; ignored with COBALT_NO_THREADS
+    bool hasJobSystem = false; // run the JobSystem from startup() to shutdown(), with one worker per spare physical core (see CpuTopology)
+    bool isPinningThreads = false; // pin the main, update and job worker threads to cores of their own and raise the frame threads' priority
+    size_t frameArenaSize = 8 * 1024 * 1024; // bytes per frame for FrameArena::global(), which is reset every frame
 //    ColorFormat
 };
 
@@ -31,18 +53,38 @@ struct WindowConfiguration
 ///     virtual void shutdown() override;
 /// };
 ///
+/// With WindowConfiguration::fixedTimestep set, update() is called with that
+/// constant dt as many times as needed to catch up with real time, and
+/// render( alpha ) once per frame, alpha being how far (0..1) real time is
+/// past the last update, for interpolating between the last two states.
+///
+/// With WindowConfiguration::isPipelined set, update() for frame N+1 runs on
+/// a worker thread while render() and the buffer swap of frame N run on the
+/// main thread.  This hides driver stalls in swap at the cost of one frame of
+/// latency (see FrameStats::Summary::latency).  update() must then not touch
+/// GL or state that render() reads; hand state over with DoubleBuffered and
+/// swapFrameState().
+///
 /// /sa launchCobaltApplication(Application*)
 class Application
 {
 public:
     Application();
-    virtual ~Application() {}
+    virtual ~Application();
 
     virtual void onStartup();
     virtual void onUpdate( double dt );
     virtual void onShutdown();
 
-    bool shouldUpdate() const { return mShouldUpdate; }
+    bool shouldUpdate() const { return mShouldUpdate.load( std::memory_order_relaxed ); }
+
+    /// Rolling frame time percentiles and hitch counts of the main loop
+    const FrameStats& frameStats() const { return mFrameStats; }
+
+    /// Request another frame in on-demand mode; callable from any thread
+    void invalidate();
+    /// WindowConfiguration::targetFps, 0 when the frame rate isn't capped
+    double targetFps() const { return mFramePacer.targetFps(); }
     
 protected:
     // Cobalt applications should override these methods
@@ -50,13 +92,49 @@ protected:
     virtual void startup() = 0;
     virtual void update( double dt ) = 0;
     virtual void shutdown() = 0;
+    /// Called once per frame after the updates; alpha is always 1 without a fixed timestep
+    virtual void render( double alpha ) {}
+    /// Called once per frame between the updates and render(), while neither
+    /// is running; publish double-buffered frame state here
+    virtual void swapFrameState() {}
     
 protected:
     // services for Application subclases
     void getFrameBufferSize( int& outWidth, int& outHeight );
+    /// Leave the main loop after the current frame; the only way out for headless applications
+    void requestShutdown();
+    /// False when running headless without an offscreen context
+    bool hasWindow() const { return mWindow != nullptr; }
 private:
-    bool mShouldUpdate = true;
-    GLFWwindow* mWindow;
+    struct UpdateThread;
+
+    std::atomic< bool > mShouldUpdate{ true };
+    GLFWwindow* mWindow = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+    FrameStats mFrameStats;
+    FramePacer mFramePacer;
+    bool mIsOnDemand = false;
+    double mOnDemandTimeout = 0.0;
+    std::atomic< bool > mIsInvalidated{ true };
+    int64_t mFixedTimestepNs = 0;
+    int64_t mAccumulatedNs = 0;
+    int mMaxUpdatesPerFrame = 0;
+    int64_t mFrameStatsReportIntervalNs = 0;
+    int64_t mLastFrameStatsReportNs = 0;
+    std::unique_ptr< UpdateThread > mUpdateThread; // only when pipelined
+    bool mHasJobSystem = false;
+    bool mIsPinningThreads = false;
+    int mUpdateCpu = -1;
+
+    bool createWindow( const WindowConfiguration& config );
+    double simulate( int64_t elapsedNs );
+    double waitForPipelinedUpdate( int64_t elapsedNs, int64_t& outUpdateStartNs );
+    void runUpdateThread();
+    void stopUpdateThread();
+    void placeThreads( const WindowConfiguration& config );
+    void reportFrameStats();
+    void waitBetweenFrames();
     
     // GLFW Callbacks
     static void framebufferResizeCallback( GLFWwindow* window, int width, int height );
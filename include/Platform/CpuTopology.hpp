@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Core/JobSystem.hpp>
+
+#include <vector>
+
+namespace cobalt { namespace platform {
+
+/// The machine's logical CPUs and how they share cores, caches and memory,
+/// read from sysfs on Linux.  Elsewhere, or if sysfs is unreadable, every
+/// logical CPU is reported as its own core.  Only CPUs this process may run
+/// on (its affinity mask) are listed.
+///
+/// Example:
+///     const CpuTopology& topology = CpuTopology::system();
+///     ThreadPlacement placement = ThreadPlacement::plan( topology );
+///     pinCurrentThread( placement.mainCpu );
+///     JobSystem::startup( placement.jobSystemConfig() );
+class CpuTopology
+{
+public:
+    struct Cpu
+    {
+        int id = 0;          // OS logical CPU number, as used for affinity
+        int core = 0;        // index of its physical core; SMT siblings share it
+        int package = 0;     // socket
+        int numaNode = 0;
+        int l2Domain = -1;   // lowest CPU id sharing this CPU's L2, -1 if unknown
+        int l3Domain = -1;   // likewise for the last level cache
+    };
+
+    /// Detected on first use
+    static const CpuTopology& system();
+    static CpuTopology detect();
+
+    const std::vector< Cpu >& cpus() const { return mCpus; }
+    unsigned logicalCount() const { return static_cast< unsigned >( mCpus.size() ); }
+    unsigned physicalCount() const { return mPhysicalCount; }
+    unsigned packageCount() const { return mPackageCount; }
+    unsigned numaNodeCount() const { return mNumaNodeCount; }
+
+    /// Logical CPUs on the same physical core as `cpu`, itself included
+    std::vector< int > smtSiblings( int cpu ) const;
+    /// Logical CPUs sharing the last level cache with `cpu`, itself included
+    std::vector< int > l3Siblings( int cpu ) const;
+    /// One logical CPU per physical core, ordered by NUMA node then core
+    std::vector< int > primaryCpus() const;
+
+private:
+    const Cpu* find( int cpu ) const;
+
+    std::vector< Cpu > mCpus;
+    unsigned mPhysicalCount = 0;
+    unsigned mPackageCount = 0;
+    unsigned mNumaNodeCount = 0;
+};
+
+enum class ThreadPriority
+{
+    Background, // I/O, streaming, anything that should yield to frame work
+    Normal,
+    High        // main, render and update threads; may need privileges to raise
+};
+
+/// Restrict the calling thread to `cpus` (or one `cpu`); false if the OS
+/// refused or doesn't support it.  An empty list or -1 leaves it unpinned.
+bool pinCurrentThread( const std::vector< int >& cpus );
+bool pinCurrentThread( int cpu );
+bool setCurrentThreadPriority( ThreadPriority priority );
+
+/// Where each kind of thread should run.  plan() reserves a physical core
+/// for the main thread and, optionally, one for the pipelined update thread,
+/// gives each job worker its own remaining core, and leaves I/O threads the
+/// SMT siblings and whatever else is left, so frame work isn't preempted by
+/// its own helpers.
+struct ThreadPlacement
+{
+    int mainCpu = -1;              // -1: don't pin
+    int updateCpu = -1;            // pipelined update thread
+    std::vector< int > workerCpus; // one per job worker
+    std::vector< int > ioCpus;     // shared by I/O threads
+    ThreadPriority workerPriority = ThreadPriority::Normal;
+
+    static ThreadPlacement plan( const CpuTopology& topology, bool reserveUpdateCore = false, bool useSmtSiblings = false );
+
+    /// A JobSystem configuration with one worker per entry of workerCpus,
+    /// each pinned there and set to workerPriority when it starts
+    core::JobSystem::Config jobSystemConfig() const;
+};
+
+} }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cobalt { namespace platform {
+
+/// Caps the frame rate without burning a core.
+/// waitForNextFrame() sleeps until shortly before the next frame is due and
+/// spins the rest of the way, so frames start on time despite coarse OS
+/// sleeps.  The spin margin adapts to how much the OS has been overshooting
+/// its sleeps.  Frames that run late start immediately; once more than a
+/// frame behind the pacer resets instead of catching up with a burst.
+///
+/// Example:
+///     FramePacer pacer( 30.0 );
+///     while( isRunning ) { frame(); pacer.waitForNextFrame(); }
+class FramePacer
+{
+public:
+    /// 0 disables pacing
+    explicit FramePacer( double targetFps = 0.0 );
+
+    void setTargetFps( double targetFps );
+    double targetFps() const { return mPeriodNs > 0 ? 1e9 / mPeriodNs : 0.0; }
+
+    /// Block until the next frame is due
+    void waitForNextFrame();
+
+private:
+    int64_t mPeriodNs = 0;
+    int64_t mNextFrameNs = 0;
+    int64_t mSleepOvershootNs = 500000; // running estimate
+};
+
+} }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cobalt { namespace platform {
+
+/// Rolling frame-time statistics.
+/// The main loop records one sample per frame, split into the main thread's
+/// time in the application (update() and render(), or waiting for the update
+/// thread when pipelined) and the time spent swapping buffers and polling
+/// events, plus the latency from the start of a frame's update to its
+/// present.  Samples live in a fixed ring of packed atomics, so any thread can
+/// take a summary() while the main loop keeps recording, without locks.
+///
+/// Example:
+///     FrameStats::Summary stats = app->frameStats().summary();
+///     cobalt_log_info( "p99 frame %.2f ms", stats.total.p99 * 1000.0 );
+class FrameStats
+{
+public:
+    /// Number of most recent frames the percentiles are computed over
+    static const size_t kCapacity = 1024;
+
+    /// Percentiles of one duration, in seconds
+    struct Percentiles
+    {
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    struct Summary
+    {
+        size_t frameCount = 0;   // frames in the window, at most kCapacity
+        Percentiles total;       // update + swap/poll
+        Percentiles update;
+        Percentiles swap;
+        Percentiles latency;     // update start to present
+        size_t hitchCount = 0;   // frames in the window over the hitch threshold
+    };
+
+    /// Frames whose total time exceeds hitchThreshold seconds count as hitches
+    explicit FrameStats( double hitchThreshold = 1.0 / 30.0 );
+
+    /// Record one frame.  Single writer: call from the main loop only.
+    void record( double updateSeconds, double swapSeconds, double latencySeconds );
+
+    /// Summarize the last kCapacity frames; safe from any thread.
+    Summary summary() const;
+
+    double hitchThreshold() const { return mHitchThreshold.load( std::memory_order_relaxed ); }
+    void setHitchThreshold( double seconds ) { mHitchThreshold.store( seconds, std::memory_order_relaxed ); }
+
+    /// Totals since startup
+    uint64_t frameCount() const { return mFrameCount.load( std::memory_order_acquire ); }
+    uint64_t hitchCount() const { return mHitchCount.load( std::memory_order_relaxed ); }
+
+private:
+    // Each sample packs update and swap time in microseconds into one word,
+    // so readers never see half of a frame
+    std::atomic< uint64_t > mSamples[ kCapacity ];
+    std::atomic< uint32_t > mLatencies[ kCapacity ];
+    std::atomic< uint64_t > mFrameCount;
+    std::atomic< uint64_t > mHitchCount;
+    std::atomic< double > mHitchThreshold;
+};
+
+} }
@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <Core/BinaryLog.hpp>
+#include <Core/FlatHashMap.hpp>
+#include <Core/FlightRecorder.hpp>
+
+namespace cobalt {
+using namespace core;
+
+const char BinaryLog::kFileMagic[ 8 ] = { 'C', 'B', 'L', 'O', 'G', '0', '1', '\n' };
+
+namespace {
+
+    std::mutex gFileMutex;
+    std::FILE* gFile = nullptr;
+    FlatHashSet< uint64_t > gWrittenFormats;
+
+    struct ArgReader
+    {
+        const char* cursor;
+        const char* end;
+        size_t remaining;
+
+        bool next( BinaryLog::ArgType& type, const char*& payload, size_t& size )
+        {
+            if( remaining == 0 || cursor >= end )
+            {
+                return false;
+            }
+            type = static_cast< BinaryLog::ArgType >( *cursor++ );
+            if( type == BinaryLog::ArgType::String )
+            {
+                uint16_t length = 0;
+                if( cursor + sizeof( length ) <= end )
+                {
+                    std::memcpy( &length, cursor, sizeof( length ) );
+                }
+                cursor += sizeof( length );
+                size = length;
+            }
+            else
+            {
+                size = 8;
+            }
+            if( cursor + size > end )
+            {
+                // Cut short, e.g. a record read back from a damaged file
+                return false;
+            }
+            payload = cursor;
+            cursor += size;
+            --remaining;
+            return true;
+        }
+    };
+
+    int64_t readSigned( const char* payload ) { int64_t v; std::memcpy( &v, payload, sizeof( v ) ); return v; }
+    uint64_t readUnsigned( const char* payload ) { uint64_t v; std::memcpy( &v, payload, sizeof( v ) ); return v; }
+    double readDouble( const char* payload ) { double v; std::memcpy( &v, payload, sizeof( v ) ); return v; }
+}
+
+size_t BinaryLog::format( char* out, size_t outSize, const char* format,
+                          const char* args, size_t argBytes, size_t argCount )
+{
+    // Every encoded argument takes at least 3 bytes
+    FormatArg formatArgs[ kMaxRecordSize / 3 ];
+    size_t count = 0;
+    ArgReader reader{ args, args + argBytes, argCount };
+    ArgType type;
+    const char* payload;
+    size_t size;
+    while( count < sizeof( formatArgs ) / sizeof( formatArgs[ 0 ] ) && reader.next( type, payload, size ) )
+    {
+        FormatArg& arg = formatArgs[ count++ ];
+        switch( type )
+        {
+        case ArgType::Signed: arg = FormatArg( readSigned( payload ) ); break;
+        case ArgType::Signed32: arg = FormatArg( static_cast< int32_t >( readSigned( payload ) ) ); break;
+        case ArgType::Unsigned: arg = FormatArg( readUnsigned( payload ) ); break;
+        case ArgType::Double: arg = FormatArg( readDouble( payload ) ); break;
+        case ArgType::String: arg = FormatArg( payload ); arg.s.size = size; break; // not terminated
+        case ArgType::Pointer: arg = FormatArg( reinterpret_cast< const void* >( static_cast< uintptr_t >( readUnsigned( payload ) ) ) ); break;
+        }
+    }
+    return core::formatArgs( out, outSize, format, formatArgs, count );
+}
+
+bool BinaryLog::openFile( const char* path )
+{
+    Log::flush();
+    std::lock_guard< std::mutex > lock( gFileMutex );
+    if( gFile )
+    {
+        std::fclose( gFile );
+    }
+    gWrittenFormats.clear();
+    gFile = std::fopen( path, "wb" );
+    if( !gFile )
+    {
+        return false;
+    }
+    std::fwrite( kFileMagic, 1, sizeof( kFileMagic ), gFile );
+    return true;
+}
+
+void BinaryLog::closeFile()
+{
+    Log::flush();
+    std::lock_guard< std::mutex > lock( gFileMutex );
+    if( gFile )
+    {
+        std::fclose( gFile );
+        gFile = nullptr;
+    }
+}
+
+void BinaryLog::commit( const char* record, size_t size )
+{
+    // Straight into the crash-safe ring from the calling thread, like other
+    // log lines, so records still queued for the drain thread aren't lost if
+    // the process dies.  It stays encoded; cobalt_flight_recorder_dump
+    // formats it.
+    if( FlightRecorder::isOpen() )
+    {
+        EventHeader header;
+        std::memcpy( &header, record, sizeof( header ) );
+        const char* format = reinterpret_cast< const char* >( static_cast< uintptr_t >( header.format ) );
+        if( size <= FlightRecorder::kTextSize )
+        {
+            FlightRecorder::writeBinary( static_cast< Log::Level >( header.level ), format, record, size );
+        }
+        else
+        {
+            // Keep the arguments that fit a slot, cutting short the string
+            // that crosses the end if there is one
+            char fitted[ FlightRecorder::kTextSize ];
+            char* cursor = fitted + sizeof( header );
+            char* end = fitted + sizeof( fitted );
+            ArgReader reader{ record + sizeof( header ), record + size, header.argCount };
+            ArgType type;
+            const char* payload;
+            size_t argSize;
+            header.argCount = 0;
+            while( reader.next( type, payload, argSize ) )
+            {
+                const char* encoded = payload - ( type == ArgType::String ? 1 + sizeof( uint16_t ) : 1 );
+                size_t encodedSize = static_cast< size_t >( payload + argSize - encoded );
+                if( encodedSize <= static_cast< size_t >( end - cursor ) )
+                {
+                    std::memcpy( cursor, encoded, encodedSize );
+                    cursor += encodedSize;
+                    ++header.argCount;
+                    continue;
+                }
+                if( type == ArgType::String && static_cast< size_t >( end - cursor ) > 1 + sizeof( uint16_t ) )
+                {
+                    uint16_t length = static_cast< uint16_t >( end - cursor - 1 - sizeof( uint16_t ) );
+                    *cursor++ = static_cast< char >( type );
+                    std::memcpy( cursor, &length, sizeof( length ) );
+                    std::memcpy( cursor + sizeof( length ), payload, length );
+                    cursor = end;
+                    ++header.argCount;
+                }
+                break;
+            }
+            header.argBytes = static_cast< uint16_t >( cursor - ( fitted + sizeof( header ) ) );
+            std::memcpy( fitted, &header, sizeof( header ) );
+            FlightRecorder::writeBinary( static_cast< Log::Level >( header.level ), format, fitted, static_cast< size_t >( cursor - fitted ) );
+        }
+    }
+    Log::commitDeferred( record, size );
+}
+
+void BinaryLog::drain( const char* record, size_t size, std::FILE* textOutput )
+{
+    EventHeader header;
+    std::memcpy( &header, record, sizeof( header ) );
+    const char* args = record + sizeof( header );
+
+    bool isFileOpen = false;
+    {
+        std::lock_guard< std::mutex > lock( gFileMutex );
+        if( gFile )
+        {
+            if( gWrittenFormats.insert( header.format ).second )
+            {
+                const char* formatString = reinterpret_cast< const char* >( static_cast< uintptr_t >( header.format ) );
+                uint32_t length = static_cast< uint32_t >( std::strlen( formatString ) );
+                uint8_t tag = FormatRecord;
+                std::fwrite( &tag, 1, 1, gFile );
+                std::fwrite( &header.format, sizeof( header.format ), 1, gFile );
+                std::fwrite( &length, sizeof( length ), 1, gFile );
+                std::fwrite( formatString, 1, length, gFile );
+            }
+            uint8_t tag = EventRecord;
+            std::fwrite( &tag, 1, 1, gFile );
+            std::fwrite( record, 1, size, gFile );
+            isFileOpen = true;
+        }
+    }
+    if( isFileOpen )
+    {
+        return;
+    }
+
+    char line[ 1024 ];
+    size_t len = format( line, sizeof( line ) - 1, reinterpret_cast< const char* >( static_cast< uintptr_t >( header.format ) ),
+                         args, header.argBytes, header.argCount );
+    line[ len++ ] = '\n';
+    std::fwrite( line, 1, len, textOutput );
+}
+
+}
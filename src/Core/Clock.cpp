@@ -0,0 +1,138 @@
+#include <Core/Clock.hpp>
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 ) ) && !defined( COBALT_EMSCRIPTEN )
+    #define COBALT_CLOCK_TSC 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+#endif
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+    #define COBALT_CLOCK_MONOTONIC 1
+    #include <time.h>
+#else
+    #include <chrono>
+#endif
+
+namespace cobalt { namespace core {
+
+bool Clock::sIsTscBased = false;
+double Clock::sNsPerTick = 1.0;
+uint64_t Clock::sBaseTicks = 0;
+int64_t Clock::sBaseNs = 0;
+
+namespace {
+#if COBALT_CLOCK_TSC
+    bool hasInvariantTsc()
+    {
+        unsigned int regs[ 4 ] = { 0, 0, 0, 0 };
+    #ifdef _MSC_VER
+        __cpuid( reinterpret_cast< int* >( regs ), 0x80000000 );
+        if( regs[ 0 ] < 0x80000007 )
+        {
+            return false;
+        }
+        __cpuid( reinterpret_cast< int* >( regs ), 0x80000007 );
+    #else
+        if( __get_cpuid_max( 0x80000000, nullptr ) < 0x80000007 )
+        {
+            return false;
+        }
+        __get_cpuid( 0x80000007, &regs[ 0 ], &regs[ 1 ], &regs[ 2 ], &regs[ 3 ] );
+    #endif
+        return ( regs[ 3 ] & ( 1u << 8 ) ) != 0; // EDX bit 8: constant rate across P/C-states
+    }
+
+    inline uint64_t readTsc()
+    {
+        return __rdtsc();
+    }
+
+    // One TSC/OS clock pair; the OS read is bracketed by TSC reads and the
+    // tightest of a few tries is kept, so preemption doesn't skew it
+    struct ClockSample
+    {
+        uint64_t ticks;
+        int64_t ns;
+    };
+
+    template< typename OsClock >
+    ClockSample sampleClocks( OsClock osClock )
+    {
+        ClockSample best{ 0, 0 };
+        uint64_t bestWidth = ~0ull;
+        for( int i = 0; i < 8; ++i )
+        {
+            uint64_t before = readTsc();
+            int64_t ns = osClock();
+            uint64_t after = readTsc();
+            if( after - before < bestWidth )
+            {
+                bestWidth = after - before;
+                best = ClockSample{ before + ( after - before ) / 2, ns };
+            }
+        }
+        return best;
+    }
+#endif
+}
+
+int64_t Clock::osNowNs()
+{
+#if COBALT_CLOCK_MONOTONIC
+    timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return static_cast< int64_t >( now.tv_sec ) * 1000000000 + now.tv_nsec;
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+int64_t Clock::nowNs()
+{
+#if COBALT_CLOCK_TSC
+    if( sIsTscBased )
+    {
+        return sBaseNs + static_cast< int64_t >( static_cast< double >( readTsc() - sBaseTicks ) * sNsPerTick );
+    }
+#endif
+    return osNowNs();
+}
+
+void Clock::calibrate()
+{
+#if COBALT_CLOCK_TSC
+    if( !hasInvariantTsc() )
+    {
+        return;
+    }
+    const int64_t kCalibrationNs = 10000000;
+    ClockSample start = sampleClocks( osNowNs );
+    while( osNowNs() - start.ns < kCalibrationNs ) {}
+    ClockSample end = sampleClocks( osNowNs );
+    if( end.ticks <= start.ticks )
+    {
+        return;
+    }
+    sNsPerTick = static_cast< double >( end.ns - start.ns ) / static_cast< double >( end.ticks - start.ticks );
+    sBaseTicks = end.ticks;
+    sBaseNs = end.ns;
+    sIsTscBased = true;
+#endif
+}
+
+/// Calibrates the clock while the library is loaded
+struct ClockCalibration
+{
+    ClockCalibration() { Clock::calibrate(); }
+};
+
+namespace {
+    ClockCalibration gClockCalibration;
+}
+
+} }
@@ -0,0 +1,245 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#if !defined( _WIN32 ) && !defined( COBALT_EMSCRIPTEN )
+    #define COBALT_FLIGHT_RECORDER_MMAP 1
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include <Core/FlightRecorder.hpp>
+#include <Core/Hash.hpp>
+
+namespace cobalt {
+using namespace core;
+
+const char FlightRecorder::kMagic[ 8 ] = { 'C', 'B', 'F', 'L', 'I', 'G', 'H', 'T' };
+
+std::atomic< FlightRecorder::Header* > FlightRecorder::sHeader{ nullptr };
+
+namespace {
+    static_assert( sizeof( FlightRecorder::Record ) == FlightRecorder::kRecordSize, "Record must fill its slot" );
+    static_assert( sizeof( FlightRecorder::Header ) == FlightRecorder::kRecordSize, "Header must fill one slot" );
+    static_assert( sizeof( FlightRecorder::Format ) == FlightRecorder::kRecordSize, "Format must fill its slot" );
+
+    // Past this many probes a format is left out of the table and its
+    // records dump as unknown, rather than slowing every write down
+    const size_t kMaxFormatProbes = 32;
+
+    size_t gMappedSize = 0;
+
+    FlightRecorder::Record* records( FlightRecorder::Header* header )
+    {
+        return reinterpret_cast< FlightRecorder::Record* >( header + 1 );
+    }
+
+    FlightRecorder::Format* formats( FlightRecorder::Header* header )
+    {
+        return reinterpret_cast< FlightRecorder::Format* >( records( header ) + header->recordCount );
+    }
+
+    size_t formatSlot( FlightRecorder::Header* header, uint64_t id )
+    {
+        return static_cast< size_t >( hashInteger( id ) % header->formatCount );
+    }
+
+    void copyFormat( FlightRecorder::Format& entry, uint32_t run, const char* text, size_t length )
+    {
+        entry.run = run;
+        entry.length = static_cast< uint32_t >( length < sizeof( entry.text ) ? length : sizeof( entry.text ) );
+        std::memcpy( entry.text, text, entry.length );
+    }
+
+    /// Add `format` to the table for this run unless it's there already.
+    void internFormat( FlightRecorder::Header* header, const char* format )
+    {
+        uint64_t id = reinterpret_cast< uintptr_t >( format );
+        FlightRecorder::Format* table = formats( header );
+        size_t slot = formatSlot( header, id );
+        for( size_t probe = 0; probe < kMaxFormatProbes; ++probe )
+        {
+            FlightRecorder::Format& entry = table[ slot ];
+            uint64_t current = entry.id.load( std::memory_order_acquire );
+            if( current == id && entry.run == header->run )
+            {
+                return;
+            }
+            if( current == 0
+                && entry.id.compare_exchange_strong( current, FlightRecorder::kBusySequence, std::memory_order_acquire, std::memory_order_relaxed ) )
+            {
+                copyFormat( entry, header->run, format, std::strlen( format ) );
+                entry.id.store( id, std::memory_order_release );
+                return;
+            }
+            // Another format, or this one being added by another thread
+            // right now; a duplicate entry is harmless
+            slot = slot + 1 == header->formatCount ? 0 : slot + 1;
+        }
+    }
+
+    /// Forget the formats of earlier runs whose binary records have all been
+    /// overwritten, so the table doesn't fill up over many runs.
+    void pruneFormats( FlightRecorder::Header* header )
+    {
+        uint32_t oldestRun = header->run + 1;
+        FlightRecorder::Record* ring = records( header );
+        for( uint64_t slot = 0; slot < header->recordCount; ++slot )
+        {
+            const FlightRecorder::Record& record = ring[ slot ];
+            if( record.sequence.load( std::memory_order_relaxed ) != 0 && ( record.flags & FlightRecorder::BinaryFlag ) && record.run < oldestRun )
+            {
+                oldestRun = record.run;
+            }
+        }
+
+        FlightRecorder::Format* table = formats( header );
+        size_t tableSize = header->formatCount * sizeof( FlightRecorder::Format );
+        std::vector< char > previous( reinterpret_cast< const char* >( table ), reinterpret_cast< const char* >( table ) + tableSize );
+        std::memset( static_cast< void* >( table ), 0, tableSize );
+        const FlightRecorder::Format* kept = reinterpret_cast< const FlightRecorder::Format* >( previous.data() );
+        for( uint64_t i = 0; i < header->formatCount; ++i )
+        {
+            uint64_t id = kept[ i ].id.load( std::memory_order_relaxed );
+            if( id == 0 || id == FlightRecorder::kBusySequence || kept[ i ].run < oldestRun )
+            {
+                continue;
+            }
+            size_t slot = formatSlot( header, id );
+            while( table[ slot ].id.load( std::memory_order_relaxed ) != 0 )
+            {
+                slot = slot + 1 == header->formatCount ? 0 : slot + 1;
+            }
+            copyFormat( table[ slot ], kept[ i ].run, kept[ i ].text, kept[ i ].length );
+            table[ slot ].id.store( id, std::memory_order_relaxed );
+        }
+    }
+
+    void writeRecord( FlightRecorder::Header* header, Log::Level level, const char* data, size_t length, uint8_t flags )
+    {
+        uint64_t index = header->nextIndex.fetch_add( 1, std::memory_order_relaxed );
+        FlightRecorder::Record& record = records( header )[ index % header->recordCount ];
+
+        // Claim the slot first: a writer a full lap ahead or behind that lands
+        // on it at the same time finds it busy (or already newer) and drops its
+        // line rather than mixing its text into ours.  The busy marker also
+        // leaves a detectably torn slot if we crash mid-copy.
+        uint64_t previous = record.sequence.load( std::memory_order_relaxed );
+        if( previous == FlightRecorder::kBusySequence || previous > index
+            || !record.sequence.compare_exchange_strong( previous, FlightRecorder::kBusySequence, std::memory_order_acquire, std::memory_order_relaxed ) )
+        {
+            return;
+        }
+        std::atomic_thread_fence( std::memory_order_release );
+        record.wallTimeNs = std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        record.level = static_cast< uint8_t >( level );
+        record.flags = flags;
+        record.length = static_cast< uint16_t >( length < sizeof( record.text ) ? length : sizeof( record.text ) );
+        record.run = header->run;
+        std::memcpy( record.text, data, record.length );
+        uint64_t claimed = FlightRecorder::kBusySequence;
+        if( !record.sequence.compare_exchange_strong( claimed, index + 1, std::memory_order_release, std::memory_order_relaxed ) )
+        {
+            return;
+        }
+
+        if( flags & FlightRecorder::AssertFlag )
+        {
+            header->lastAssertSequence.store( index + 1, std::memory_order_release );
+        }
+    }
+}
+
+bool FlightRecorder::open( const char* path, size_t recordCount )
+{
+#if COBALT_FLIGHT_RECORDER_MMAP
+    close();
+    size_t size = sizeof( Header ) + recordCount * sizeof( Record ) + kFormatCount * sizeof( Format );
+    int fd = ::open( path, O_RDWR | O_CREAT, 0644 );
+    if( fd < 0 )
+    {
+        cobalt_log_error( "FlightRecorder: unable to open %s", path );
+        return false;
+    }
+    if( ::ftruncate( fd, static_cast< off_t >( size ) ) != 0 )
+    {
+        ::close( fd );
+        cobalt_log_error( "FlightRecorder: unable to size %s", path );
+        return false;
+    }
+    void* memory = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( memory == MAP_FAILED )
+    {
+        cobalt_log_error( "FlightRecorder: unable to map %s", path );
+        return false;
+    }
+
+    Header* header = static_cast< Header* >( memory );
+    bool isCompatible = std::memcmp( header->magic, kMagic, sizeof( kMagic ) ) == 0
+                     && header->version == kVersion
+                     && header->recordSize == sizeof( Record )
+                     && header->recordCount == recordCount
+                     && header->formatCount == kFormatCount;
+    if( !isCompatible )
+    {
+        // Fresh ring; an existing compatible one keeps the previous run's
+        // records, which are exactly what a post-mortem wants to see
+        std::memset( memory, 0, size );
+        std::memcpy( header->magic, kMagic, sizeof( kMagic ) );
+        header->version = kVersion;
+        header->recordSize = sizeof( Record );
+        header->recordCount = recordCount;
+        header->formatCount = kFormatCount;
+    }
+    else
+    {
+        pruneFormats( header );
+    }
+    // Format addresses are only meaningful within one run
+    ++header->run;
+    header->processId = static_cast< uint64_t >( ::getpid() );
+    gMappedSize = size;
+    sHeader.store( header, std::memory_order_release );
+    return true;
+#else
+    cobalt_log_warn( "FlightRecorder: not supported on this platform" );
+    return false;
+#endif
+}
+
+void FlightRecorder::close()
+{
+    // Callers must make sure no thread is still logging
+    Header* header = sHeader.exchange( nullptr );
+#if COBALT_FLIGHT_RECORDER_MMAP
+    if( header )
+    {
+        ::msync( header, gMappedSize, MS_ASYNC );
+        ::munmap( header, gMappedSize );
+    }
+#endif
+}
+
+void FlightRecorder::write( Log::Level level, const char* text, size_t length, uint8_t flags )
+{
+    Header* header = sHeader.load( std::memory_order_acquire );
+    if( header )
+    {
+        writeRecord( header, level, text, length, flags );
+    }
+}
+
+void FlightRecorder::writeBinary( Log::Level level, const char* format, const char* record, size_t length )
+{
+    Header* header = sHeader.load( std::memory_order_acquire );
+    if( header )
+    {
+        internFormat( header, format );
+        writeRecord( header, level, record, length, BinaryFlag );
+    }
+}
+
+}
@@ -0,0 +1,656 @@
+#include <cmath>
+#include <cstring>
+
+#if defined( __has_include )
+    #if __has_include( <charconv> )
+        #include <charconv>
+    #endif
+#endif
+
+// The C library formats doubles when there's no floating point
+// std::to_chars, and the rare ones too long for the stack buffer
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include <Core/Format.hpp>
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    const char kDigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    /// Bounded output that silently truncates, always leaving room for '\0'.
+    struct Output
+    {
+        char* cursor;
+        char* end; // last usable position, reserved for the terminator
+
+        void put( char c )
+        {
+            if( cursor < end )
+            {
+                *cursor++ = c;
+            }
+        }
+
+        void put( const char* str, size_t length )
+        {
+            size_t room = static_cast< size_t >( end - cursor );
+            if( length > room )
+            {
+                length = room;
+            }
+            std::memcpy( cursor, str, length );
+            cursor += length;
+        }
+
+        void fill( char c, size_t count )
+        {
+            while( count-- && cursor < end )
+            {
+                *cursor++ = c;
+            }
+        }
+    };
+
+    struct Spec
+    {
+        bool leftAlign = false;
+        bool plusSign = false;
+        bool spaceSign = false;
+        bool alternate = false;
+        bool zeroPad = false;
+        int width = 0;
+        int precision = -1;
+        char conversion = 's';
+    };
+
+    // Writes the digits of `value` right-aligned ending at `end`; returns the first digit.
+    char* writeDecimal( char* end, uint64_t value )
+    {
+        while( value >= 100 )
+        {
+            const char* pair = kDigitPairs + ( value % 100 ) * 2;
+            value /= 100;
+            *--end = pair[ 1 ];
+            *--end = pair[ 0 ];
+        }
+        if( value >= 10 )
+        {
+            const char* pair = kDigitPairs + value * 2;
+            *--end = pair[ 1 ];
+            *--end = pair[ 0 ];
+        }
+        else
+        {
+            *--end = static_cast< char >( '0' + value );
+        }
+        return end;
+    }
+
+    char* writeBase( char* end, uint64_t value, unsigned shift, bool upper )
+    {
+        const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+        uint64_t mask = ( 1u << shift ) - 1;
+        do
+        {
+            *--end = digits[ value & mask ];
+            value >>= shift;
+        } while( value );
+        return end;
+    }
+
+    /// Emit sign/prefix, zero padding and body honoring width and alignment.
+    void emitNumber( Output& out, const Spec& spec, const char* prefix, size_t prefixLength,
+                     const char* body, size_t bodyLength, size_t zeros )
+    {
+        size_t length = prefixLength + zeros + bodyLength;
+        size_t padding = spec.width > 0 && static_cast< size_t >( spec.width ) > length ? spec.width - length : 0;
+        if( spec.leftAlign )
+        {
+            out.put( prefix, prefixLength );
+            out.fill( '0', zeros );
+            out.put( body, bodyLength );
+            out.fill( ' ', padding );
+        }
+        else if( spec.zeroPad )
+        {
+            out.put( prefix, prefixLength );
+            out.fill( '0', zeros + padding );
+            out.put( body, bodyLength );
+        }
+        else
+        {
+            out.fill( ' ', padding );
+            out.put( prefix, prefixLength );
+            out.fill( '0', zeros );
+            out.put( body, bodyLength );
+        }
+    }
+
+    void emitString( Output& out, const Spec& spec, const char* str, size_t length )
+    {
+        if( length == SIZE_MAX )
+        {
+            length = 0;
+            while( str[ length ] && ( spec.precision < 0 || length < static_cast< size_t >( spec.precision ) ) )
+            {
+                ++length;
+            }
+        }
+        else if( spec.precision >= 0 && length > static_cast< size_t >( spec.precision ) )
+        {
+            length = spec.precision;
+        }
+        size_t padding = spec.width > 0 && static_cast< size_t >( spec.width ) > length ? spec.width - length : 0;
+        if( !spec.leftAlign )
+        {
+            out.fill( ' ', padding );
+        }
+        out.put( str, length );
+        if( spec.leftAlign )
+        {
+            out.fill( ' ', padding );
+        }
+    }
+
+    void emitInteger( Output& out, Spec spec, bool negative, uint64_t magnitude )
+    {
+        char buffer[ 24 ];
+        char* end = buffer + sizeof( buffer );
+        char* digits;
+        char prefix[ 3 ];
+        size_t prefixLength = 0;
+
+        switch( spec.conversion )
+        {
+        case 'x':
+        case 'X':
+            digits = writeBase( end, magnitude, 4, spec.conversion == 'X' );
+            if( spec.alternate && magnitude )
+            {
+                prefix[ prefixLength++ ] = '0';
+                prefix[ prefixLength++ ] = spec.conversion;
+            }
+            break;
+        case 'o':
+            digits = writeBase( end, magnitude, 3, false );
+            break;
+        default:
+        {
+            // '+' and ' ' only apply to signed conversions
+            bool isSigned = spec.conversion != 'u';
+            digits = writeDecimal( end, magnitude );
+            if( negative )
+            {
+                prefix[ prefixLength++ ] = '-';
+            }
+            else if( spec.plusSign && isSigned )
+            {
+                prefix[ prefixLength++ ] = '+';
+            }
+            else if( spec.spaceSign && isSigned )
+            {
+                prefix[ prefixLength++ ] = ' ';
+            }
+            break;
+        }
+        }
+
+        size_t length = static_cast< size_t >( end - digits );
+        size_t zeros = 0;
+        if( spec.precision >= 0 )
+        {
+            // An explicit precision is a minimum digit count and disables '0'
+            spec.zeroPad = false;
+            if( spec.precision == 0 && magnitude == 0 )
+            {
+                length = 0;
+            }
+            else if( static_cast< size_t >( spec.precision ) > length )
+            {
+                zeros = spec.precision - length;
+            }
+        }
+        if( spec.conversion == 'o' && spec.alternate && zeros == 0 && ( length == 0 || *digits != '0' ) )
+        {
+            // '#' raises the precision just enough for a leading 0, so it
+            // applies after a zero precision has dropped the digit
+            digits = end - length;
+            *--digits = '0';
+            ++length;
+        }
+        emitNumber( out, spec, prefix, prefixLength, digits, length, zeros );
+    }
+
+    /// Shortest digits that read back as `value`, laid out like %g: fixed
+    /// notation for exponents in [-4, max(6, digit count)), else scientific.
+    char* writeShortest( char* buffer, double value )
+    {
+        char* out = buffer;
+        if( value != value )
+        {
+            std::memcpy( out, "nan", 3 );
+            return out + 3;
+        }
+        if( std::signbit( value ) )
+        {
+            *out++ = '-';
+            value = -value;
+        }
+        if( value - value != 0 )
+        {
+            std::memcpy( out, "inf", 3 );
+            return out + 3;
+        }
+
+        // Shortest scientific form, d[.ddd]e[+-]xx
+        char scientific[ 32 ];
+#if defined( __cpp_lib_to_chars )
+        char* scientificEnd = std::to_chars( scientific, scientific + sizeof( scientific ), value, std::chars_format::scientific ).ptr;
+#else
+        int length = 0;
+        for( int precision = 0; precision <= 16; ++precision )
+        {
+            length = std::snprintf( scientific, sizeof( scientific ), "%.*e", precision, value );
+            if( std::strtod( scientific, nullptr ) == value )
+            {
+                break;
+            }
+        }
+        char* scientificEnd = scientific + length;
+#endif
+        *scientificEnd = '\0';
+        char digits[ 20 ];
+        int digitCount = 0;
+        const char* c = scientific;
+        for( ; *c && *c != 'e'; ++c )
+        {
+            if( *c != '.' )
+            {
+                digits[ digitCount++ ] = *c;
+            }
+        }
+        int exponent = 0;
+        bool negativeExponent = false;
+        if( *c == 'e' )
+        {
+            ++c;
+            negativeExponent = *c == '-';
+            if( *c == '-' || *c == '+' )
+            {
+                ++c;
+            }
+            while( *c >= '0' && *c <= '9' )
+            {
+                exponent = exponent * 10 + ( *c++ - '0' );
+            }
+        }
+        if( negativeExponent )
+        {
+            exponent = -exponent;
+        }
+
+        if( exponent >= -4 && exponent < ( digitCount > 6 ? digitCount : 6 ) )
+        {
+            if( exponent < 0 )
+            {
+                *out++ = '0';
+                *out++ = '.';
+                for( int i = -1; i > exponent; --i )
+                {
+                    *out++ = '0';
+                }
+                std::memcpy( out, digits, digitCount );
+                out += digitCount;
+            }
+            else
+            {
+                for( int i = 0; i <= exponent || i < digitCount; ++i )
+                {
+                    if( i == exponent + 1 )
+                    {
+                        *out++ = '.';
+                    }
+                    *out++ = i < digitCount ? digits[ i ] : '0';
+                }
+            }
+            return out;
+        }
+        *out++ = digits[ 0 ];
+        if( digitCount > 1 )
+        {
+            *out++ = '.';
+            std::memcpy( out, digits + 1, digitCount - 1 );
+            out += digitCount - 1;
+        }
+        size_t exponentLength = std::strlen( std::strchr( scientific, 'e' ) );
+        std::memcpy( out, std::strchr( scientific, 'e' ), exponentLength );
+        return out + exponentLength;
+    }
+
+    void emitDouble( Output& out, Spec spec, double value )
+    {
+        char buffer[ 400 ]; // room for %f of DBL_MAX
+        std::unique_ptr< char[] > longBuffer;
+        char* begin = buffer;
+        char* end = nullptr;
+        bool upper = spec.conversion == 'F' || spec.conversion == 'E' || spec.conversion == 'G' || spec.conversion == 'A';
+        char lower = static_cast< char >( spec.conversion | 0x20 );
+        if( lower == 'g' && spec.precision < 0 && !spec.alternate )
+        {
+            end = writeShortest( buffer, value );
+        }
+#if defined( __cpp_lib_to_chars )
+        else if( !spec.alternate )
+        {
+            // std::to_chars has no equivalent of '#', so those go to snprintf
+            std::chars_format format = lower == 'f' ? std::chars_format::fixed
+                                     : lower == 'e' ? std::chars_format::scientific
+                                     : lower == 'a' ? std::chars_format::hex
+                                     : std::chars_format::general;
+            std::to_chars_result result;
+            if( lower == 'a' && spec.precision < 0 )
+            {
+                result = std::to_chars( buffer, buffer + sizeof( buffer ), value, format );
+            }
+            else
+            {
+                result = std::to_chars( buffer, buffer + sizeof( buffer ), value, format, spec.precision < 0 ? 6 : spec.precision );
+            }
+            bool isHexNumber = lower == 'a' && result.ec == std::errc() && result.ptr[ -1 ] >= '0' && result.ptr[ -1 ] <= '9'; // not inf or nan
+            if( result.ec == std::errc() && ( !isHexNumber || result.ptr + 2 <= buffer + sizeof( buffer ) ) )
+            {
+                end = result.ptr;
+                if( isHexNumber )
+                {
+                    // printf spells hex floats with a 0x prefix
+                    char* digits = buffer + ( *buffer == '-' ? 1 : 0 );
+                    std::memmove( digits + 2, digits, static_cast< size_t >( end - digits ) );
+                    digits[ 0 ] = '0';
+                    digits[ 1 ] = 'x';
+                    end += 2;
+                }
+            }
+        }
+#endif
+        if( !end )
+        {
+            // A large precision can need more than the buffer holds
+            char formatText[ 6 ];
+            size_t formatLength = 0;
+            formatText[ formatLength++ ] = '%';
+            if( spec.alternate )
+            {
+                formatText[ formatLength++ ] = '#';
+            }
+            formatText[ formatLength++ ] = '.';
+            formatText[ formatLength++ ] = '*';
+            formatText[ formatLength++ ] = spec.conversion;
+            formatText[ formatLength ] = '\0';
+            int precision = spec.precision < 0 ? ( lower == 'a' ? -1 : 6 ) : spec.precision;
+            int length = std::snprintf( buffer, sizeof( buffer ), formatText, precision, value );
+            if( length >= static_cast< int >( sizeof( buffer ) ) )
+            {
+                longBuffer.reset( new char[ length + 1 ] );
+                begin = longBuffer.get();
+                std::snprintf( begin, static_cast< size_t >( length ) + 1, formatText, precision, value );
+            }
+            end = begin + ( length > 0 ? length : 0 );
+        }
+        if( upper )
+        {
+            for( char* c = begin; c != end; ++c )
+            {
+                if( *c >= 'a' && *c <= 'z' )
+                {
+                    *c = static_cast< char >( *c - 'a' + 'A' );
+                }
+            }
+        }
+
+        char prefix[ 3 ];
+        size_t prefixLength = 0;
+        if( *begin == '-' )
+        {
+            prefix[ prefixLength++ ] = '-';
+            ++begin;
+        }
+        else if( spec.plusSign )
+        {
+            prefix[ prefixLength++ ] = '+';
+        }
+        else if( spec.spaceSign )
+        {
+            prefix[ prefixLength++ ] = ' ';
+        }
+        if( lower == 'a' && begin[ 0 ] == '0' && ( begin[ 1 ] | 0x20 ) == 'x' )
+        {
+            // Zero padding goes between 0x and the digits
+            prefix[ prefixLength++ ] = *begin++;
+            prefix[ prefixLength++ ] = *begin++;
+        }
+        if( ( *begin | 0x20 ) == 'i' || ( *begin | 0x20 ) == 'n' )
+        {
+            // inf and nan are never zero padded
+            spec.zeroPad = false;
+        }
+        emitNumber( out, spec, prefix, prefixLength, begin, static_cast< size_t >( end - begin ), 0 );
+    }
+
+    void emitArg( Output& out, const Spec& spec, const FormatArg& arg )
+    {
+        char conversion = spec.conversion;
+        bool isIntegerConversion = conversion == 'd' || conversion == 'i' || conversion == 'u'
+                                || conversion == 'x' || conversion == 'X' || conversion == 'o';
+        bool isFloatConversion = ( conversion | 0x20 ) == 'f' || ( conversion | 0x20 ) == 'e'
+                              || ( conversion | 0x20 ) == 'g' || ( conversion | 0x20 ) == 'a';
+        switch( arg.type )
+        {
+        case FormatArg::Type::None:
+            out.put( "<missing>", 9 );
+            break;
+        case FormatArg::Type::Signed:
+        case FormatArg::Type::Unsigned:
+        case FormatArg::Type::Char:
+        case FormatArg::Type::Bool:
+        {
+            bool isSigned = arg.type == FormatArg::Type::Signed || arg.type == FormatArg::Type::Char;
+            bool negative = isSigned && arg.i < 0;
+            uint64_t magnitude = negative ? 0 - static_cast< uint64_t >( arg.i ) : arg.u;
+            if( isFloatConversion )
+            {
+                emitDouble( out, spec, isSigned ? static_cast< double >( arg.i ) : static_cast< double >( arg.u ) );
+            }
+            else if( conversion == 'c' || ( conversion == 's' && arg.type == FormatArg::Type::Char ) )
+            {
+                char c = static_cast< char >( arg.i );
+                emitString( out, spec, &c, 1 );
+            }
+            else if( conversion == 's' && arg.type == FormatArg::Type::Bool )
+            {
+                emitString( out, spec, arg.u ? "true" : "false", arg.u ? 4 : 5 );
+            }
+            else if( negative && ( conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o' ) )
+            {
+                // Two's complement at the operand's width after promotion to
+                // int, as printf would show it
+                unsigned bytes = arg.size > sizeof( int ) ? arg.size : static_cast< unsigned >( sizeof( int ) );
+                uint64_t bits = bytes < sizeof( uint64_t ) ? arg.u & ( ( uint64_t( 1 ) << ( 8 * bytes ) ) - 1 ) : arg.u;
+                emitInteger( out, spec, false, bits );
+            }
+            else
+            {
+                Spec integerSpec = spec;
+                if( !isIntegerConversion )
+                {
+                    integerSpec.conversion = 'd';
+                    integerSpec.precision = -1;
+                }
+                emitInteger( out, integerSpec, negative, magnitude );
+            }
+            break;
+        }
+        case FormatArg::Type::Double:
+        {
+            if( isIntegerConversion )
+            {
+                double d = arg.d;
+                emitInteger( out, spec, d < 0, static_cast< uint64_t >( d < 0 ? -d : d ) );
+            }
+            else
+            {
+                Spec floatSpec = spec;
+                if( !isFloatConversion )
+                {
+                    floatSpec.conversion = 'g';
+                }
+                emitDouble( out, floatSpec, arg.d );
+            }
+            break;
+        }
+        case FormatArg::Type::String:
+            emitString( out, spec, arg.s.data, arg.s.size );
+            break;
+        case FormatArg::Type::Pointer:
+        {
+            Spec pointerSpec = spec;
+            pointerSpec.conversion = 'x';
+            pointerSpec.alternate = false;
+            pointerSpec.precision = -1;
+            char buffer[ 20 ];
+            char* end = buffer + sizeof( buffer );
+            char* digits = writeBase( end, reinterpret_cast< uintptr_t >( arg.p ), 4, false );
+            emitNumber( out, pointerSpec, "0x", 2, digits, static_cast< size_t >( end - digits ), 0 );
+            break;
+        }
+        }
+    }
+
+    int takeInt( const FormatArg* args, size_t argCount, size_t& next )
+    {
+        if( next >= argCount )
+        {
+            return 0;
+        }
+        const FormatArg& arg = args[ next++ ];
+        switch( arg.type )
+        {
+        case FormatArg::Type::Signed:
+        case FormatArg::Type::Char:
+            return static_cast< int >( arg.i );
+        case FormatArg::Type::Unsigned:
+        case FormatArg::Type::Bool:
+            return static_cast< int >( arg.u );
+        case FormatArg::Type::Double:
+            return static_cast< int >( arg.d );
+        default:
+            return 0;
+        }
+    }
+}
+
+size_t formatArgs( char* out, size_t outSize, const char* format, const FormatArg* args, size_t argCount )
+{
+    if( outSize == 0 )
+    {
+        return 0;
+    }
+    Output output{ out, out + outSize - 1 };
+    size_t next = 0;
+    const char* p = format;
+    while( *p && output.cursor < output.end )
+    {
+        if( *p != '%' )
+        {
+            const char* literal = p;
+            while( *p && *p != '%' )
+            {
+                ++p;
+            }
+            output.put( literal, static_cast< size_t >( p - literal ) );
+            continue;
+        }
+        ++p;
+        if( *p == '%' )
+        {
+            output.put( '%' );
+            ++p;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        const char* specStart = p - 1;
+        Spec spec;
+        for( ;; ++p )
+        {
+            if( *p == '-' ) { spec.leftAlign = true; }
+            else if( *p == '+' ) { spec.plusSign = true; }
+            else if( *p == ' ' ) { spec.spaceSign = true; }
+            else if( *p == '#' ) { spec.alternate = true; }
+            else if( *p == '0' ) { spec.zeroPad = true; }
+            else { break; }
+        }
+        if( *p == '*' )
+        {
+            spec.width = takeInt( args, argCount, next );
+            if( spec.width < 0 )
+            {
+                spec.leftAlign = true;
+                spec.width = -spec.width;
+            }
+            ++p;
+        }
+        while( *p >= '0' && *p <= '9' )
+        {
+            spec.width = spec.width * 10 + ( *p++ - '0' );
+        }
+        if( *p == '.' )
+        {
+            ++p;
+            spec.precision = 0;
+            if( *p == '*' )
+            {
+                spec.precision = takeInt( args, argCount, next );
+                ++p;
+            }
+            while( *p >= '0' && *p <= '9' )
+            {
+                spec.precision = spec.precision * 10 + ( *p++ - '0' );
+            }
+        }
+        while( *p == 'h' || *p == 'l' || *p == 'L' || *p == 'q' || *p == 'j' || *p == 'z' || *p == 't' )
+        {
+            ++p;
+        }
+        if( !*p )
+        {
+            // Dangling '%' at the end: print it as written
+            output.put( specStart, static_cast< size_t >( p - specStart ) );
+            break;
+        }
+        spec.conversion = *p++;
+        if( spec.leftAlign )
+        {
+            spec.zeroPad = false;
+        }
+        emitArg( output, spec, next < argCount ? args[ next ] : FormatArg() );
+        ++next;
+    }
+    *output.cursor = '\0';
+    return static_cast< size_t >( output.cursor - out );
+}
+
+} }
@@ -0,0 +1,230 @@
+#include <Core/FrameArena.hpp>
+#include <Core/Concurrency.hpp>
+#include <Core/Log.hpp>
+#include <Core/MemoryTracker.hpp>
+#include <Core/VirtualMemory.hpp>
+
+#include <cstdlib>
+
+namespace cobalt { namespace core {
+
+struct FrameArena::Buffer
+{
+    VirtualMemory::Region memory;
+    std::atomic< size_t > offset{ 0 };     // can run past the end when full
+    std::atomic< size_t > usedBytes{ 0 };  // what was actually handed out of memory
+
+    // Heap allocations made while the buffer was full, freed on reset
+    std::atomic_flag overflowLock = ATOMIC_FLAG_INIT;
+    std::vector< void* > overflow;
+    std::atomic< size_t > overflowBytes{ 0 };
+};
+
+namespace {
+
+    /// The chunk this thread is bumping through
+    struct ThreadChunk
+    {
+        uint64_t arenaId = 0;
+        uint64_t frame = 0;
+        char* cursor = nullptr;
+        char* end = nullptr;
+    };
+
+    thread_local ThreadChunk tChunk;
+    std::atomic< uint64_t > gNextArenaId{ 1 };
+
+    // The global arena is created on first use, with these settings unless
+    // configureGlobal() replaced them first.  It is never destroyed, so
+    // FrameAllocators still around during static destruction stay valid.
+    std::atomic< FrameArena* > gGlobalArena{ nullptr };
+    std::atomic_flag gGlobalLock = ATOMIC_FLAG_INIT;
+    size_t gGlobalBytesPerBuffer = 8 * 1024 * 1024; // guarded by gGlobalLock
+    unsigned gGlobalBufferCount = 2;                // guarded by gGlobalLock
+
+    char* alignUp( char* pointer, size_t alignment )
+    {
+        uintptr_t address = reinterpret_cast< uintptr_t >( pointer );
+        return reinterpret_cast< char* >( ( address + alignment - 1 ) & ~static_cast< uintptr_t >( alignment - 1 ) );
+    }
+
+    void lock( std::atomic_flag& flag )
+    {
+        while( flag.test_and_set( std::memory_order_acquire ) )
+        {
+            cpuRelax();
+        }
+    }
+
+    void unlock( std::atomic_flag& flag )
+    {
+        flag.clear( std::memory_order_release );
+    }
+
+}
+
+const size_t FrameArena::kThreadChunkSize;
+
+FrameArena::FrameArena( size_t bytesPerBuffer, unsigned bufferCount )
+    : mBuffers( new Buffer[ bufferCount > 0 ? bufferCount : 1 ] )
+    , mBufferCount( bufferCount > 0 ? bufferCount : 1 )
+    , mCapacity( bytesPerBuffer )
+    , mId( gNextArenaId.fetch_add( 1 ) )
+{
+    for( unsigned i = 0; i < mBufferCount; ++i )
+    {
+        // Untouched pages cost no memory until a frame first reaches them
+        mBuffers[ i ].memory = VirtualMemory::allocate( mCapacity, VirtualMemory::Pages::TransparentHuge );
+        if( !mBuffers[ i ].memory.isValid() )
+        {
+            // Everything will overflow to the heap
+            cobalt_log_error( "FrameArena: couldn't allocate a %zu byte buffer", mCapacity );
+        }
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for( unsigned i = 0; i < mBufferCount; ++i )
+    {
+        for( void* block : mBuffers[ i ].overflow )
+        {
+            std::free( block );
+        }
+        VirtualMemory::release( mBuffers[ i ].memory );
+    }
+}
+
+FrameArena& FrameArena::global()
+{
+    FrameArena* arena = gGlobalArena.load( std::memory_order_acquire );
+    if( arena )
+    {
+        return *arena;
+    }
+    lock( gGlobalLock );
+    arena = gGlobalArena.load( std::memory_order_relaxed );
+    if( !arena )
+    {
+        arena = new FrameArena( gGlobalBytesPerBuffer, gGlobalBufferCount );
+        gGlobalArena.store( arena, std::memory_order_release );
+    }
+    unlock( gGlobalLock );
+    return *arena;
+}
+
+void FrameArena::configureGlobal( size_t bytesPerBuffer, unsigned bufferCount )
+{
+    lock( gGlobalLock );
+    gGlobalBytesPerBuffer = bytesPerBuffer;
+    gGlobalBufferCount = bufferCount;
+    FrameArena* arena = gGlobalArena.load( std::memory_order_relaxed );
+    if( !arena || ( arena->capacity() == bytesPerBuffer && arena->bufferCount() == bufferCount ) )
+    {
+        unlock( gGlobalLock );
+        return;
+    }
+    bool isInUse = arena->frameIndex() > 0 || arena->bytesUsed() > 0;
+    if( !isInUse )
+    {
+        // Nothing was allocated from it, but something may still hold a
+        // reference to it, so it is left alive rather than deleted
+        gGlobalArena.store( new FrameArena( bytesPerBuffer, bufferCount ), std::memory_order_release );
+    }
+    unlock( gGlobalLock );
+    if( isInUse )
+    {
+        cobalt_log_cat_warn( Log::General, "FrameArena::configureGlobal( %zu, %u ) after the global arena was used; keeping %zu bytes x %u buffers",
+                             bytesPerBuffer, bufferCount, arena->capacity(), arena->bufferCount() );
+    }
+}
+
+FrameArena::Buffer& FrameArena::currentBuffer() const
+{
+    return mBuffers[ frameIndex() % mBufferCount ];
+}
+
+void* FrameArena::allocate( size_t size, size_t alignment )
+{
+    ThreadChunk& chunk = tChunk;
+    uint64_t frame = frameIndex();
+    if( chunk.arenaId == mId && chunk.frame == frame )
+    {
+        char* pointer = alignUp( chunk.cursor, alignment );
+        if( pointer + size <= chunk.end )
+        {
+            chunk.cursor = pointer + size;
+            return pointer;
+        }
+    }
+    // Big allocations go straight to the buffer rather than wasting most
+    // of a chunk
+    if( size + alignment > kThreadChunkSize / 4 )
+    {
+        return allocateShared( size, alignment );
+    }
+    char* memory = static_cast< char* >( allocateShared( kThreadChunkSize, alignof( std::max_align_t ) ) );
+    chunk.arenaId = mId;
+    chunk.frame = frame;
+    chunk.cursor = alignUp( memory, alignment ) + size;
+    chunk.end = memory + kThreadChunkSize;
+    return chunk.cursor - size;
+}
+
+void* FrameArena::allocateShared( size_t size, size_t alignment )
+{
+    Buffer& buffer = currentBuffer();
+    size_t padded = size + alignment - 1;
+    size_t offset = buffer.offset.fetch_add( padded, std::memory_order_relaxed );
+    if( offset + padded <= buffer.memory.size )
+    {
+        buffer.usedBytes.fetch_add( padded, std::memory_order_relaxed );
+        cobalt_memory_allocated( MemoryTracker::FrameArena, padded );
+        return alignUp( buffer.memory.base + offset, alignment );
+    }
+
+    cobalt_log_throttled_warn( Log::Frame, 1.0, "Frame arena full (%zu bytes per frame); falling back to the heap", mCapacity );
+    void* block = std::malloc( padded );
+    lock( buffer.overflowLock );
+    buffer.overflow.push_back( block );
+    unlock( buffer.overflowLock );
+    buffer.overflowBytes.fetch_add( padded, std::memory_order_relaxed );
+    cobalt_memory_allocated( MemoryTracker::FrameArena, padded );
+    return alignUp( static_cast< char* >( block ), alignment );
+}
+
+size_t FrameArena::bytesUsed() const
+{
+    Buffer& buffer = currentBuffer();
+    return buffer.usedBytes.load( std::memory_order_relaxed ) + buffer.overflowBytes.load( std::memory_order_relaxed );
+}
+
+size_t FrameArena::overflowBytes() const
+{
+    return currentBuffer().overflowBytes.load( std::memory_order_relaxed );
+}
+
+void FrameArena::nextFrame()
+{
+    size_t used = bytesUsed();
+    if( used > mHighWaterMark.load( std::memory_order_relaxed ) )
+    {
+        mHighWaterMark.store( used, std::memory_order_relaxed );
+    }
+
+    Buffer& buffer = mBuffers[ ( frameIndex() + 1 ) % mBufferCount ];
+    cobalt_memory_freed( MemoryTracker::FrameArena, buffer.usedBytes.load( std::memory_order_relaxed ) + buffer.overflowBytes.load( std::memory_order_relaxed ) );
+    buffer.offset.store( 0, std::memory_order_relaxed );
+    buffer.usedBytes.store( 0, std::memory_order_relaxed );
+    lock( buffer.overflowLock );
+    for( void* block : buffer.overflow )
+    {
+        std::free( block );
+    }
+    buffer.overflow.clear();
+    unlock( buffer.overflowLock );
+    buffer.overflowBytes.store( 0, std::memory_order_relaxed );
+    mFrameIndex.fetch_add( 1, std::memory_order_release );
+}
+
+} }
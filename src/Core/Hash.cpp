@@ -0,0 +1,95 @@
+#include <Core/Hash.hpp>
+
+#include <cstring>
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    const uint64_t kSecret[ 4 ] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+    // Little-endian reads; on big-endian machines the hashes differ but are
+    // just as good
+    uint64_t read64( const uint8_t* bytes )
+    {
+        uint64_t value;
+        std::memcpy( &value, bytes, sizeof( value ) );
+        return value;
+    }
+
+    uint64_t read32( const uint8_t* bytes )
+    {
+        uint32_t value;
+        std::memcpy( &value, bytes, sizeof( value ) );
+        return value;
+    }
+
+    /// 1 to 3 bytes
+    uint64_t readSmall( const uint8_t* bytes, size_t length )
+    {
+        return ( uint64_t( bytes[ 0 ] ) << 16 ) | ( uint64_t( bytes[ length >> 1 ] ) << 8 ) | bytes[ length - 1 ];
+    }
+
+}
+
+uint64_t hashBytes( const void* data, size_t length, uint64_t seed )
+{
+    const uint8_t* bytes = static_cast< const uint8_t* >( data );
+    seed ^= hashMix( seed ^ kSecret[ 0 ], kSecret[ 1 ] );
+    uint64_t a;
+    uint64_t b;
+    if( length <= 16 )
+    {
+        if( length >= 4 )
+        {
+            // Two overlapping pairs of 4-byte reads cover 4 to 16 bytes
+            size_t offset = ( length >> 3 ) << 2;
+            a = ( read32( bytes ) << 32 ) | read32( bytes + offset );
+            b = ( read32( bytes + length - 4 ) << 32 ) | read32( bytes + length - 4 - offset );
+        }
+        else if( length > 0 )
+        {
+            a = readSmall( bytes, length );
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t remaining = length;
+        if( remaining > 48 )
+        {
+            // Three independent lanes keep the multipliers busy
+            uint64_t lane1 = seed;
+            uint64_t lane2 = seed;
+            do
+            {
+                seed = hashMix( read64( bytes ) ^ kSecret[ 1 ], read64( bytes + 8 ) ^ seed );
+                lane1 = hashMix( read64( bytes + 16 ) ^ kSecret[ 2 ], read64( bytes + 24 ) ^ lane1 );
+                lane2 = hashMix( read64( bytes + 32 ) ^ kSecret[ 3 ], read64( bytes + 40 ) ^ lane2 );
+                bytes += 48;
+                remaining -= 48;
+            }
+            while( remaining > 48 );
+            seed ^= lane1 ^ lane2;
+        }
+        while( remaining > 16 )
+        {
+            seed = hashMix( read64( bytes ) ^ kSecret[ 1 ], read64( bytes + 8 ) ^ seed );
+            bytes += 16;
+            remaining -= 16;
+        }
+        // The last 16 bytes, overlapping what was already mixed if need be
+        a = read64( bytes + remaining - 16 );
+        b = read64( bytes + remaining - 8 );
+    }
+    a ^= kSecret[ 1 ];
+    b ^= seed;
+    multiply128( a, b, a, b );
+    return hashMix( a ^ kSecret[ 0 ] ^ length, b ^ kSecret[ 1 ] );
+}
+
+} }
@@ -0,0 +1,675 @@
+#include <Core/JobSystem.hpp>
+#include <Core/Concurrency.hpp>
+#include <Core/Log.hpp>
+#include <Core/Profiler.hpp>
+
+#if !COBALT_NO_THREADS
+    #if COBALT_USE_TBB
+        #include <tbb/task_arena.h>
+        #include <tbb/task_group.h>
+    #else
+        #include <condition_variable>
+        #include <deque>
+        #include <memory>
+        #include <mutex>
+        #include <thread>
+        #include <vector>
+    #endif
+#endif
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    /// Finished jobs go back to the free list of the thread that allocated
+    /// them, so a thread that only submits (the main thread, usually) gets
+    /// back what the workers ran.  The owner pops its own stack without
+    /// locking; other threads push onto `returned`, which the owner takes
+    /// whole when its own stack runs dry.
+    ///
+    /// Lists are never freed: when a thread exits its list, jobs and all, is
+    /// handed to the next new thread, and jobs still out return to it, so
+    /// the lists are bounded by the most threads ever alive at once.
+    struct JobFreeList
+    {
+        Job* head = nullptr;                    // owner only
+        std::atomic< Job* > returned{ nullptr };
+        std::atomic< bool > isInUse{ true };
+        JobFreeList* next = nullptr;            // in gFreeLists
+    };
+
+    std::atomic_flag gFreeListsLock = ATOMIC_FLAG_INIT;
+    JobFreeList* gFreeLists = nullptr; // guarded by gFreeListsLock
+
+    struct JobFreeListHandle
+    {
+        JobFreeList* list = nullptr;
+
+        ~JobFreeListHandle()
+        {
+            if( list )
+            {
+                list->isInUse.store( false, std::memory_order_release );
+            }
+        }
+    };
+
+    thread_local JobFreeListHandle tFreeJobs;
+
+    void freeJob( Job* job )
+    {
+        JobFreeList* owner = static_cast< JobFreeList* >( job->owner );
+        if( owner == tFreeJobs.list )
+        {
+            job->next = owner->head;
+            owner->head = job;
+            return;
+        }
+        Job* head = owner->returned.load( std::memory_order_relaxed );
+        do
+        {
+            job->next = head;
+        }
+        while( !owner->returned.compare_exchange_weak( head, job, std::memory_order_release, std::memory_order_relaxed ) );
+    }
+
+    void lock( std::atomic_flag& flag )
+    {
+        while( flag.test_and_set( std::memory_order_acquire ) )
+        {
+            cpuRelax();
+        }
+    }
+
+    void unlock( std::atomic_flag& flag )
+    {
+        flag.clear( std::memory_order_release );
+    }
+
+#if !COBALT_NO_THREADS && !COBALT_USE_TBB
+
+    /// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+    /// Work-Stealing for Weak Memory Models", 2013), fixed capacity.
+    /// push() and pop() are only called by the owning thread; steal() by any.
+    class WorkStealingDeque
+    {
+    public:
+        explicit WorkStealingDeque( size_t capacity )
+        {
+            size_t size = 1;
+            while( size < capacity )
+            {
+                size *= 2;
+            }
+            mBuffer.reset( new std::atomic< Job* >[ size ] );
+            mMask = static_cast< int64_t >( size ) - 1;
+        }
+
+        /// False when full
+        bool push( Job* job )
+        {
+            int64_t bottom = mBottom.load( std::memory_order_relaxed );
+            int64_t top = mTop.load( std::memory_order_acquire );
+            if( bottom - top > mMask )
+            {
+                return false;
+            }
+            mBuffer[ bottom & mMask ].store( job, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            mBottom.store( bottom + 1, std::memory_order_relaxed );
+            return true;
+        }
+
+        Job* pop()
+        {
+            int64_t bottom = mBottom.load( std::memory_order_relaxed ) - 1;
+            mBottom.store( bottom, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            int64_t top = mTop.load( std::memory_order_relaxed );
+            if( top > bottom )
+            {
+                mBottom.store( bottom + 1, std::memory_order_relaxed );
+                return nullptr;
+            }
+            Job* job = mBuffer[ bottom & mMask ].load( std::memory_order_relaxed );
+            if( top == bottom )
+            {
+                // Last one; race the thieves for it
+                if( !mTop.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+                {
+                    job = nullptr;
+                }
+                mBottom.store( bottom + 1, std::memory_order_relaxed );
+            }
+            return job;
+        }
+
+        Job* steal()
+        {
+            int64_t top = mTop.load( std::memory_order_acquire );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            int64_t bottom = mBottom.load( std::memory_order_acquire );
+            if( top >= bottom )
+            {
+                return nullptr;
+            }
+            Job* job = mBuffer[ top & mMask ].load( std::memory_order_relaxed );
+            if( !mTop.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+            {
+                return nullptr;
+            }
+            return job;
+        }
+
+    private:
+        // Padded rather than alignas'd: C++14 new ignores extended alignment
+        std::atomic< int64_t > mTop{ 0 };
+        char mTopPadding[ kCacheLineSize ];
+        std::atomic< int64_t > mBottom{ 0 };
+        char mBottomPadding[ kCacheLineSize ];
+        std::unique_ptr< std::atomic< Job* >[] > mBuffer;
+        int64_t mMask = 0;
+    };
+
+    struct Worker
+    {
+        explicit Worker( size_t dequeCapacity ) : deque( dequeCapacity ) {}
+
+        WorkStealingDeque deque;
+        std::thread thread;
+        uint32_t random = 0; // xorshift state for picking victims
+    };
+
+    // Index into gWorkers of the calling thread's deque; -1 for threads that
+    // aren't part of the job system
+    thread_local int tWorkerIndex = -1;
+
+    std::vector< std::unique_ptr< Worker > > gWorkers; // [0] is the thread that called startup()
+    std::atomic< bool > gIsRunning{ false };
+    std::atomic< bool > gIsStopping{ false };
+
+    std::mutex gInjectedMutex;
+    std::deque< Job* > gInjected;
+    std::atomic< int64_t > gInjectedCount{ 0 };
+
+    std::atomic< int64_t > gQueuedCount{ 0 };      // jobs sitting in a queue
+    std::atomic< int64_t > gOutstandingCount{ 0 }; // jobs submitted and not yet finished
+
+    std::mutex gSleepMutex;
+    std::condition_variable gSleepCondition;
+    std::atomic< int > gSleepingCount{ 0 };
+
+    const int kIdleSpins = 64;
+
+    void wakeWorker()
+    {
+        if( gSleepingCount.load() > 0 )
+        {
+            std::lock_guard< std::mutex > lock( gSleepMutex );
+            gSleepCondition.notify_one();
+        }
+    }
+
+    Job* takeInjected()
+    {
+        if( gInjectedCount.load( std::memory_order_relaxed ) == 0 )
+        {
+            return nullptr;
+        }
+        std::lock_guard< std::mutex > lock( gInjectedMutex );
+        if( gInjected.empty() )
+        {
+            return nullptr;
+        }
+        Job* job = gInjected.front();
+        gInjected.pop_front();
+        gInjectedCount.fetch_sub( 1, std::memory_order_relaxed );
+        return job;
+    }
+
+    Job* findJob( int self )
+    {
+        Job* job = nullptr;
+        if( self >= 0 )
+        {
+            job = gWorkers[ self ]->deque.pop();
+        }
+        if( !job )
+        {
+            job = takeInjected();
+        }
+        if( !job )
+        {
+            int count = static_cast< int >( gWorkers.size() );
+            uint32_t start = 0;
+            if( self >= 0 )
+            {
+                uint32_t& x = gWorkers[ self ]->random;
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                start = x;
+            }
+            for( int i = 0; i < count && !job; ++i )
+            {
+                int victim = static_cast< int >( ( start + i ) % count );
+                if( victim != self )
+                {
+                    job = gWorkers[ victim ]->deque.steal();
+                }
+            }
+        }
+        if( job )
+        {
+            gQueuedCount.fetch_sub( 1 );
+        }
+        return job;
+    }
+
+#endif
+
+}
+
+#if COBALT_USE_TBB && !COBALT_NO_THREADS
+
+namespace {
+
+    tbb::task_arena* gArena = nullptr;
+    tbb::task_group* gDetachedGroup = nullptr; // jobs run without a counter
+
+    tbb::task_group& groupFor( std::atomic< void* >& backend )
+    {
+        void* group = backend.load( std::memory_order_acquire );
+        if( !group )
+        {
+            tbb::task_group* created = new tbb::task_group;
+            if( backend.compare_exchange_strong( group, created ) )
+            {
+                group = created;
+            }
+            else
+            {
+                delete created;
+            }
+        }
+        return *static_cast< tbb::task_group* >( group );
+    }
+
+}
+
+#endif
+
+JobCounter::~JobCounter()
+{
+    cobalt_assert_msg( isDone(), JobCounter destroyed with jobs outstanding );
+#if COBALT_USE_TBB && !COBALT_NO_THREADS
+    delete static_cast< tbb::task_group* >( mBackend.load() );
+#endif
+}
+
+Job* JobSystem::allocateJob()
+{
+    JobFreeList* list = tFreeJobs.list;
+    if( !list )
+    {
+        lock( gFreeListsLock );
+        for( JobFreeList* unused = gFreeLists; unused; unused = unused->next )
+        {
+            if( !unused->isInUse.load( std::memory_order_acquire ) )
+            {
+                unused->isInUse.store( true, std::memory_order_relaxed );
+                list = unused;
+                break;
+            }
+        }
+        if( !list )
+        {
+            list = new JobFreeList;
+            list->next = gFreeLists;
+            gFreeLists = list;
+        }
+        unlock( gFreeListsLock );
+        tFreeJobs.list = list;
+    }
+    if( !list->head )
+    {
+        list->head = list->returned.exchange( nullptr, std::memory_order_acquire );
+    }
+    Job* job = list->head;
+    if( job )
+    {
+        list->head = job->next;
+        job->next = nullptr;
+        return job;
+    }
+    job = new Job;
+    job->owner = list;
+    return job;
+}
+
+void JobSystem::submit( Job* job, JobCounter* dependency )
+{
+    if( job->counter )
+    {
+        job->counter->mCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+#if !COBALT_NO_THREADS && !COBALT_USE_TBB
+    gOutstandingCount.fetch_add( 1 );
+#endif
+    if( dependency )
+    {
+        // Park the job on the dependency; whoever finishes its last job
+        // queues it.  If the dependency is already done, queue it ourselves.
+        lock( dependency->mContinuationLock );
+        job->next = dependency->mContinuations;
+        dependency->mContinuations = job;
+        uint32_t count = dependency->mCount.load();
+        while( true )
+        {
+            if( ( count & JobCounter::kCountMask ) == 0 )
+            {
+                dependency->mContinuations = job->next;
+                job->next = nullptr;
+                unlock( dependency->mContinuationLock );
+                enqueue( job );
+                return;
+            }
+            if( dependency->mCount.compare_exchange_weak( count, count | JobCounter::kHasContinuations ) )
+            {
+                unlock( dependency->mContinuationLock );
+                return;
+            }
+        }
+    }
+    enqueue( job );
+}
+
+void JobSystem::execute( Job* job )
+{
+    job->invoke( *job );
+    JobCounter* counter = job->counter;
+    freeJob( job );
+#if !COBALT_NO_THREADS && !COBALT_USE_TBB
+    gOutstandingCount.fetch_sub( 1 );
+#endif
+    if( !counter )
+    {
+        return;
+    }
+    uint32_t previous = counter->mCount.fetch_sub( 1, std::memory_order_acq_rel );
+    if( ( previous & JobCounter::kCountMask ) != 1 || !( previous & JobCounter::kHasContinuations ) )
+    {
+        // Unless we're handing off continuations, the counter may be gone now
+        return;
+    }
+    lock( counter->mContinuationLock );
+    Job* continuations = counter->mContinuations;
+    counter->mContinuations = nullptr;
+    unlock( counter->mContinuationLock );
+    // Last touch of the counter; waiters may return from here on
+    counter->mCount.fetch_and( ~JobCounter::kHasContinuations, std::memory_order_release );
+
+    while( continuations )
+    {
+        Job* next = continuations->next;
+        continuations->next = nullptr;
+        enqueue( continuations );
+        continuations = next;
+    }
+}
+
+void JobSystem::startup()
+{
+    startup( Config() );
+}
+
+#if COBALT_NO_THREADS
+
+void JobSystem::startup( const Config& )
+{
+}
+
+void JobSystem::shutdown()
+{
+}
+
+bool JobSystem::isRunning()
+{
+    return false;
+}
+
+unsigned JobSystem::workerCount()
+{
+    return 0;
+}
+
+void JobSystem::enqueue( Job* job )
+{
+    execute( job );
+}
+
+void JobSystem::wait( JobCounter& counter )
+{
+    // Everything ran inline during submission
+    cobalt_assert( counter.isDone() );
+}
+
+#elif COBALT_USE_TBB
+
+void JobSystem::startup( const Config& config )
+{
+    cobalt_assert_msg( !gArena, JobSystem already started );
+    gArena = config.workerCount > 0
+        ? new tbb::task_arena( static_cast< int >( config.workerCount ) + 1 )
+        : new tbb::task_arena();
+    gDetachedGroup = new tbb::task_group;
+    cobalt_log_info( "JobSystem started on TBB with %u workers", workerCount() );
+}
+
+void JobSystem::shutdown()
+{
+    if( !gArena )
+    {
+        return;
+    }
+    gArena->execute( []() { gDetachedGroup->wait(); } );
+    delete gDetachedGroup;
+    gDetachedGroup = nullptr;
+    delete gArena;
+    gArena = nullptr;
+}
+
+bool JobSystem::isRunning()
+{
+    return gArena != nullptr;
+}
+
+unsigned JobSystem::workerCount()
+{
+    return gArena ? static_cast< unsigned >( gArena->max_concurrency() - 1 ) : 0;
+}
+
+void JobSystem::enqueue( Job* job )
+{
+    if( !gArena )
+    {
+        execute( job );
+        return;
+    }
+    tbb::task_group& group = job->counter
+        ? groupFor( job->counter->mBackend )
+        : *gDetachedGroup;
+    gArena->execute( [&]() { group.run( [job]() { execute( job ); } ); } );
+}
+
+void JobSystem::wait( JobCounter& counter )
+{
+    while( !counter.isDone() )
+    {
+        void* group = counter.mBackend.load( std::memory_order_acquire );
+        if( group && gArena )
+        {
+            gArena->execute( [group]() { static_cast< tbb::task_group* >( group )->wait(); } );
+        }
+        else
+        {
+            // Continuations not yet handed to TBB
+            cpuRelax();
+        }
+    }
+}
+
+#else
+
+void JobSystem::startup( const Config& config )
+{
+    cobalt_assert_msg( !gIsRunning.load(), JobSystem already started );
+    unsigned workerCount = config.workerCount;
+    if( workerCount == 0 )
+    {
+        unsigned hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    gIsStopping.store( false );
+    gWorkers.clear();
+    for( unsigned i = 0; i <= workerCount; ++i )
+    {
+        gWorkers.emplace_back( new Worker( config.dequeCapacity ) );
+        gWorkers.back()->random = 2654435761u * ( i + 1 );
+    }
+    tWorkerIndex = 0;
+    gIsRunning.store( true );
+
+    for( unsigned i = 1; i <= workerCount; ++i )
+    {
+        std::function< void( unsigned ) > onWorkerStart = config.onWorkerStart;
+        gWorkers[ i ]->thread = std::thread( [i, onWorkerStart]()
+        {
+            tWorkerIndex = static_cast< int >( i );
+            cobalt_profile_thread_name( "Job Worker" );
+            if( onWorkerStart )
+            {
+                onWorkerStart( i - 1 );
+            }
+            int idleSpins = 0;
+            while( !gIsStopping.load( std::memory_order_relaxed ) )
+            {
+                if( Job* job = findJob( tWorkerIndex ) )
+                {
+                    execute( job );
+                    idleSpins = 0;
+                }
+                else if( ++idleSpins < kIdleSpins )
+                {
+                    cpuRelax();
+                }
+                else
+                {
+                    // Sleepers are counted before re-checking for work, and
+                    // enqueue() counts work before checking for sleepers, so
+                    // one of the two always sees the other
+                    std::unique_lock< std::mutex > lock( gSleepMutex );
+                    gSleepingCount.fetch_add( 1 );
+                    gSleepCondition.wait( lock, []() { return gQueuedCount.load() > 0 || gIsStopping.load(); } );
+                    gSleepingCount.fetch_sub( 1 );
+                    idleSpins = 0;
+                }
+            }
+        } );
+    }
+    cobalt_log_info( "JobSystem started with %u workers", workerCount );
+}
+
+void JobSystem::shutdown()
+{
+    if( !gIsRunning.load() )
+    {
+        return;
+    }
+    cobalt_assert_msg( tWorkerIndex == 0, shutdown() must be called from the thread that called startup() );
+    while( gOutstandingCount.load() > 0 )
+    {
+        if( Job* job = findJob( tWorkerIndex ) )
+        {
+            execute( job );
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    {
+        std::lock_guard< std::mutex > lock( gSleepMutex );
+        gIsStopping.store( true );
+    }
+    gSleepCondition.notify_all();
+    for( size_t i = 1; i < gWorkers.size(); ++i )
+    {
+        gWorkers[ i ]->thread.join();
+    }
+    gIsRunning.store( false );
+    gWorkers.clear();
+    tWorkerIndex = -1;
+}
+
+bool JobSystem::isRunning()
+{
+    return gIsRunning.load();
+}
+
+unsigned JobSystem::workerCount()
+{
+    return gIsRunning.load() ? static_cast< unsigned >( gWorkers.size() - 1 ) : 0;
+}
+
+void JobSystem::enqueue( Job* job )
+{
+    if( !gIsRunning.load( std::memory_order_relaxed ) )
+    {
+        execute( job );
+        return;
+    }
+    if( tWorkerIndex >= 0 )
+    {
+        if( !gWorkers[ tWorkerIndex ]->deque.push( job ) )
+        {
+            // Deque full; running it now beats growing the deque
+            execute( job );
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard< std::mutex > lock( gInjectedMutex );
+        gInjected.push_back( job );
+        gInjectedCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+    gQueuedCount.fetch_add( 1 );
+    wakeWorker();
+}
+
+void JobSystem::wait( JobCounter& counter )
+{
+    int idleSpins = 0;
+    while( !counter.isDone() )
+    {
+        if( Job* job = gIsRunning.load( std::memory_order_relaxed ) ? findJob( tWorkerIndex ) : nullptr )
+        {
+            execute( job );
+            idleSpins = 0;
+        }
+        else if( ++idleSpins < kIdleSpins )
+        {
+            cpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+#endif
+
+} }
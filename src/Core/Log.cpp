@@ -1,88 +1,339 @@
 #include <cstdio>
-#include <cstdarg>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
+#include <chrono>
+
+#if !COBALT_NO_THREADS
+    #include <thread>
+#endif
+
+#include <Core/Clock.hpp>
 #include <Core/Log.hpp>
+#include <Core/BinaryLog.hpp>
+#include <Core/FlightRecorder.hpp>
 
 namespace cobalt {
 using namespace core;
 
 Log::Level Log::sMinLogLevel = Level::Debug;
+uint32_t Log::sEnabledCategories = Log::AllCategories;
+
+namespace {
+
+    // Longest single line; longer messages are truncated.
+    const size_t kMaxLineLength = 1024;
+
+    // Largest ring record payload, including its kind tag
+    const size_t kMaxRingRecordSize = 1 + ( kMaxLineLength > BinaryLog::kMaxRecordSize ? kMaxLineLength : BinaryLog::kMaxRecordSize );
+
+    enum class RecordKind : char { Text = 'T', Deferred = 'D' };
+
+    /// Single-producer/single-consumer byte ring owned by one logging thread.
+    /// Records are a 32-bit size, a RecordKind tag and then either the line
+    /// bytes (no terminator) or a BinaryLog event, and may wrap around the end
+    /// of the buffer.
+    struct LogRing
+    {
+        static const size_t kCapacity = 256 * 1024; // must be a power of two
+        static const size_t kMask = kCapacity - 1;
+
+        // Padded apart so the producer and the drainer don't false-share
+        std::atomic< size_t > head{ 0 }; // advanced by the owning thread
+        char pad0[ 64 - sizeof( std::atomic< size_t > ) ];
+        std::atomic< size_t > tail{ 0 }; // advanced by the drainer
+        char pad1[ 64 - sizeof( std::atomic< size_t > ) ];
+        std::atomic< bool > inUse{ true };
+        LogRing* next = nullptr;
+        char data[ kCapacity ];
+
+        void copyIn( size_t pos, const void* src, size_t len )
+        {
+            size_t offset = pos & kMask;
+            size_t first = std::min( len, kCapacity - offset );
+            std::memcpy( data + offset, src, first );
+            std::memcpy( data, static_cast< const char* >( src ) + first, len - first );
+        }
+
+        void copyOut( size_t pos, void* dst, size_t len ) const
+        {
+            size_t offset = pos & kMask;
+            size_t first = std::min( len, kCapacity - offset );
+            std::memcpy( dst, data + offset, first );
+            std::memcpy( static_cast< char* >( dst ) + first, data, len - first );
+        }
+
+        bool push( RecordKind kind, const char* payload, uint32_t len )
+        {
+            uint32_t size = len + 1;
+            size_t h = head.load( std::memory_order_relaxed );
+            size_t t = tail.load( std::memory_order_acquire );
+            if( kCapacity - ( h - t ) < sizeof( size ) + size )
+            {
+                return false;
+            }
+            char tag = static_cast< char >( kind );
+            copyIn( h, &size, sizeof( size ) );
+            copyIn( h + sizeof( size ), &tag, 1 );
+            copyIn( h + sizeof( size ) + 1, payload, len );
+            head.store( h + sizeof( size ) + size, std::memory_order_release );
+            return true;
+        }
+
+        // Returns true if anything was written.
+        bool drain( std::FILE* out )
+        {
+            size_t t = tail.load( std::memory_order_relaxed );
+            size_t h = head.load( std::memory_order_acquire );
+            if( t == h )
+            {
+                return false;
+            }
+            char record[ kMaxRingRecordSize ];
+            while( t != h )
+            {
+                uint32_t size;
+                copyOut( t, &size, sizeof( size ) );
+                copyOut( t + sizeof( size ), record, size );
+                if( record[ 0 ] == static_cast< char >( RecordKind::Text ) )
+                {
+                    std::fwrite( record + 1, 1, size - 1, out );
+                }
+                else
+                {
+                    BinaryLog::drain( record + 1, size - 1, out );
+                }
+                t += sizeof( size ) + size;
+            }
+            tail.store( t, std::memory_order_release );
+            return true;
+        }
+    };
+
+    struct AsyncState
+    {
+        std::atomic< bool > isAsync{ false };
+        std::atomic< std::FILE* > output{ nullptr };
+        std::atomic< LogRing* > rings{ nullptr };
+        std::atomic< unsigned long > dropped{ 0 };
+        unsigned long droppedReported = 0; // guarded by drainMutex
+        std::mutex drainMutex; // serializes drainers only, never taken by loggers
+#if !COBALT_NO_THREADS
+        std::thread flushThread;
+        std::atomic< bool > flushThreadRunning{ false };
+#endif
+
+        ~AsyncState()
+        {
+            Log::stopAsync();
+        }
+
+        // Claim an abandoned ring or allocate a new one; rings are never freed.
+        LogRing* acquireRing()
+        {
+            for( LogRing* ring = rings.load( std::memory_order_acquire ); ring; ring = ring->next )
+            {
+                bool expected = false;
+                if( ring->inUse.compare_exchange_strong( expected, true ) )
+                {
+                    return ring;
+                }
+            }
+            LogRing* ring = new LogRing;
+            ring->next = rings.load( std::memory_order_relaxed );
+            while( !rings.compare_exchange_weak( ring->next, ring, std::memory_order_release, std::memory_order_relaxed ) ) {}
+            return ring;
+        }
+
+        bool drainAll()
+        {
+            std::lock_guard< std::mutex > lock( drainMutex );
+            std::FILE* out = output.load();
+            bool wroteAnything = false;
+            for( LogRing* ring = rings.load( std::memory_order_acquire ); ring; ring = ring->next )
+            {
+                wroteAnything |= ring->drain( out );
+            }
+            unsigned long droppedNow = dropped.load( std::memory_order_relaxed );
+            if( droppedNow != droppedReported )
+            {
+                std::fprintf( out, "Cobalt Log: %lu lines dropped, log ring buffer full\n", droppedNow - droppedReported );
+                droppedReported = droppedNow;
+                wroteAnything = true;
+            }
+            if( wroteAnything )
+            {
+                std::fflush( out );
+            }
+            return wroteAnything;
+        }
+    };
+
+    AsyncState gAsync;
+
+    struct ThreadRingOwner
+    {
+        LogRing* ring = nullptr;
+        ~ThreadRingOwner()
+        {
+            if( ring )
+            {
+                ring->inUse.store( false );
+            }
+        }
+        LogRing* get()
+        {
+            if( !ring )
+            {
+                ring = gAsync.acquireRing();
+            }
+            return ring;
+        }
+    };
 
-void Log::assert( const char *condition, const char *message, const char *file, int line, const char *function )
+    thread_local ThreadRingOwner tRing;
+
+    void writeLine( const char* line, size_t len )
+    {
+        if( gAsync.isAsync.load( std::memory_order_relaxed ) )
+        {
+            if( !tRing.get()->push( RecordKind::Text, line, static_cast< uint32_t >( len ) ) )
+            {
+                gAsync.dropped.fetch_add( 1, std::memory_order_relaxed );
+            }
+        }
+        else
+        {
+            // One write per line so concurrent loggers don't interleave mid-line
+            std::fwrite( line, 1, len, stdout );
+        }
+    }
+}
+
+void Log::assertFailed( const char *condition, const char *message, const char *file, int line, const char *function )
 {
-    std::printf( "Cobalt ASSERT: (%s)\\n\"%s\", %s:%d in %s\n", condition, message, file, line, function );
+    char text[ kMaxLineLength + 1 ];
+    size_t len = message
+        ? format( text, kMaxLineLength, "Cobalt ASSERT: (%s) \"%s\", %s:%d in %s", condition, message, file, line, function )
+        : format( text, kMaxLineLength, "Cobalt ASSERT: (%s), %s:%d in %s", condition, file, line, function );
+    FlightRecorder::write( Level::Fatal, text, len, FlightRecorder::AssertFlag );
+    text[ len++ ] = '\n';
+    writeLine( text, len );
+    flush();
 }
 
-void Log::log( Level level, const char *msg, ... )
+void Log::logArgs( Level level, const char *msg, const FormatArg* args, size_t argCount, uint32_t repeated )
 {
     if( sMinLogLevel <= level )
     {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
+        char line[ kMaxLineLength + 1 ];
+        size_t len = formatArgs( line, kMaxLineLength, msg, args, argCount );
+        if( repeated )
+        {
+            len += format( line + len, kMaxLineLength - len, " (repeated %u times)", repeated );
+        }
+        FlightRecorder::write( level, line, len );
+        line[ len++ ] = '\n';
+        writeLine( line, len );
+        if( level == Level::Fatal )
+        {
+            // Don't let the last words sit in a buffer
+            flush();
+        }
     }
 }
 
-void Log::debug( const char *msg, ... )
+LogThrottle::LogThrottle( double intervalSeconds )
+    : mIntervalNs( static_cast< int64_t >( intervalSeconds * 1e9 ) )
 {
-    if( sMinLogLevel <= Log::Level::Debug )
-    {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
-    }
 }
 
-void Log::info( const char *msg, ... )
+bool LogThrottle::allow( uint32_t& suppressed )
 {
-    if( sMinLogLevel <= Log::Level::Info )
+    int64_t now = Clock::nowNs();
+    int64_t next = mNextAllowedNs.load( std::memory_order_relaxed );
+    if( now < next || !mNextAllowedNs.compare_exchange_strong( next, now + mIntervalNs, std::memory_order_relaxed ) )
     {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
+        mSuppressed.fetch_add( 1, std::memory_order_relaxed );
+        return false;
     }
+    suppressed = mSuppressed.exchange( 0, std::memory_order_relaxed );
+    return true;
 }
 
-void Log::warn( const char *msg, ... )
+void Log::commitDeferred( const char* record, size_t size )
 {
-    if( sMinLogLevel <= Log::Level::Warn )
+    if( gAsync.isAsync.load( std::memory_order_relaxed ) )
+    {
+        if( !tRing.get()->push( RecordKind::Deferred, record, static_cast< uint32_t >( size ) ) )
+        {
+            gAsync.dropped.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+    else
     {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
+        std::lock_guard< std::mutex > lock( gAsync.drainMutex );
+        BinaryLog::drain( record, size, stdout );
     }
 }
 
-void Log::error( const char *msg, ... )
+void Log::startAsync( std::FILE* output )
 {
-    if( sMinLogLevel <= Log::Level::Error )
+    if( gAsync.isAsync.load() )
     {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
+        return;
     }
+    std::fflush( stdout );
+    gAsync.output.store( output ? output : stdout );
+    gAsync.isAsync.store( true );
+#if !COBALT_NO_THREADS
+    gAsync.flushThreadRunning.store( true );
+    gAsync.flushThread = std::thread( []
+    {
+        while( gAsync.flushThreadRunning.load( std::memory_order_relaxed ) )
+        {
+            if( !gAsync.drainAll() )
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+        }
+    } );
+#endif
 }
 
-void Log::fatal( const char *msg, ... )
+void Log::stopAsync()
 {
-    if( sMinLogLevel <= Log::Level::Fatal )
+    if( !gAsync.isAsync.exchange( false ) )
     {
-        va_list args;
-        va_start( args, msg );
-        std::vprintf( msg, args );
-        std::printf( "\n" );
-        va_end( args );
+        return;
     }
+#if !COBALT_NO_THREADS
+    gAsync.flushThreadRunning.store( false );
+    if( gAsync.flushThread.joinable() )
+    {
+        gAsync.flushThread.join();
+    }
+#endif
+    gAsync.drainAll();
+}
+
+void Log::flush()
+{
+    gAsync.drainAll();
+    std::fflush( stdout );
+}
+
+bool Log::isAsync()
+{
+    return gAsync.isAsync.load( std::memory_order_relaxed );
+}
+
+unsigned long Log::droppedCount()
+{
+    return gAsync.dropped.load( std::memory_order_relaxed );
 }
 
 }
@@ -0,0 +1,299 @@
+#include <Core/MemoryTracker.hpp>
+#include <Core/Concurrency.hpp>
+#include <Core/Format.hpp>
+#include <Core/Log.hpp>
+
+#include <atomic>
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    /// Running totals, written only by the owning thread
+    struct TagCounters
+    {
+        std::atomic< uint64_t > allocatedBytes{ 0 };
+        std::atomic< uint64_t > freedBytes{ 0 };
+        std::atomic< uint64_t > allocations{ 0 };
+    };
+
+    /// One per thread that has recorded anything.  Never freed: when a
+    /// thread exits, its totals stay in the sums and the next new thread
+    /// carries on from them.
+    struct ThreadCounters
+    {
+        TagCounters tags[ MemoryTracker::kMaxTags ];
+        std::atomic< bool > isInUse{ true };
+        ThreadCounters* next = nullptr;
+    };
+
+    /// What nextFrame() keeps between frames
+    struct TagState
+    {
+        const char* name = nullptr;
+        size_t budget = 0;
+        size_t peakBytes = 0;
+        bool isOverBudget = false;
+        uint64_t lastAllocatedBytes = 0;
+        uint64_t lastAllocations = 0;
+        uint64_t frameAllocations = 0;
+        uint64_t frameBytes = 0;
+        uint64_t heaviestFrameBytes = 0;
+        uint64_t heaviestFrame = 0;
+    };
+
+    struct Totals
+    {
+        uint64_t allocatedBytes = 0;
+        uint64_t freedBytes = 0;
+        uint64_t allocations = 0;
+
+        // Other threads' counters are read at slightly different times, so
+        // a free can be seen before its allocation
+        size_t liveBytes() const { return allocatedBytes > freedBytes ? static_cast< size_t >( allocatedBytes - freedBytes ) : 0; }
+    };
+
+    std::atomic_flag gLock = ATOMIC_FLAG_INIT;
+    ThreadCounters* gThreads = nullptr; // guarded by gLock, as is everything below
+    TagState gTags[ MemoryTracker::kMaxTags ];
+    uint64_t gFrame = 0;
+    bool gHasDefaultNames = false;
+
+    void lock()
+    {
+        while( gLock.test_and_set( std::memory_order_acquire ) )
+        {
+            cpuRelax();
+        }
+    }
+
+    void unlock()
+    {
+        gLock.clear( std::memory_order_release );
+    }
+
+    /// Called with gLock held
+    void setDefaultNames()
+    {
+        if( !gHasDefaultNames )
+        {
+            gTags[ MemoryTracker::General ].name = "General";
+            gTags[ MemoryTracker::FrameArena ].name = "FrameArena";
+            gTags[ MemoryTracker::ObjectPools ].name = "ObjectPools";
+            gTags[ MemoryTracker::Heaps ].name = "Heaps";
+            gHasDefaultNames = true;
+        }
+    }
+
+    struct ThreadHandle
+    {
+        ThreadCounters* counters = nullptr;
+
+        ~ThreadHandle()
+        {
+            if( counters )
+            {
+                counters->isInUse.store( false, std::memory_order_release );
+            }
+        }
+    };
+
+    thread_local ThreadHandle tThread;
+
+    ThreadCounters& threadCounters()
+    {
+        ThreadCounters* counters = tThread.counters;
+        if( counters )
+        {
+            return *counters;
+        }
+        lock();
+        for( ThreadCounters* unused = gThreads; unused; unused = unused->next )
+        {
+            if( !unused->isInUse.load( std::memory_order_acquire ) )
+            {
+                unused->isInUse.store( true, std::memory_order_relaxed );
+                counters = unused;
+                break;
+            }
+        }
+        if( !counters )
+        {
+            counters = new ThreadCounters;
+            counters->next = gThreads;
+            gThreads = counters;
+        }
+        unlock();
+        tThread.counters = counters;
+        return *counters;
+    }
+
+    void add( std::atomic< uint64_t >& counter, uint64_t value )
+    {
+        // Only this thread writes the counter, so no read-modify-write needed
+        counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+    }
+
+    /// Called with gLock held
+    Totals totals( unsigned tag )
+    {
+        Totals totals;
+        for( ThreadCounters* counters = gThreads; counters; counters = counters->next )
+        {
+            const TagCounters& tagCounters = counters->tags[ tag ];
+            totals.allocatedBytes += tagCounters.allocatedBytes.load( std::memory_order_relaxed );
+            totals.freedBytes += tagCounters.freedBytes.load( std::memory_order_relaxed );
+            totals.allocations += tagCounters.allocations.load( std::memory_order_relaxed );
+        }
+        return totals;
+    }
+
+    double mebibytes( uint64_t bytes )
+    {
+        return double( bytes ) / ( 1024.0 * 1024.0 );
+    }
+
+}
+
+void MemoryTracker::recordAllocation( unsigned tag, size_t bytes )
+{
+    cobalt_assert( tag < kMaxTags );
+    TagCounters& counters = threadCounters().tags[ tag ];
+    add( counters.allocatedBytes, bytes );
+    add( counters.allocations, 1 );
+}
+
+void MemoryTracker::recordFree( unsigned tag, size_t bytes )
+{
+    cobalt_assert( tag < kMaxTags );
+    add( threadCounters().tags[ tag ].freedBytes, bytes );
+}
+
+void MemoryTracker::setTagName( unsigned tag, const char* name )
+{
+    cobalt_assert( tag < kMaxTags );
+    lock();
+    setDefaultNames();
+    gTags[ tag ].name = name;
+    unlock();
+}
+
+const char* MemoryTracker::tagName( unsigned tag )
+{
+    cobalt_assert( tag < kMaxTags );
+    lock();
+    setDefaultNames();
+    const char* name = gTags[ tag ].name;
+    unlock();
+    return name;
+}
+
+void MemoryTracker::setBudget( unsigned tag, size_t bytes )
+{
+    cobalt_assert( tag < kMaxTags );
+    lock();
+    gTags[ tag ].budget = bytes;
+    gTags[ tag ].isOverBudget = false;
+    unlock();
+}
+
+void MemoryTracker::nextFrame()
+{
+    // Budgets crossed this frame, logged once the lock is released
+    unsigned overBudget[ kMaxTags ];
+    size_t overBudgetBytes[ kMaxTags ];
+    size_t overBudgetLimits[ kMaxTags ];
+    unsigned overBudgetCount = 0;
+
+    lock();
+    for( unsigned tag = 0; tag < kMaxTags; ++tag )
+    {
+        TagState& state = gTags[ tag ];
+        Totals current = totals( tag );
+        size_t liveBytes = current.liveBytes();
+        state.peakBytes = liveBytes > state.peakBytes ? liveBytes : state.peakBytes;
+        state.frameBytes = current.allocatedBytes - state.lastAllocatedBytes;
+        state.frameAllocations = current.allocations - state.lastAllocations;
+        state.lastAllocatedBytes = current.allocatedBytes;
+        state.lastAllocations = current.allocations;
+        if( state.frameBytes > state.heaviestFrameBytes )
+        {
+            state.heaviestFrameBytes = state.frameBytes;
+            state.heaviestFrame = gFrame;
+        }
+
+        bool isOverBudget = state.budget > 0 && liveBytes > state.budget;
+        if( isOverBudget && !state.isOverBudget )
+        {
+            overBudget[ overBudgetCount ] = tag;
+            overBudgetBytes[ overBudgetCount ] = liveBytes;
+            overBudgetLimits[ overBudgetCount ] = state.budget;
+            ++overBudgetCount;
+        }
+        state.isOverBudget = isOverBudget;
+    }
+    ++gFrame;
+    unlock();
+
+    for( unsigned i = 0; i < overBudgetCount; ++i )
+    {
+        unsigned tag = overBudget[ i ];
+        const char* name = tagName( tag );
+        cobalt_log_cat_warn( Log::General, "Memory budget exceeded for %s (tag %u): %.1f MiB live, budget %.1f MiB",
+                             name ? name : "unnamed", tag, mebibytes( overBudgetBytes[ i ] ), mebibytes( overBudgetLimits[ i ] ) );
+    }
+}
+
+MemoryTracker::Snapshot MemoryTracker::snapshot()
+{
+    Snapshot snapshot;
+    lock();
+    setDefaultNames();
+    snapshot.frame = gFrame;
+    for( unsigned tag = 0; tag < kMaxTags; ++tag )
+    {
+        Totals current = totals( tag );
+        if( current.allocations == 0 )
+        {
+            continue;
+        }
+        const TagState& state = gTags[ tag ];
+        TagStats stats;
+        stats.tag = tag;
+        stats.name = state.name;
+        stats.liveBytes = current.liveBytes();
+        stats.peakBytes = stats.liveBytes > state.peakBytes ? stats.liveBytes : state.peakBytes;
+        stats.budget = state.budget;
+        stats.allocations = current.allocations;
+        stats.frameAllocations = state.frameAllocations;
+        stats.frameBytes = state.frameBytes;
+        stats.heaviestFrameBytes = state.heaviestFrameBytes;
+        stats.heaviestFrame = state.heaviestFrame;
+        snapshot.liveBytes += stats.liveBytes;
+        snapshot.tags.push_back( stats );
+    }
+    unlock();
+    return snapshot;
+}
+
+void MemoryTracker::logSnapshot()
+{
+    Snapshot current = snapshot();
+    cobalt_log_cat_info( Log::General, "Memory at frame %llu: %.1f MiB live in %zu tags",
+                         static_cast< unsigned long long >( current.frame ), mebibytes( current.liveBytes ), current.tags.size() );
+    for( const TagStats& stats : current.tags )
+    {
+        char budget[ 32 ] = "none";
+        if( stats.budget > 0 )
+        {
+            format( budget, sizeof( budget ), "%.1f MiB", mebibytes( stats.budget ) );
+        }
+        cobalt_log_cat_info( Log::General, "  %-12s %8.1f MiB live, peak %.1f MiB, budget %s; last frame %llu allocations (%.1f KiB), "
+                             "heaviest frame %llu (%.1f KiB)",
+                             stats.name ? stats.name : "unnamed", mebibytes( stats.liveBytes ), mebibytes( stats.peakBytes ), budget,
+                             static_cast< unsigned long long >( stats.frameAllocations ), stats.frameBytes / 1024.0,
+                             static_cast< unsigned long long >( stats.heaviestFrame ), stats.heaviestFrameBytes / 1024.0 );
+    }
+}
+
+} }
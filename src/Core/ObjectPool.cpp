@@ -0,0 +1,333 @@
+#include <Core/ObjectPool.hpp>
+#include <Core/Concurrency.hpp>
+#include <Core/Log.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    const unsigned char kFreedByte = 0xdd;     // fills free blocks
+    const unsigned char kAllocatedByte = 0xcd; // fills blocks just handed out
+    const size_t kMaxCachedPools = 8;
+
+    std::atomic< uint64_t > gNextPoolId{ 1 };
+
+    // Pools still alive, so a thread's cache knows whether it may hand
+    // blocks back.  Taken when pools come and go and when a cache entry is
+    // evicted or its thread exits, never while allocating.
+    std::atomic_flag gRegistryLock = ATOMIC_FLAG_INIT;
+
+    std::vector< std::pair< FixedSizePool*, uint64_t > >& livePools()
+    {
+        // Never destroyed, so pools with static storage can unregister at exit
+        static std::vector< std::pair< FixedSizePool*, uint64_t > >* pools = new std::vector< std::pair< FixedSizePool*, uint64_t > >();
+        return *pools;
+    }
+
+    void lock( std::atomic_flag& flag )
+    {
+        while( flag.test_and_set( std::memory_order_acquire ) )
+        {
+            cpuRelax();
+        }
+    }
+
+    void unlock( std::atomic_flag& flag )
+    {
+        flag.clear( std::memory_order_release );
+    }
+
+    bool isLive( FixedSizePool* pool, uint64_t id )
+    {
+        for( const std::pair< FixedSizePool*, uint64_t >& live : livePools() )
+        {
+            if( live.first == pool && live.second == id )
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+}
+
+/// The calling thread's free blocks, for up to kMaxCachedPools pools at once
+struct PoolThreadCaches
+{
+    struct Entry
+    {
+        FixedSizePool* pool = nullptr;
+        uint64_t id = 0;
+        FixedSizePool::FreeBlock* head = nullptr;
+        size_t count = 0;
+    };
+
+    Entry entries[ kMaxCachedPools ];
+    size_t nextEviction = 0;
+
+    ~PoolThreadCaches()
+    {
+        for( Entry& entry : entries )
+        {
+            evict( entry );
+        }
+    }
+
+    Entry& find( FixedSizePool* pool )
+    {
+        for( Entry& entry : entries )
+        {
+            if( entry.pool == pool && entry.id == pool->mId )
+            {
+                return entry;
+            }
+        }
+        Entry* slot = nullptr;
+        for( Entry& entry : entries )
+        {
+            if( !entry.pool )
+            {
+                slot = &entry;
+                break;
+            }
+        }
+        if( !slot )
+        {
+            slot = &entries[ nextEviction ];
+            nextEviction = ( nextEviction + 1 ) % kMaxCachedPools;
+            evict( *slot );
+        }
+        slot->pool = pool;
+        slot->id = pool->mId;
+        return *slot;
+    }
+
+    void evict( Entry& entry )
+    {
+        if( entry.pool && entry.head )
+        {
+            lock( gRegistryLock );
+            if( isLive( entry.pool, entry.id ) )
+            {
+                entry.pool->release( entry.head, entry.count );
+            }
+            unlock( gRegistryLock );
+        }
+        entry = Entry();
+    }
+};
+
+namespace {
+
+    thread_local PoolThreadCaches tCaches;
+
+}
+
+const size_t FixedSizePool::kCacheBatch;
+
+FixedSizePool::FixedSizePool( const Config& config )
+    : mBlocksPerSlab( config.blocksPerSlab > 0 ? config.blocksPerSlab : 1 )
+    , mIsPoisoning( config.isPoisoning )
+    , mMemoryTag( config.memoryTag )
+    , mId( gNextPoolId.fetch_add( 1 ) )
+{
+    mAlignment = config.alignment > alignof( FreeBlock ) ? config.alignment : alignof( FreeBlock );
+    cobalt_assert_msg( ( mAlignment & ( mAlignment - 1 ) ) == 0, FixedSizePool alignment must be a power of two );
+    size_t size = config.blockSize > sizeof( FreeBlock ) ? config.blockSize : sizeof( FreeBlock );
+    mBlockSize = ( size + mAlignment - 1 ) & ~( mAlignment - 1 );
+
+    lock( gRegistryLock );
+    livePools().push_back( std::make_pair( this, mId ) );
+    unlock( gRegistryLock );
+}
+
+FixedSizePool::~FixedSizePool()
+{
+    lock( gRegistryLock );
+    std::vector< std::pair< FixedSizePool*, uint64_t > >& pools = livePools();
+    for( size_t i = 0; i < pools.size(); ++i )
+    {
+        if( pools[ i ].first == this )
+        {
+            pools[ i ] = pools.back();
+            pools.pop_back();
+            break;
+        }
+    }
+    unlock( gRegistryLock );
+
+    for( void* slab : mSlabs )
+    {
+        std::free( slab );
+    }
+}
+
+void* FixedSizePool::allocate()
+{
+    PoolThreadCaches::Entry& cache = tCaches.find( this );
+    if( !cache.head )
+    {
+        refill( cache.head, cache.count );
+    }
+    FreeBlock* block = cache.head;
+    cache.head = block->next;
+    --cache.count;
+    if( mIsPoisoning )
+    {
+        checkPoison( block );
+        std::memset( block, kAllocatedByte, mBlockSize );
+    }
+    cobalt_memory_allocated( mMemoryTag, mBlockSize );
+    return block;
+}
+
+void FixedSizePool::deallocate( void* pointer )
+{
+    if( !pointer )
+    {
+        return;
+    }
+    cobalt_memory_freed( mMemoryTag, mBlockSize );
+    if( mIsPoisoning )
+    {
+        poison( pointer );
+    }
+    PoolThreadCaches::Entry& cache = tCaches.find( this );
+    FreeBlock* block = static_cast< FreeBlock* >( pointer );
+    block->next = cache.head;
+    cache.head = block;
+    ++cache.count;
+
+    // Keep one batch for the next allocations and hand the rest back, so a
+    // thread that only frees doesn't hoard blocks
+    if( cache.count >= 2 * kCacheBatch )
+    {
+        FreeBlock* last = cache.head;
+        for( size_t i = 1; i < kCacheBatch; ++i )
+        {
+            last = last->next;
+        }
+        FreeBlock* surplus = last->next;
+        last->next = nullptr;
+        release( surplus, cache.count - kCacheBatch );
+        cache.count = kCacheBatch;
+    }
+}
+
+void FixedSizePool::flushThreadCache()
+{
+    PoolThreadCaches::Entry& cache = tCaches.find( this );
+    if( cache.head )
+    {
+        release( cache.head, cache.count );
+        cache.head = nullptr;
+        cache.count = 0;
+    }
+}
+
+FixedSizePool::Stats FixedSizePool::stats() const
+{
+    Stats stats;
+    lock( mLock );
+    stats.slabCount = mSlabs.size();
+    stats.capacity = stats.slabCount * mBlocksPerSlab;
+    stats.used = stats.capacity - mFreeCount;
+    stats.peakUsed = mPeakUsed;
+    unlock( mLock );
+    stats.blockSize = mBlockSize;
+    return stats;
+}
+
+void FixedSizePool::refill( FreeBlock*& head, size_t& count )
+{
+    lock( mLock );
+    if( !mFreeList )
+    {
+        addSlab();
+    }
+    size_t taken = 0;
+    FreeBlock* first = mFreeList;
+    FreeBlock* last = nullptr;
+    while( mFreeList && taken < kCacheBatch )
+    {
+        last = mFreeList;
+        mFreeList = mFreeList->next;
+        ++taken;
+    }
+    last->next = head;
+    head = first;
+    count += taken;
+    mFreeCount -= taken;
+    size_t used = mSlabs.size() * mBlocksPerSlab - mFreeCount;
+    if( used > mPeakUsed )
+    {
+        mPeakUsed = used;
+    }
+    unlock( mLock );
+}
+
+void FixedSizePool::release( FreeBlock* head, size_t count )
+{
+    FreeBlock* last = head;
+    while( last->next )
+    {
+        last = last->next;
+    }
+    lock( mLock );
+    last->next = mFreeList;
+    mFreeList = head;
+    mFreeCount += count;
+    unlock( mLock );
+}
+
+void FixedSizePool::addSlab()
+{
+    // Called with mLock held.  Blocks are linked in address order so a
+    // fresh slab hands out neighbouring blocks.
+    void* slab = std::malloc( mBlockSize * mBlocksPerSlab + mAlignment - 1 );
+    if( !slab )
+    {
+        cobalt_log_fatal( "FixedSizePool: out of memory allocating a %zu byte slab", mBlockSize * mBlocksPerSlab );
+        std::abort();
+    }
+    mSlabs.push_back( slab );
+    uintptr_t address = reinterpret_cast< uintptr_t >( slab );
+    char* blocks = reinterpret_cast< char* >( ( address + mAlignment - 1 ) & ~static_cast< uintptr_t >( mAlignment - 1 ) );
+    for( size_t i = mBlocksPerSlab; i-- > 0; )
+    {
+        FreeBlock* block = reinterpret_cast< FreeBlock* >( blocks + i * mBlockSize );
+        if( mIsPoisoning )
+        {
+            poison( block );
+        }
+        block->next = mFreeList;
+        mFreeList = block;
+    }
+    mFreeCount += mBlocksPerSlab;
+}
+
+void FixedSizePool::poison( void* block ) const
+{
+    std::memset( block, kFreedByte, mBlockSize );
+}
+
+void FixedSizePool::checkPoison( void* block ) const
+{
+    // The first bytes hold the free list link
+    const unsigned char* bytes = static_cast< const unsigned char* >( block );
+    for( size_t i = sizeof( FreeBlock ); i < mBlockSize; ++i )
+    {
+        if( bytes[ i ] != kFreedByte )
+        {
+            cobalt_log_error( "FixedSizePool: block %p was written to after being freed (byte %zu)", block, i );
+            cobalt_assert_msg( false, pool block modified after free );
+            return;
+        }
+    }
+}
+
+} }
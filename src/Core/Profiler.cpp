@@ -0,0 +1,186 @@
+#include <Core/Profiler.hpp>
+
+namespace cobalt {
+using namespace core;
+
+std::atomic< bool > Profiler::sIsCapturing{ false };
+
+#if COBALT_PROFILER
+
+namespace {
+
+    struct ProfileEvent
+    {
+        const char* name;
+        int64_t startNs;
+        int64_t endNs;
+    };
+
+    /// Ring of completed zones written only by its owning thread.  Like the
+    /// Log rings these are never freed; a ring whose thread exited is reused.
+    struct ProfileBuffer
+    {
+        static const size_t kMask = Profiler::kEventsPerThread - 1;
+        static_assert( ( Profiler::kEventsPerThread & kMask ) == 0, "kEventsPerThread must be a power of two" );
+
+        std::atomic< uint64_t > head{ 0 };
+        uint64_t captureStart = 0; // written by start(), read by the exporter
+        std::atomic< const char* > threadName{ nullptr };
+        std::atomic< bool > inUse{ true };
+        int threadId = 0;
+        ProfileBuffer* next = nullptr;
+        ProfileEvent events[ Profiler::kEventsPerThread ];
+    };
+
+    std::atomic< ProfileBuffer* > gBuffers{ nullptr };
+    std::atomic< int > gNextThreadId{ 1 };
+    int64_t gCaptureStartNs = 0;
+
+    ProfileBuffer* acquireBuffer()
+    {
+        for( ProfileBuffer* buffer = gBuffers.load( std::memory_order_acquire ); buffer; buffer = buffer->next )
+        {
+            bool expected = false;
+            if( buffer->inUse.compare_exchange_strong( expected, true ) )
+            {
+                // Zones left by the previous owner keep this tid in exports
+                buffer->threadName.store( nullptr );
+                return buffer;
+            }
+        }
+        ProfileBuffer* buffer = new ProfileBuffer;
+        buffer->threadId = gNextThreadId.fetch_add( 1 );
+        buffer->next = gBuffers.load( std::memory_order_relaxed );
+        while( !gBuffers.compare_exchange_weak( buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed ) ) {}
+        return buffer;
+    }
+
+    struct ThreadBufferOwner
+    {
+        ProfileBuffer* buffer = nullptr;
+        ~ThreadBufferOwner()
+        {
+            if( buffer )
+            {
+                buffer->inUse.store( false );
+            }
+        }
+        ProfileBuffer* get()
+        {
+            if( !buffer )
+            {
+                buffer = acquireBuffer();
+            }
+            return buffer;
+        }
+    };
+
+    thread_local ThreadBufferOwner tBuffer;
+
+    void writeEscaped( std::FILE* out, const char* str )
+    {
+        for( const char* c = str; *c; ++c )
+        {
+            if( *c == '"' || *c == '\\' )
+            {
+                std::fputc( '\\', out );
+            }
+            if( static_cast< unsigned char >( *c ) >= 0x20 )
+            {
+                std::fputc( *c, out );
+            }
+        }
+    }
+}
+
+void Profiler::record( const char* name, int64_t startNs, int64_t endNs )
+{
+    ProfileBuffer* buffer = tBuffer.get();
+    uint64_t head = buffer->head.load( std::memory_order_relaxed );
+    buffer->events[ head & ProfileBuffer::kMask ] = ProfileEvent{ name, startNs, endNs };
+    buffer->head.store( head + 1, std::memory_order_release );
+}
+
+void Profiler::setThreadName( const char* name )
+{
+    tBuffer.get()->threadName.store( name, std::memory_order_release );
+}
+
+void Profiler::start()
+{
+    for( ProfileBuffer* buffer = gBuffers.load( std::memory_order_acquire ); buffer; buffer = buffer->next )
+    {
+        buffer->captureStart = buffer->head.load( std::memory_order_acquire );
+    }
+    gCaptureStartNs = Clock::nowNs();
+    sIsCapturing.store( true, std::memory_order_release );
+}
+
+void Profiler::stop()
+{
+    sIsCapturing.store( false, std::memory_order_release );
+}
+
+bool Profiler::writeChromeTrace( std::FILE* out )
+{
+    // Chrome trace timestamps are in microseconds
+    std::fprintf( out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    const char* separator = "";
+    for( ProfileBuffer* buffer = gBuffers.load( std::memory_order_acquire ); buffer; buffer = buffer->next )
+    {
+        uint64_t head = buffer->head.load( std::memory_order_acquire );
+        uint64_t first = buffer->captureStart;
+        if( head - first > Profiler::kEventsPerThread )
+        {
+            first = head - Profiler::kEventsPerThread;
+        }
+        if( const char* name = buffer->threadName.load( std::memory_order_acquire ) )
+        {
+            std::fprintf( out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", separator, buffer->threadId );
+            writeEscaped( out, name );
+            std::fprintf( out, "\"}}" );
+            separator = ",\n";
+        }
+        for( uint64_t i = first; i < head; ++i )
+        {
+            const ProfileEvent& event = buffer->events[ i & ProfileBuffer::kMask ];
+            std::fprintf( out, "%s{\"name\":\"", separator );
+            writeEscaped( out, event.name );
+            std::fprintf( out, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                          buffer->threadId,
+                          ( event.startNs - gCaptureStartNs ) * 0.001,
+                          ( event.endNs - event.startNs ) * 0.001 );
+            separator = ",\n";
+        }
+    }
+    std::fprintf( out, "\n]}\n" );
+    return std::ferror( out ) == 0;
+}
+
+#else
+
+void Profiler::record( const char*, int64_t, int64_t ) {}
+void Profiler::setThreadName( const char* ) {}
+void Profiler::start() {}
+void Profiler::stop() {}
+
+bool Profiler::writeChromeTrace( std::FILE* out )
+{
+    std::fprintf( out, "{\"traceEvents\":[]}\n" );
+    return std::ferror( out ) == 0;
+}
+
+#endif
+
+bool Profiler::writeChromeTrace( const char* path )
+{
+    std::FILE* out = std::fopen( path, "w" );
+    if( !out )
+    {
+        return false;
+    }
+    bool isWritten = writeChromeTrace( out );
+    return std::fclose( out ) == 0 && isWritten;
+}
+
+}
@@ -0,0 +1,221 @@
+#include <Core/Task.hpp>
+
+#if COBALT_HAS_COROUTINES
+
+#include <Core/Concurrency.hpp>
+#include <Core/JobSystem.hpp>
+
+#include <new>
+#include <vector>
+
+#if !COBALT_NO_THREADS
+    #include <mutex>
+#endif
+
+namespace cobalt { namespace core {
+
+namespace {
+
+    // Size classes of 64 bytes, 128, ... up to kMaxPooledSize
+    const size_t kMinFrameSize = 64;
+    const size_t kSizeClassCount = 7;
+    static_assert( ( kMinFrameSize << ( kSizeClassCount - 1 ) ) == CoroutineFrameAllocator::kMaxPooledSize, "size classes must end at kMaxPooledSize" );
+
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    struct FramePool
+    {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        FreeFrame* head = nullptr;
+    };
+
+    FramePool gFramePools[ kSizeClassCount ];
+
+    size_t sizeClass( size_t size )
+    {
+        size_t index = 0;
+        while( ( kMinFrameSize << index ) < size )
+        {
+            ++index;
+        }
+        return index;
+    }
+
+    void lockPool( FramePool& pool )
+    {
+        while( pool.lock.test_and_set( std::memory_order_acquire ) )
+        {
+            cpuRelax();
+        }
+    }
+
+    void unlockPool( FramePool& pool )
+    {
+        pool.lock.clear( std::memory_order_release );
+    }
+
+    /// Scheduler queues; handles are pushed from any thread and resumed by
+    /// pump() on the main thread
+    struct ResumeQueues
+    {
+#if !COBALT_NO_THREADS
+        std::mutex mutex;
+#endif
+        std::vector< std::coroutine_handle<> > mainThread;
+        std::vector< std::coroutine_handle<> > nextFrame;
+    };
+
+    ResumeQueues gQueues;
+    std::atomic< bool > gHasMainThread{ false };
+    thread_local bool tIsMainThread = false;
+    std::atomic< uint64_t > gFrameIndex{ 0 };
+
+    void push( std::vector< std::coroutine_handle<> >& queue, std::coroutine_handle<> handle )
+    {
+#if !COBALT_NO_THREADS
+        std::lock_guard< std::mutex > lock( gQueues.mutex );
+#endif
+        queue.push_back( handle );
+    }
+
+    void take( std::vector< std::coroutine_handle<> >& queue, std::vector< std::coroutine_handle<> >& out )
+    {
+        out.clear();
+#if !COBALT_NO_THREADS
+        std::lock_guard< std::mutex > lock( gQueues.mutex );
+#endif
+        out.swap( queue );
+    }
+
+}
+
+void* CoroutineFrameAllocator::allocate( size_t size )
+{
+    if( size > kMaxPooledSize )
+    {
+        return ::operator new( size );
+    }
+    size_t index = sizeClass( size );
+    FramePool& pool = gFramePools[ index ];
+    lockPool( pool );
+    if( !pool.head )
+    {
+        // Carve a fresh chunk into frames of this class
+        size_t frameSize = kMinFrameSize << index;
+        char* chunk = static_cast< char* >( ::operator new( kChunkSize ) );
+        for( size_t offset = 0; offset + frameSize <= kChunkSize; offset += frameSize )
+        {
+            FreeFrame* frame = reinterpret_cast< FreeFrame* >( chunk + offset );
+            frame->next = pool.head;
+            pool.head = frame;
+        }
+    }
+    FreeFrame* frame = pool.head;
+    pool.head = frame->next;
+    unlockPool( pool );
+    return frame;
+}
+
+void CoroutineFrameAllocator::deallocate( void* frame, size_t size )
+{
+    if( size > kMaxPooledSize )
+    {
+        ::operator delete( frame );
+        return;
+    }
+    FramePool& pool = gFramePools[ sizeClass( size ) ];
+    FreeFrame* freed = static_cast< FreeFrame* >( frame );
+    lockPool( pool );
+    freed->next = pool.head;
+    pool.head = freed;
+    unlockPool( pool );
+}
+
+void TaskScheduler::setMainThread()
+{
+    tIsMainThread = true;
+    gHasMainThread.store( true );
+}
+
+bool TaskScheduler::isMainThread()
+{
+    return tIsMainThread;
+}
+
+uint64_t TaskScheduler::frameIndex()
+{
+    return gFrameIndex.load( std::memory_order_relaxed );
+}
+
+void TaskScheduler::pump()
+{
+    if( !gHasMainThread.load( std::memory_order_relaxed ) )
+    {
+        setMainThread();
+    }
+    // Coroutines awaiting nextFrame() again go to the fresh queue, for the
+    // frame after this one
+    std::vector< std::coroutine_handle<> > ready;
+    take( gQueues.nextFrame, ready );
+    for( std::coroutine_handle<> handle : ready )
+    {
+        handle.resume();
+    }
+    while( true )
+    {
+        take( gQueues.mainThread, ready );
+        if( ready.empty() )
+        {
+            break;
+        }
+        for( std::coroutine_handle<> handle : ready )
+        {
+            handle.resume();
+        }
+    }
+    gFrameIndex.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void TaskScheduler::resumeOnMainThread( std::coroutine_handle<> handle )
+{
+    push( gQueues.mainThread, handle );
+}
+
+void TaskScheduler::resumeNextFrame( std::coroutine_handle<> handle )
+{
+    push( gQueues.nextFrame, handle );
+}
+
+void TaskScheduler::resumeOnWorkerPool( std::coroutine_handle<> handle )
+{
+    void* address = handle.address();
+    JobSystem::run( [address]() { std::coroutine_handle<>::from_address( address ).resume(); } );
+}
+
+void IoCompletion::complete()
+{
+    void* waiting = mState.exchange( const_cast< void* >( completedState() ), std::memory_order_acq_rel );
+    if( !waiting || waiting == completedState() )
+    {
+        return;
+    }
+    // The waiter wrote mIsWaitingOnMainThread before publishing itself
+    bool isWaitingOnMainThread = mIsWaitingOnMainThread;
+    // Resuming may destroy this; don't touch members past here
+    std::coroutine_handle<> handle = std::coroutine_handle<>::from_address( waiting );
+    if( isWaitingOnMainThread )
+    {
+        TaskScheduler::resumeOnMainThread( handle );
+    }
+    else
+    {
+        TaskScheduler::resumeOnWorkerPool( handle );
+    }
+}
+
+} }
+
+#endif
@@ -0,0 +1,491 @@
+#include <Core/TlsfHeap.hpp>
+#include <Core/Concurrency.hpp>
+#include <Core/Log.hpp>
+
+#include <cstdlib>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace cobalt { namespace core {
+
+/// Header in front of every block.  The free list links are only valid
+/// while the block is free and overlap the start of its payload otherwise.
+/// The last block of each pool is a zero-size used sentinel, so every real
+/// block has a next neighbour.
+struct TlsfHeap::Block
+{
+    Block* previousPhysical; // null for the first block of a pool
+    size_t sizeAndFlags;     // payload bytes; the low bit marks free blocks
+    Block* nextFree;
+    Block* previousFree;
+
+    static const size_t kFreeBit = 1;
+
+    size_t size() const { return sizeAndFlags & ~kFreeBit; }
+    bool isFree() const { return ( sizeAndFlags & kFreeBit ) != 0; }
+    void setSize( size_t size ) { sizeAndFlags = size | ( sizeAndFlags & kFreeBit ); }
+    void setFree( bool isFree ) { sizeAndFlags = isFree ? ( sizeAndFlags | kFreeBit ) : ( sizeAndFlags & ~kFreeBit ); }
+
+    char* payload() { return reinterpret_cast< char* >( this ) + kHeaderSize; }
+    Block* nextPhysical() { return reinterpret_cast< Block* >( payload() + size() ); }
+
+    static Block* fromPayload( const void* pointer )
+    {
+        return reinterpret_cast< Block* >( static_cast< char* >( const_cast< void* >( pointer ) ) - kHeaderSize );
+    }
+
+    static const size_t kHeaderSize = 2 * sizeof( void* ) > TlsfHeap::kAlignment ? 2 * sizeof( void* ) : TlsfHeap::kAlignment;
+    static const size_t kMinSize = 2 * sizeof( void* ) > TlsfHeap::kAlignment ? 2 * sizeof( void* ) : TlsfHeap::kAlignment;
+};
+
+namespace {
+
+    /// Index of the highest set bit; `value` must not be 0
+    unsigned highestBit( uint64_t value )
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64( &index, value );
+        return static_cast< unsigned >( index );
+#else
+        return 63 - static_cast< unsigned >( __builtin_clzll( value ) );
+#endif
+    }
+
+    /// Index of the lowest set bit; `value` must not be 0
+    unsigned lowestBit( uint32_t value )
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward( &index, value );
+        return static_cast< unsigned >( index );
+#else
+        return static_cast< unsigned >( __builtin_ctz( value ) );
+#endif
+    }
+
+    size_t alignUp( size_t value, size_t alignment )
+    {
+        return ( value + alignment - 1 ) & ~( alignment - 1 );
+    }
+
+    char* alignUp( char* pointer, size_t alignment )
+    {
+        return reinterpret_cast< char* >( alignUp( reinterpret_cast< uintptr_t >( pointer ), alignment ) );
+    }
+
+}
+
+const size_t TlsfHeap::kAlignment;
+const size_t TlsfHeap::kMaxAllocation;
+
+TlsfHeap::TlsfHeap()
+{
+}
+
+TlsfHeap::TlsfHeap( size_t bytes, VirtualMemory::Pages pages )
+{
+    VirtualMemory::Region region = VirtualMemory::allocate( bytes, pages );
+    if( !region.isValid() )
+    {
+        cobalt_log_error( "TlsfHeap: couldn't allocate a %zu byte pool", bytes );
+        return;
+    }
+    addPool( region.base, region.size );
+    mPools.back().region = region;
+}
+
+TlsfHeap::~TlsfHeap()
+{
+    for( const Pool& pool : mPools )
+    {
+        VirtualMemory::Region region = pool.region;
+        VirtualMemory::release( region );
+    }
+}
+
+void TlsfHeap::addPool( void* memory, size_t bytes )
+{
+    char* start = alignUp( static_cast< char* >( memory ), kAlignment );
+    char* end = static_cast< char* >( memory ) + bytes;
+    // Room for the first block's header, its smallest payload and the sentinel
+    if( end < start + 2 * Block::kHeaderSize + Block::kMinSize )
+    {
+        cobalt_log_error( "TlsfHeap: pool of %zu bytes is too small", bytes );
+        return;
+    }
+    size_t size = ( static_cast< size_t >( end - start ) - 2 * Block::kHeaderSize ) & ~( kAlignment - 1 );
+    if( size > kMaxAllocation )
+    {
+        size = kMaxAllocation;
+    }
+
+    Block* block = reinterpret_cast< Block* >( start );
+    block->previousPhysical = nullptr;
+    block->sizeAndFlags = size;
+    Block* sentinel = block->nextPhysical();
+    sentinel->previousPhysical = block;
+    sentinel->sizeAndFlags = 0;
+    insertFreeBlock( block );
+
+    Pool pool;
+    pool.memory = memory;
+    pool.bytes = bytes;
+    mPools.push_back( pool );
+}
+
+void* TlsfHeap::allocate( size_t size, size_t alignment )
+{
+    if( size > kMaxAllocation )
+    {
+        return nullptr;
+    }
+    size_t adjusted = size < Block::kMinSize ? Block::kMinSize : alignUp( size, kAlignment );
+    if( alignment <= kAlignment )
+    {
+        Block* block = findFreeBlock( adjusted );
+        if( !block )
+        {
+            return nullptr;
+        }
+        removeFreeBlock( block );
+        block->setFree( false );
+        splitAfter( block, adjusted );
+        mUsedBytes += block->size();
+        mPeakUsedBytes = mUsedBytes > mPeakUsedBytes ? mUsedBytes : mPeakUsedBytes;
+        cobalt_memory_allocated( mMemoryTag, block->size() );
+        return block->payload();
+    }
+
+    // Over-aligned: find room for the size plus the worst-case offset, then
+    // split off the gap in front as a free block of its own.  The gap has
+    // to be big enough to hold one.
+    cobalt_assert_msg( ( alignment & ( alignment - 1 ) ) == 0, TlsfHeap alignment must be a power of two );
+    const size_t minimumGap = Block::kHeaderSize + Block::kMinSize;
+    Block* block = findFreeBlock( adjusted + alignment + minimumGap );
+    if( !block )
+    {
+        return nullptr;
+    }
+    removeFreeBlock( block );
+    char* aligned = alignUp( block->payload(), alignment );
+    size_t gap = static_cast< size_t >( aligned - block->payload() );
+    if( gap > 0 && gap < minimumGap )
+    {
+        aligned = alignUp( block->payload() + minimumGap, alignment );
+        gap = static_cast< size_t >( aligned - block->payload() );
+    }
+    if( gap > 0 )
+    {
+        Block* next = block->nextPhysical();
+        Block* alignedBlock = Block::fromPayload( aligned );
+        alignedBlock->previousPhysical = block;
+        alignedBlock->sizeAndFlags = block->size() - gap;
+        next->previousPhysical = alignedBlock;
+        block->setSize( gap - Block::kHeaderSize );
+        // The block was free, so the one before it is in use and the gap
+        // needs no merging
+        insertFreeBlock( block );
+        block = alignedBlock;
+    }
+    block->setFree( false );
+    splitAfter( block, adjusted );
+    mUsedBytes += block->size();
+    mPeakUsedBytes = mUsedBytes > mPeakUsedBytes ? mUsedBytes : mPeakUsedBytes;
+    cobalt_memory_allocated( mMemoryTag, block->size() );
+    return block->payload();
+}
+
+void TlsfHeap::deallocate( void* pointer )
+{
+    if( !pointer )
+    {
+        return;
+    }
+    Block* block = Block::fromPayload( pointer );
+    cobalt_assert_msg( !block->isFree(), TlsfHeap block freed twice );
+    mUsedBytes -= block->size();
+    cobalt_memory_freed( mMemoryTag, block->size() );
+    block->setFree( true );
+    insertFreeBlock( mergeWithNeighbours( block ) );
+}
+
+size_t TlsfHeap::usableSize( const void* pointer ) const
+{
+    return pointer ? Block::fromPayload( pointer )->size() : 0;
+}
+
+void TlsfHeap::splitAfter( Block* block, size_t size )
+{
+    // Only split off what can hold a block of its own
+    if( block->size() < size + Block::kHeaderSize + Block::kMinSize )
+    {
+        return;
+    }
+    Block* next = block->nextPhysical();
+    Block* remainder = reinterpret_cast< Block* >( block->payload() + size );
+    remainder->previousPhysical = block;
+    remainder->sizeAndFlags = ( block->size() - size - Block::kHeaderSize ) | Block::kFreeBit;
+    next->previousPhysical = remainder;
+    block->setSize( size );
+    insertFreeBlock( mergeWithNeighbours( remainder ) );
+}
+
+TlsfHeap::Block* TlsfHeap::mergeWithNeighbours( Block* block )
+{
+    Block* next = block->nextPhysical();
+    if( next->isFree() )
+    {
+        removeFreeBlock( next );
+        block->setSize( block->size() + Block::kHeaderSize + next->size() );
+        block->nextPhysical()->previousPhysical = block;
+    }
+    Block* previous = block->previousPhysical;
+    if( previous && previous->isFree() )
+    {
+        removeFreeBlock( previous );
+        previous->setSize( previous->size() + Block::kHeaderSize + block->size() );
+        previous->nextPhysical()->previousPhysical = previous;
+        block = previous;
+    }
+    return block;
+}
+
+//// Free lists
+
+void TlsfHeap::mapSize( size_t size, unsigned& firstLevel, unsigned& secondLevel )
+{
+    if( size < ( size_t( 1 ) << kFirstLevelShift ) )
+    {
+        // Small sizes all share the first level, in linear steps of kAlignment
+        firstLevel = 0;
+        secondLevel = static_cast< unsigned >( size / kAlignment );
+    }
+    else
+    {
+        unsigned bit = highestBit( size );
+        secondLevel = static_cast< unsigned >( size >> ( bit - kSecondLevelLog2 ) ) ^ ( 1u << kSecondLevelLog2 );
+        firstLevel = bit - ( kFirstLevelShift - 1 );
+    }
+}
+
+void TlsfHeap::insertFreeBlock( Block* block )
+{
+    unsigned firstLevel, secondLevel;
+    mapSize( block->size(), firstLevel, secondLevel );
+    Block*& head = mFreeLists[ firstLevel ][ secondLevel ];
+    block->setFree( true );
+    block->previousFree = nullptr;
+    block->nextFree = head;
+    if( head )
+    {
+        head->previousFree = block;
+    }
+    head = block;
+    mFirstLevelBitmap |= 1u << firstLevel;
+    mSecondLevelBitmaps[ firstLevel ] |= 1u << secondLevel;
+}
+
+void TlsfHeap::removeFreeBlock( Block* block )
+{
+    unsigned firstLevel, secondLevel;
+    mapSize( block->size(), firstLevel, secondLevel );
+    if( block->nextFree )
+    {
+        block->nextFree->previousFree = block->previousFree;
+    }
+    if( block->previousFree )
+    {
+        block->previousFree->nextFree = block->nextFree;
+    }
+    else
+    {
+        Block*& head = mFreeLists[ firstLevel ][ secondLevel ];
+        head = block->nextFree;
+        if( !head )
+        {
+            mSecondLevelBitmaps[ firstLevel ] &= ~( 1u << secondLevel );
+            if( !mSecondLevelBitmaps[ firstLevel ] )
+            {
+                mFirstLevelBitmap &= ~( 1u << firstLevel );
+            }
+        }
+    }
+}
+
+TlsfHeap::Block* TlsfHeap::findFreeBlock( size_t size )
+{
+    // Round up to the next list boundary, so any block in the list found fits
+    if( size >= ( size_t( 1 ) << kFirstLevelShift ) )
+    {
+        size += ( size_t( 1 ) << ( highestBit( size ) - kSecondLevelLog2 ) ) - 1;
+    }
+    unsigned firstLevel, secondLevel;
+    mapSize( size, firstLevel, secondLevel );
+    if( firstLevel >= kFirstLevelCount )
+    {
+        return nullptr;
+    }
+
+    uint32_t secondLevelMap = mSecondLevelBitmaps[ firstLevel ] & ( ~0u << secondLevel );
+    if( !secondLevelMap )
+    {
+        uint32_t firstLevelMap = firstLevel + 1 < 32 ? mFirstLevelBitmap & ( ~0u << ( firstLevel + 1 ) ) : 0;
+        if( !firstLevelMap )
+        {
+            return nullptr;
+        }
+        firstLevel = lowestBit( firstLevelMap );
+        secondLevelMap = mSecondLevelBitmaps[ firstLevel ];
+    }
+    return mFreeLists[ firstLevel ][ lowestBit( secondLevelMap ) ];
+}
+
+//// Reporting
+
+TlsfHeap::Stats TlsfHeap::stats() const
+{
+    Stats stats;
+    stats.usedBytes = mUsedBytes;
+    stats.peakUsedBytes = mPeakUsedBytes;
+    for( const Pool& pool : mPools )
+    {
+        Block* block = reinterpret_cast< Block* >( alignUp( static_cast< char* >( pool.memory ), kAlignment ) );
+        for( ; block->size() > 0; block = block->nextPhysical() )
+        {
+            stats.capacity += block->size();
+            if( block->isFree() )
+            {
+                stats.freeBytes += block->size();
+                stats.largestFreeBlock = block->size() > stats.largestFreeBlock ? block->size() : stats.largestFreeBlock;
+                ++stats.freeBlocks;
+            }
+            else
+            {
+                ++stats.usedBlocks;
+            }
+        }
+    }
+    return stats;
+}
+
+bool TlsfHeap::validate() const
+{
+    size_t freeBlocks = 0;
+    for( const Pool& pool : mPools )
+    {
+        Block* previous = nullptr;
+        Block* block = reinterpret_cast< Block* >( alignUp( static_cast< char* >( pool.memory ), kAlignment ) );
+        for( ; ; block = block->nextPhysical() )
+        {
+            if( block->previousPhysical != previous )
+            {
+                cobalt_log_error( "TlsfHeap: block %p has a bad link to the block before it", block );
+                return false;
+            }
+            if( block->isFree() && previous && previous->isFree() )
+            {
+                cobalt_log_error( "TlsfHeap: free blocks %p and %p weren't merged", previous, block );
+                return false;
+            }
+            if( block->size() == 0 )
+            {
+                break;
+            }
+            freeBlocks += block->isFree() ? 1 : 0;
+            previous = block;
+        }
+    }
+
+    size_t listed = 0;
+    for( unsigned firstLevel = 0; firstLevel < kFirstLevelCount; ++firstLevel )
+    {
+        bool hasFirstLevelBit = ( mFirstLevelBitmap & ( 1u << firstLevel ) ) != 0;
+        if( hasFirstLevelBit != ( mSecondLevelBitmaps[ firstLevel ] != 0 ) )
+        {
+            cobalt_log_error( "TlsfHeap: bitmaps disagree for first level %u", firstLevel );
+            return false;
+        }
+        for( unsigned secondLevel = 0; secondLevel < kSecondLevelCount; ++secondLevel )
+        {
+            Block* block = mFreeLists[ firstLevel ][ secondLevel ];
+            if( ( block != nullptr ) != ( ( mSecondLevelBitmaps[ firstLevel ] & ( 1u << secondLevel ) ) != 0 ) )
+            {
+                cobalt_log_error( "TlsfHeap: bitmap disagrees with free list %u/%u", firstLevel, secondLevel );
+                return false;
+            }
+            for( ; block; block = block->nextFree )
+            {
+                unsigned blockFirstLevel, blockSecondLevel;
+                mapSize( block->size(), blockFirstLevel, blockSecondLevel );
+                if( !block->isFree() || blockFirstLevel != firstLevel || blockSecondLevel != secondLevel )
+                {
+                    cobalt_log_error( "TlsfHeap: block %p is in the wrong free list", block );
+                    return false;
+                }
+                ++listed;
+            }
+        }
+    }
+    if( listed != freeBlocks )
+    {
+        cobalt_log_error( "TlsfHeap: %zu free blocks but %zu in the free lists", freeBlocks, listed );
+        return false;
+    }
+    return true;
+}
+
+//// LockedTlsfHeap
+
+void LockedTlsfHeap::lock() const
+{
+    while( mLock.test_and_set( std::memory_order_acquire ) )
+    {
+        cpuRelax();
+    }
+}
+
+void LockedTlsfHeap::unlock() const
+{
+    mLock.clear( std::memory_order_release );
+}
+
+void LockedTlsfHeap::addPool( void* memory, size_t bytes )
+{
+    lock();
+    mHeap.addPool( memory, bytes );
+    unlock();
+}
+
+void* LockedTlsfHeap::allocate( size_t size, size_t alignment )
+{
+    lock();
+    void* pointer = mHeap.allocate( size, alignment );
+    unlock();
+    return pointer;
+}
+
+void LockedTlsfHeap::deallocate( void* pointer )
+{
+    lock();
+    mHeap.deallocate( pointer );
+    unlock();
+}
+
+size_t LockedTlsfHeap::usableSize( const void* pointer ) const
+{
+    // Only reads the block's own header, which its owner isn't changing
+    return mHeap.usableSize( pointer );
+}
+
+TlsfHeap::Stats LockedTlsfHeap::stats() const
+{
+    lock();
+    TlsfHeap::Stats stats = mHeap.stats();
+    unlock();
+    return stats;
+}
+
+} }
@@ -0,0 +1,292 @@
+#include <Core/VirtualMemory.hpp>
+#include <Core/Log.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined( _WIN32 )
+    #define NOMINMAX
+    #include <windows.h>
+#elif !defined( COBALT_EMSCRIPTEN )
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace cobalt { namespace core {
+
+namespace {
+
+#ifdef NDEBUG
+    const bool kHasGuardPages = false;
+#else
+    const bool kHasGuardPages = true;
+#endif
+
+    size_t alignUp( size_t value, size_t alignment )
+    {
+        return ( value + alignment - 1 ) & ~( alignment - 1 );
+    }
+
+    size_t alignDown( size_t value, size_t alignment )
+    {
+        return value & ~( alignment - 1 );
+    }
+
+    size_t detectHugePageSize()
+    {
+#if defined( __linux__ )
+        // "Hugepagesize:    2048 kB"
+        size_t size = 0;
+        if( std::FILE* file = std::fopen( "/proc/meminfo", "r" ) )
+        {
+            char line[ 128 ];
+            unsigned long kilobytes = 0;
+            while( std::fgets( line, sizeof( line ), file ) )
+            {
+                if( std::sscanf( line, "Hugepagesize: %lu kB", &kilobytes ) == 1 )
+                {
+                    size = static_cast< size_t >( kilobytes ) * 1024;
+                    break;
+                }
+            }
+            std::fclose( file );
+        }
+        return size;
+#else
+        return 0;
+#endif
+    }
+
+#if !defined( _WIN32 ) && !defined( COBALT_EMSCRIPTEN )
+    /// Reserve `size` bytes aligned to `alignment` with `guard` inaccessible
+    /// bytes either side, trimming the excess of an over-sized mapping
+    bool mapAligned( size_t size, size_t alignment, size_t guard, VirtualMemory::Region& region )
+    {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    #ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+    #endif
+        size_t extra = alignment > VirtualMemory::pageSize() ? alignment : 0;
+        size_t total = size + 2 * guard + extra;
+        void* mapping = mmap( nullptr, total, PROT_NONE, flags, -1, 0 );
+        if( mapping == MAP_FAILED )
+        {
+            return false;
+        }
+        uintptr_t start = reinterpret_cast< uintptr_t >( mapping );
+        uintptr_t base = alignUp( start + guard, alignment );
+        uintptr_t begin = base - guard;
+        uintptr_t end = base + size + guard;
+        if( begin > start )
+        {
+            munmap( mapping, begin - start );
+        }
+        if( start + total > end )
+        {
+            munmap( reinterpret_cast< void* >( end ), start + total - end );
+        }
+        region.base = reinterpret_cast< char* >( base );
+        region.size = size;
+        region.mapping = reinterpret_cast< void* >( begin );
+        region.mappingSize = end - begin;
+        return true;
+    }
+#endif
+
+}
+
+size_t VirtualMemory::pageSize()
+{
+    static const size_t sPageSize = []()
+    {
+#if defined( _WIN32 )
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        return static_cast< size_t >( info.dwPageSize );
+#elif defined( COBALT_EMSCRIPTEN )
+        return size_t( 64 * 1024 );
+#else
+        return static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+#endif
+    }();
+    return sPageSize;
+}
+
+size_t VirtualMemory::hugePageSize()
+{
+    static const size_t sHugePageSize = detectHugePageSize();
+    return sHugePageSize;
+}
+
+VirtualMemory::Region VirtualMemory::reserve( size_t bytes, Pages pages )
+{
+    Region region;
+    if( bytes == 0 )
+    {
+        return region;
+    }
+    size_t hugeSize = hugePageSize();
+    if( hugeSize == 0 || bytes < hugeSize )
+    {
+        // Not available, or not worth it for a region smaller than one page
+        pages = Pages::Normal;
+    }
+
+#if defined( _WIN32 )
+    // Large pages need the "Lock pages in memory" privilege and can't be
+    // reserved and committed separately, so stick to normal pages
+    size_t size = alignUp( bytes, pageSize() );
+    size_t guard = kHasGuardPages ? pageSize() : 0;
+    char* mapping = static_cast< char* >( VirtualAlloc( nullptr, size + 2 * guard, MEM_RESERVE, PAGE_NOACCESS ) );
+    if( !mapping )
+    {
+        cobalt_log_error( "VirtualMemory: couldn't reserve %zu bytes", bytes );
+        return region;
+    }
+    region.base = mapping + guard;
+    region.size = size;
+    region.pages = Pages::Normal;
+    region.mapping = mapping;
+    region.mappingSize = size + 2 * guard;
+#elif defined( COBALT_EMSCRIPTEN )
+    // A flat heap, so all there is to do is hand out memory
+    size_t size = alignUp( bytes, pageSize() );
+    void* mapping = std::malloc( size + pageSize() );
+    if( !mapping )
+    {
+        cobalt_log_error( "VirtualMemory: couldn't allocate %zu bytes", bytes );
+        return region;
+    }
+    region.base = reinterpret_cast< char* >( alignUp( reinterpret_cast< uintptr_t >( mapping ), pageSize() ) );
+    region.size = size;
+    region.pages = Pages::Normal;
+    region.mapping = mapping;
+    region.mappingSize = size + pageSize();
+#else
+    #ifdef MAP_HUGETLB
+    if( pages == Pages::ExplicitHuge )
+    {
+        size_t size = alignUp( bytes, hugeSize );
+        void* mapping = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if( mapping != MAP_FAILED )
+        {
+            region.base = static_cast< char* >( mapping );
+            region.size = size;
+            region.pages = Pages::ExplicitHuge;
+            region.mapping = mapping;
+            region.mappingSize = size;
+            return region;
+        }
+        cobalt_log_throttled_info( Log::General, 60.0, "VirtualMemory: no free hugetlbfs pages (see /proc/sys/vm/nr_hugepages); "
+                                   "using transparent huge pages" );
+        pages = Pages::TransparentHuge;
+    }
+    #endif
+    if( pages == Pages::ExplicitHuge )
+    {
+        pages = Pages::TransparentHuge;
+    }
+    size_t alignment = pages == Pages::TransparentHuge ? hugeSize : pageSize();
+    size_t size = alignUp( bytes, alignment );
+    if( !mapAligned( size, alignment, kHasGuardPages ? pageSize() : 0, region ) )
+    {
+        cobalt_log_error( "VirtualMemory: couldn't reserve %zu bytes", bytes );
+        return region;
+    }
+    region.pages = Pages::Normal;
+    #ifdef MADV_HUGEPAGE
+    if( pages == Pages::TransparentHuge && madvise( region.base, region.size, MADV_HUGEPAGE ) == 0 )
+    {
+        region.pages = Pages::TransparentHuge;
+    }
+    #endif
+#endif
+    return region;
+}
+
+bool VirtualMemory::commit( const Region& region, size_t offset, size_t bytes )
+{
+    if( !region.isValid() || bytes == 0 )
+    {
+        return region.isValid();
+    }
+    cobalt_assert( offset + bytes <= region.size );
+    if( region.pages == Pages::ExplicitHuge )
+    {
+        return true;
+    }
+    size_t begin = alignDown( offset, pageSize() );
+    size_t end = alignUp( offset + bytes, pageSize() );
+#if defined( _WIN32 )
+    if( !VirtualAlloc( region.base + begin, end - begin, MEM_COMMIT, PAGE_READWRITE ) )
+    {
+        cobalt_log_error( "VirtualMemory: couldn't commit %zu bytes", end - begin );
+        return false;
+    }
+#elif !defined( COBALT_EMSCRIPTEN )
+    if( mprotect( region.base + begin, end - begin, PROT_READ | PROT_WRITE ) != 0 )
+    {
+        cobalt_log_error( "VirtualMemory: couldn't commit %zu bytes", end - begin );
+        return false;
+    }
+#endif
+    return true;
+}
+
+void VirtualMemory::decommit( const Region& region, size_t offset, size_t bytes )
+{
+    if( !region.isValid() || bytes == 0 )
+    {
+        return;
+    }
+    cobalt_assert( offset + bytes <= region.size );
+    // Only whole pages inside the range can go
+    size_t granularity = region.pages == Pages::Normal ? pageSize() : hugePageSize();
+    size_t begin = alignUp( offset, granularity );
+    size_t end = alignDown( offset + bytes, granularity );
+    if( end <= begin )
+    {
+        return;
+    }
+#if defined( _WIN32 )
+    VirtualFree( region.base + begin, end - begin, MEM_DECOMMIT );
+#elif defined( COBALT_EMSCRIPTEN )
+    std::memset( region.base + begin, 0, end - begin );
+#else
+    madvise( region.base + begin, end - begin, MADV_DONTNEED );
+    if( region.pages != Pages::ExplicitHuge )
+    {
+        mprotect( region.base + begin, end - begin, PROT_NONE );
+    }
+#endif
+}
+
+void VirtualMemory::release( Region& region )
+{
+    if( !region.isValid() )
+    {
+        return;
+    }
+#if defined( _WIN32 )
+    VirtualFree( region.mapping, 0, MEM_RELEASE );
+#elif defined( COBALT_EMSCRIPTEN )
+    std::free( region.mapping );
+#else
+    munmap( region.mapping, region.mappingSize );
+#endif
+    region = Region();
+}
+
+VirtualMemory::Region VirtualMemory::allocate( size_t bytes, Pages pages )
+{
+    Region region = reserve( bytes, pages );
+    if( region.isValid() && !commit( region, 0, region.size ) )
+    {
+        release( region );
+    }
+    return region;
+}
+
+} }
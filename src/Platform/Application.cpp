@@ -1,51 +1,187 @@
 #include <Platform/Application.hpp>
+#include <Platform/CpuTopology.hpp>
+#include <Core/Clock.hpp>
+#include <Core/FrameArena.hpp>
+#include <Core/JobSystem.hpp>
 #include <Core/Log.hpp>
+#include <Core/MemoryTracker.hpp>
+#include <Core/Profiler.hpp>
+#include <Core/Task.hpp>
 
-#define GLEW_STATIC
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
+#if !COBALT_NO_GL
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+    #include <GLFW/glfw3.h>
+#endif
 
 #ifdef COBALT_EMSCRIPTEN
     #include <emscripten/emscripten.h>
 #endif
 
+#if !COBALT_NO_THREADS
+    #include <condition_variable>
+    #include <mutex>
+    #include <thread>
+#endif
+
 namespace cobalt { namespace platform {
 
 using namespace core;
-    
+
+    /// Worker running update() one frame ahead of the main thread
+    struct Application::UpdateThread
+    {
+#if !COBALT_NO_THREADS
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool hasWork = false;
+        bool isStopping = false;
+        bool isPrimed = false; // an update has been issued
+
+        int64_t elapsedNs = 0;
+        // Results of the last finished update
+        double alpha = 1.0;
+        int64_t startNs = 0;
+#endif
+    };
+
     Application::Application()
     {
     }
+
+    Application::~Application()
+    {
+        stopUpdateThread();
+    }
     
     void Application::onStartup()
     {
+        cobalt_profile_zone( "Application::onStartup" );
         // Allow subclasses to configure settings
         WindowConfiguration config;
         configure( config );
+        mFrameStats.setHitchThreshold( config.frameHitchThreshold );
+        mFrameStatsReportIntervalNs = Clock::fromSeconds( config.frameStatsReportInterval );
+        mFixedTimestepNs = Clock::fromSeconds( config.fixedTimestep );
+        mMaxUpdatesPerFrame = config.maxUpdatesPerFrame > 0 ? config.maxUpdatesPerFrame : 1;
+        mFramePacer.setTargetFps( config.targetFps );
+        mIsOnDemand = config.isOnDemand;
+        mOnDemandTimeout = config.onDemandTimeout;
+#if COBALT_HEADLESS
+        config.isHeadless = true;
+#endif
+#if COBALT_NO_GL
+        if( config.hasOffscreenContext )
+        {
+            cobalt_log_cat_warn( Log::Platform, "Built without GL (COBALT_HEADLESS without COBALT_OFFSCREEN_GL), so there is no offscreen context" );
+            config.hasOffscreenContext = false;
+        }
+#endif
+        mWidth = config.width;
+        mHeight = config.height;
         
-        if( !glfwInit() )
+        if( !config.isHeadless || config.hasOffscreenContext )
         {
-            return;
+            if( !createWindow( config ) )
+            {
+                mShouldUpdate = false;
+                return;
+            }
         }
-        if( config.isMaximized )
+        else
         {
-            const GLFWvidmode* videoMode = glfwGetVideoMode( glfwGetPrimaryMonitor() );
-            config.width = videoMode->width;
-            config.height = videoMode->height;
+            cobalt_log_cat_info( Log::Platform, "Running headless, without a window or GL context" );
         }
         
+        placeThreads( config );
+        // Pipelined, the update thread fills one buffer while the frame before
+        // is rendered from another, so keep a third
+        FrameArena::configureGlobal( config.frameArenaSize, config.isPipelined ? 3 : 2 );
+
+        // Allow subclasses to startup
+        startup();
+        mLastFrameStatsReportNs = Clock::nowNs();
+
+        if( config.isPipelined )
+        {
+#if COBALT_NO_THREADS
+            cobalt_log_cat_warn( Log::Platform, "Pipelined mode needs threads; running update and render serially" );
+#else
+            mUpdateThread.reset( new UpdateThread );
+            mUpdateThread->thread = std::thread( [this]() { runUpdateThread(); } );
+#endif
+        }
+    }
+
+    void Application::placeThreads( const WindowConfiguration& config )
+    {
+        if( !config.hasJobSystem && !config.isPinningThreads )
+        {
+            return;
+        }
+        ThreadPlacement placement = ThreadPlacement::plan( CpuTopology::system(), config.isPipelined );
+        mIsPinningThreads = config.isPinningThreads;
+        if( mIsPinningThreads )
+        {
+            mUpdateCpu = placement.updateCpu;
+            if( !pinCurrentThread( placement.mainCpu ) )
+            {
+                cobalt_log_cat_warn( Log::Platform, "Couldn't pin the main thread to CPU %d", placement.mainCpu );
+            }
+            if( !setCurrentThreadPriority( ThreadPriority::High ) )
+            {
+                cobalt_log_cat_info( Log::Platform, "Couldn't raise the main thread's priority" );
+            }
+        }
+        if( config.hasJobSystem )
+        {
+            JobSystem::Config jobConfig = placement.jobSystemConfig();
+            if( !mIsPinningThreads )
+            {
+                jobConfig.onWorkerStart = nullptr;
+            }
+            JobSystem::startup( jobConfig );
+            mHasJobSystem = true;
+        }
+    }
+
+    bool Application::createWindow( const WindowConfiguration& config )
+    {
+#if COBALT_NO_GL
+        cobalt_log_cat_error( Log::Platform, "Built without GL, so no window can be created" );
+        return false;
+#else
+        if( !glfwInit() )
+        {
+            cobalt_log_cat_error( Log::Platform, "glfwInit failed" );
+            return false;
+        }
         GLFWmonitor* targetMonitor = nullptr;
-        if( config.isFullscreen )
+        if( config.isHeadless )
+        {
+            // Offscreen: a hidden window just to own a GL context
+            glfwWindowHint( GLFW_VISIBLE, GL_FALSE ); // GLFW_FALSE only exists from GLFW 3.2
+        }
+        else if( config.isMaximized )
+        {
+            const GLFWvidmode* videoMode = glfwGetVideoMode( glfwGetPrimaryMonitor() );
+            mWidth = videoMode->width;
+            mHeight = videoMode->height;
+        }
+        if( !config.isHeadless && config.isFullscreen )
         {
             targetMonitor = glfwGetPrimaryMonitor();
         }
-        mWindow = glfwCreateWindow( config.width, config.height, config.name, targetMonitor, nullptr );
+        mWindow = glfwCreateWindow( mWidth, mHeight, config.name, targetMonitor, nullptr );
         if( !mWindow )
         {
+            cobalt_log_cat_error( Log::Platform, "glfwCreateWindow failed" );
             glfwTerminate();
-            return;
+            return false;
         }
         glfwMakeContextCurrent( mWindow );
+        glfwSwapInterval( config.swapInterval );
         glewExperimental = GL_TRUE;
         glewInit();
         
@@ -54,41 +190,288 @@ using namespace core;
         glViewport( 0, 0, width, height );
         
         glfwSetFramebufferSizeCallback( mWindow, Application::framebufferResizeCallback );
-        
-        // Allow subclasses to startup
-        startup();
+        return true;
+#endif
     }
 
     void Application::onUpdate( double dt )
     {
-        if( glfwWindowShouldClose( mWindow ) )
+        cobalt_profile_zone( "Application::onUpdate" );
+#if !COBALT_NO_GL
+        if( mWindow && glfwWindowShouldClose( mWindow ) )
         {
             mShouldUpdate = false;
             return;
         }
-        update( dt );
+#endif
+        // Anything invalidated from here on needs another frame
+        mIsInvalidated.store( false );
+        int64_t frameStartNs = Clock::nowNs();
+        int64_t updateStartNs = frameStartNs;
+        double alpha;
+        if( mUpdateThread )
+        {
+            alpha = waitForPipelinedUpdate( Clock::fromSeconds( dt ), updateStartNs );
+        }
+        else
+        {
+            alpha = simulate( Clock::fromSeconds( dt ) );
+            swapFrameState();
+        }
+        {
+            cobalt_profile_zone( "Application::render" );
+            render( alpha );
+        }
+        int64_t swapStartNs = Clock::nowNs();
+#if !COBALT_NO_GL
+        if( mWindow )
+        {
+            {
+                cobalt_profile_zone( "glfwSwapBuffers" );
+                glfwSwapBuffers( mWindow );
+            }
+            if( !mIsOnDemand )
+            {
+                cobalt_profile_zone( "glfwPollEvents" );
+                glfwPollEvents();
+            }
+        }
+#endif
+        int64_t frameEndNs = Clock::nowNs();
 
-        glfwSwapBuffers( mWindow );
-        glfwPollEvents();
+        double updateTime = Clock::toSeconds( swapStartNs - frameStartNs );
+        double swapTime = Clock::toSeconds( frameEndNs - swapStartNs );
+        mFrameStats.record( updateTime, swapTime, Clock::toSeconds( frameEndNs - updateStartNs ) );
+        if( updateTime + swapTime > mFrameStats.hitchThreshold() )
+        {
+            cobalt_log_throttled_warn( Log::Frame, 1.0, "Frame hitch: %.2f ms (update %.2f ms, swap %.2f ms)",
+                                       ( updateTime + swapTime ) * 1000.0, updateTime * 1000.0, swapTime * 1000.0 );
+        }
+        if( mFrameStatsReportIntervalNs > 0 && frameEndNs - mLastFrameStatsReportNs >= mFrameStatsReportIntervalNs )
+        {
+            mLastFrameStatsReportNs = frameEndNs;
+            reportFrameStats();
+        }
+
+        // Idle time is deliberately left out of the frame stats
+        waitBetweenFrames();
+    }
+
+    void Application::waitBetweenFrames()
+    {
+#ifndef COBALT_EMSCRIPTEN // the browser paces the main loop and delivers events
+        {
+            cobalt_profile_zone( "FramePacer::waitForNextFrame" );
+            mFramePacer.waitForNextFrame();
+        }
+#if !COBALT_NO_GL
+        if( mWindow && mIsOnDemand )
+        {
+            cobalt_profile_zone( "glfwWaitEvents" );
+            if( mIsInvalidated.load() )
+            {
+                glfwPollEvents();
+            }
+            else if( mOnDemandTimeout > 0.0 )
+            {
+                glfwWaitEventsTimeout( mOnDemandTimeout );
+            }
+            else
+            {
+                glfwWaitEvents();
+            }
+        }
+#endif
+#endif
+    }
+
+    double Application::simulate( int64_t elapsedNs )
+    {
+        cobalt_profile_zone( "Application::update" );
+        if( mFixedTimestepNs <= 0 )
+        {
+            update( Clock::toSeconds( elapsedNs ) );
+            return 1.0;
+        }
+
+        mAccumulatedNs += elapsedNs;
+        double step = Clock::toSeconds( mFixedTimestepNs );
+        int updates = 0;
+        while( mAccumulatedNs >= mFixedTimestepNs && updates < mMaxUpdatesPerFrame )
+        {
+            update( step );
+            mAccumulatedNs -= mFixedTimestepNs;
+            ++updates;
+        }
+        if( mAccumulatedNs >= mFixedTimestepNs )
+        {
+            // Can't keep up (or we were stalled); drop the backlog instead of
+            // spiraling into ever longer frames
+            cobalt_log_throttled_warn( Log::Frame, 1.0, "Fixed timestep fell behind, dropping %.2f ms of simulation",
+                                       Clock::toSeconds( mAccumulatedNs - mAccumulatedNs % mFixedTimestepNs ) * 1000.0 );
+            mAccumulatedNs %= mFixedTimestepNs;
+        }
+        return static_cast< double >( mAccumulatedNs ) / static_cast< double >( mFixedTimestepNs );
+    }
+
+    // Finishes the update started last frame, publishes its state and starts
+    // the next one; returns the finished update's alpha
+    double Application::waitForPipelinedUpdate( int64_t elapsedNs, int64_t& outUpdateStartNs )
+    {
+        double alpha = 1.0;
+#if !COBALT_NO_THREADS
+        cobalt_profile_zone( "Application::waitForUpdate" );
+        UpdateThread& worker = *mUpdateThread;
+        std::unique_lock< std::mutex > lock( worker.mutex );
+        if( !worker.isPrimed )
+        {
+            // First frame: nothing in flight yet, so run a zero-length update
+            // serially to produce a state to present.  The frame's time goes
+            // to the update issued below, so it is only simulated once.
+            worker.isPrimed = true;
+            worker.elapsedNs = 0;
+            worker.hasWork = true;
+            worker.condition.notify_all();
+        }
+        worker.condition.wait( lock, [&worker]() { return !worker.hasWork; } );
+        alpha = worker.alpha;
+        outUpdateStartNs = worker.startNs;
+
+        swapFrameState();
+
+        worker.elapsedNs = elapsedNs;
+        worker.hasWork = true;
+        worker.condition.notify_all();
+#endif
+        return alpha;
+    }
+
+    void Application::runUpdateThread()
+    {
+#if !COBALT_NO_THREADS
+        cobalt_profile_thread_name( "Update" );
+        if( mIsPinningThreads )
+        {
+            pinCurrentThread( mUpdateCpu );
+            setCurrentThreadPriority( ThreadPriority::High );
+        }
+        UpdateThread& worker = *mUpdateThread;
+        std::unique_lock< std::mutex > lock( worker.mutex );
+        while( true )
+        {
+            worker.condition.wait( lock, [&worker]() { return worker.hasWork || worker.isStopping; } );
+            if( !worker.hasWork )
+            {
+                return;
+            }
+            int64_t elapsedNs = worker.elapsedNs;
+            lock.unlock();
+
+            int64_t startNs = Clock::nowNs();
+            double alpha = simulate( elapsedNs );
+
+            lock.lock();
+            worker.startNs = startNs;
+            worker.alpha = alpha;
+            worker.hasWork = false;
+            worker.condition.notify_all();
+        }
+#endif
+    }
+
+    void Application::stopUpdateThread()
+    {
+#if !COBALT_NO_THREADS
+        if( !mUpdateThread )
+        {
+            return;
+        }
+        {
+            std::lock_guard< std::mutex > lock( mUpdateThread->mutex );
+            mUpdateThread->isStopping = true;
+        }
+        mUpdateThread->condition.notify_all();
+        mUpdateThread->thread.join();
+        mUpdateThread.reset();
+#endif
     }
 
     void Application::onShutdown()
     {
+        cobalt_profile_zone( "Application::onShutdown" );
+        // Let an in-flight update finish before tearing anything down
+        stopUpdateThread();
         shutdown();
-        glfwTerminate();
+        if( mHasJobSystem )
+        {
+            JobSystem::shutdown();
+            mHasJobSystem = false;
+        }
+#if !COBALT_NO_GL
+        if( mWindow )
+        {
+            glfwTerminate();
+            mWindow = nullptr;
+        }
+#endif
     }
     
+    void Application::reportFrameStats()
+    {
+        FrameStats::Summary stats = mFrameStats.summary();
+        cobalt_log_cat_info( Log::Frame, "Frame times over %zu frames: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms; "
+                             "update p95 %.2f ms, swap p95 %.2f ms, latency p95 %.2f ms; %zu hitches (%llu total)",
+                             stats.frameCount, stats.total.p50 * 1000.0, stats.total.p95 * 1000.0,
+                             stats.total.p99 * 1000.0, stats.total.max * 1000.0,
+                             stats.update.p95 * 1000.0, stats.swap.p95 * 1000.0, stats.latency.p95 * 1000.0,
+                             stats.hitchCount, static_cast< unsigned long long >( mFrameStats.hitchCount() ) );
+        FrameArena& arena = FrameArena::global();
+        cobalt_log_cat_info( Log::Frame, "Frame arena: high water %zu KiB of %zu KiB per frame",
+                             arena.highWaterMark() / 1024, arena.capacity() / 1024 );
+#if COBALT_MEMORY_TRACKING
+        MemoryTracker::logSnapshot();
+#endif
+    }
+
     //// Services
     
     void Application::getFrameBufferSize( int& outWidth, int& outHeight )
     {
-        glfwGetFramebufferSize( mWindow, &outWidth, &outHeight );
+#if !COBALT_NO_GL
+        if( mWindow )
+        {
+            glfwGetFramebufferSize( mWindow, &outWidth, &outHeight );
+            return;
+        }
+#endif
+        outWidth = mWidth;
+        outHeight = mHeight;
+    }
+
+    void Application::requestShutdown()
+    {
+        mShouldUpdate = false;
+        invalidate();
+    }
+
+    void Application::invalidate()
+    {
+        mIsInvalidated.store( true );
+#if !defined( COBALT_EMSCRIPTEN ) && !COBALT_NO_GL // the browser loop never blocks in glfwWaitEvents
+        if( mWindow )
+        {
+            // Wakes glfwWaitEvents; safe from any thread
+            glfwPostEmptyEvent();
+        }
+#endif
     }
 
 
     void Application::framebufferResizeCallback( GLFWwindow* window, int width, int height )
     {
+#if !COBALT_NO_GL
         glViewport(0, 0, width, height);
+#endif
     }
 
 namespace impl {
@@ -97,19 +480,29 @@ namespace impl {
     
     void gblUpdate()
     {
-        static double lastFrameUpdateTime = glfwGetTime();
-        double currentFrameUpdateTime = glfwGetTime();
-        double dt = currentFrameUpdateTime - lastFrameUpdateTime;
-        lastFrameUpdateTime = currentFrameUpdateTime;
+        static int64_t lastFrameUpdateNs = Clock::nowNs();
+        int64_t currentFrameUpdateNs = Clock::nowNs();
+        double dt = Clock::toSeconds( currentFrameUpdateNs - lastFrameUpdateNs );
+        lastFrameUpdateNs = currentFrameUpdateNs;
+        FrameArena::global().nextFrame();
+#if COBALT_MEMORY_TRACKING
+        MemoryTracker::nextFrame();
+#endif
+#if COBALT_HAS_COROUTINES
+        // Resume coroutines waiting for this frame or the main thread
+        TaskScheduler::pump();
+#endif
         if( gblApp )
         {
             gblApp->onUpdate( dt );
         }
-        double elapsedFrameUpdateTime = glfwGetTime() - currentFrameUpdateTime;
-        if( elapsedFrameUpdateTime > 0.16 )
+#if COBALT_NO_THREADS
+        // No background log thread, so write out this frame's buffered log lines
+        if( Log::isAsync() )
         {
-            Log::error( "Application::OnUpdate took too long at %1.4g ms", elapsedFrameUpdateTime * 0.001 );
+            Log::flush();
         }
+#endif
         // emscripten doesn't need to swap buffers, does desktop version?
         //glfwSwapBuffers();
     }
@@ -119,23 +512,29 @@ void launchCobaltApplication( Application* app )
 {
     using namespace impl;
     gblApp = app;
+    cobalt_profile_thread_name( "Main" );
+#if COBALT_HAS_COROUTINES
+    TaskScheduler::setMainThread();
+#endif
+    cobalt_profile_zone( "launchCobaltApplication" );
     
-    Log::info( "Application starting." );
+    cobalt_log_cat_info( Log::Platform, "Application starting." );
     gblApp->onStartup();
-    Log::info( "Application startup complete." );
+    cobalt_log_cat_info( Log::Platform, "Application startup complete." );
     
 #ifdef COBALT_EMSCRIPTEN
-    Log::info( "Passing update main loop to emscripten" );
-    emscripten_set_main_loop( gblUpdate, 60 /*fps*/, 1 /*infinite loop*/ );
+    cobalt_log_cat_info( Log::Platform, "Passing update main loop to emscripten" );
+    emscripten_set_main_loop( gblUpdate, static_cast< int >( gblApp->targetFps() ) /*fps, 0 for requestAnimationFrame*/, 1 /*infinite loop*/ );
     // Never reach here?
 #else
-    Log::info( "Starting update main loop" );
+    cobalt_log_cat_info( Log::Platform, "Starting update main loop" );
     while( gblApp->shouldUpdate() ) { gblUpdate(); };
 #endif
     
-    Log::info( "Application shutting down." );
+    cobalt_log_cat_info( Log::Platform, "Application shutting down." );
     gblApp->onShutdown();
-    Log::info( "Application shut down." );
+    cobalt_log_cat_info( Log::Platform, "Application shut down." );
+    Log::flush();
 }
     
 } }
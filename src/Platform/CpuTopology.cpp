@@ -0,0 +1,367 @@
+#include <Platform/CpuTopology.hpp>
+#include <Core/Log.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined( __linux__ )
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace cobalt { namespace platform {
+
+using namespace core;
+
+namespace {
+
+#if defined( __linux__ )
+
+    bool readLine( const std::string& path, std::string& line )
+    {
+        std::FILE* file = std::fopen( path.c_str(), "r" );
+        if( !file )
+        {
+            return false;
+        }
+        char buffer[ 4096 ];
+        bool isRead = std::fgets( buffer, sizeof( buffer ), file ) != nullptr;
+        std::fclose( file );
+        if( isRead )
+        {
+            line = buffer;
+            while( !line.empty() && ( line.back() == '\n' || line.back() == ' ' ) )
+            {
+                line.pop_back();
+            }
+        }
+        return isRead;
+    }
+
+    int readInt( const std::string& path, int fallback )
+    {
+        std::string line;
+        return readLine( path, line ) && !line.empty() ? std::atoi( line.c_str() ) : fallback;
+    }
+
+    /// Parses a sysfs cpu list such as "0-3,8,10-11"
+    std::vector< int > parseCpuList( const std::string& list )
+    {
+        std::vector< int > cpus;
+        const char* cursor = list.c_str();
+        while( *cursor )
+        {
+            char* end;
+            long first = std::strtol( cursor, &end, 10 );
+            if( end == cursor )
+            {
+                break;
+            }
+            long last = first;
+            cursor = end;
+            if( *cursor == '-' )
+            {
+                last = std::strtol( cursor + 1, &end, 10 );
+                cursor = end;
+            }
+            for( long cpu = first; cpu <= last; ++cpu )
+            {
+                cpus.push_back( static_cast< int >( cpu ) );
+            }
+            if( *cursor == ',' )
+            {
+                ++cursor;
+            }
+        }
+        return cpus;
+    }
+
+    std::vector< int > readCpuList( const std::string& path )
+    {
+        std::string line;
+        return readLine( path, line ) ? parseCpuList( line ) : std::vector< int >();
+    }
+
+    /// Lowest CPU sharing the data or unified cache at `level`, -1 if none
+    int cacheDomain( int cpu, int level )
+    {
+        for( int index = 0; ; ++index )
+        {
+            std::string cache = "/sys/devices/system/cpu/cpu" + std::to_string( cpu ) + "/cache/index" + std::to_string( index );
+            std::string type;
+            if( !readLine( cache + "/type", type ) )
+            {
+                return -1;
+            }
+            if( type != "Instruction" && readInt( cache + "/level", 0 ) == level )
+            {
+                std::vector< int > shared = readCpuList( cache + "/shared_cpu_list" );
+                return shared.empty() ? cpu : *std::min_element( shared.begin(), shared.end() );
+            }
+        }
+    }
+
+#endif
+
+    unsigned countDistinct( const std::vector< CpuTopology::Cpu >& cpus, int CpuTopology::Cpu::* field )
+    {
+        std::vector< int > values;
+        for( const CpuTopology::Cpu& cpu : cpus )
+        {
+            values.push_back( cpu.*field );
+        }
+        std::sort( values.begin(), values.end() );
+        return static_cast< unsigned >( std::unique( values.begin(), values.end() ) - values.begin() );
+    }
+
+}
+
+const CpuTopology& CpuTopology::system()
+{
+    static const CpuTopology topology = detect();
+    return topology;
+}
+
+CpuTopology CpuTopology::detect()
+{
+    CpuTopology topology;
+#if defined( __linux__ )
+    cpu_set_t allowed;
+    CPU_ZERO( &allowed );
+    bool hasAffinity = sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0;
+
+    std::map< int, int > nodeOfCpu;
+    for( int node : readCpuList( "/sys/devices/system/node/online" ) )
+    {
+        for( int cpu : readCpuList( "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist" ) )
+        {
+            nodeOfCpu[ cpu ] = node;
+        }
+    }
+
+    std::map< std::pair< int, int >, int > coreIndices; // ( package, core_id ) -> core
+    for( int id : readCpuList( "/sys/devices/system/cpu/online" ) )
+    {
+        if( hasAffinity && ( id >= CPU_SETSIZE || !CPU_ISSET( id, &allowed ) ) )
+        {
+            continue;
+        }
+        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string( id ) + "/topology/";
+        Cpu cpu;
+        cpu.id = id;
+        cpu.package = readInt( path + "physical_package_id", 0 );
+        int coreId = readInt( path + "core_id", id );
+        auto inserted = coreIndices.insert( std::make_pair( std::make_pair( cpu.package, coreId ), static_cast< int >( coreIndices.size() ) ) );
+        cpu.core = inserted.first->second;
+        auto node = nodeOfCpu.find( id );
+        cpu.numaNode = node != nodeOfCpu.end() ? node->second : 0;
+        cpu.l2Domain = cacheDomain( id, 2 );
+        cpu.l3Domain = cacheDomain( id, 3 );
+        topology.mCpus.push_back( cpu );
+    }
+#endif
+    if( topology.mCpus.empty() )
+    {
+        unsigned count = std::max( std::thread::hardware_concurrency(), 1u );
+        for( unsigned id = 0; id < count; ++id )
+        {
+            Cpu cpu;
+            cpu.id = static_cast< int >( id );
+            cpu.core = static_cast< int >( id );
+            topology.mCpus.push_back( cpu );
+        }
+    }
+
+    topology.mPhysicalCount = countDistinct( topology.mCpus, &Cpu::core );
+    topology.mPackageCount = countDistinct( topology.mCpus, &Cpu::package );
+    topology.mNumaNodeCount = countDistinct( topology.mCpus, &Cpu::numaNode );
+    cobalt_log_cat_info( Log::Platform, "CPU topology: %u logical CPUs, %u cores, %u packages, %u NUMA nodes",
+                         topology.logicalCount(), topology.mPhysicalCount, topology.mPackageCount, topology.mNumaNodeCount );
+    return topology;
+}
+
+const CpuTopology::Cpu* CpuTopology::find( int cpu ) const
+{
+    for( const Cpu& candidate : mCpus )
+    {
+        if( candidate.id == cpu )
+        {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+std::vector< int > CpuTopology::smtSiblings( int cpu ) const
+{
+    std::vector< int > siblings;
+    if( const Cpu* self = find( cpu ) )
+    {
+        for( const Cpu& other : mCpus )
+        {
+            if( other.core == self->core )
+            {
+                siblings.push_back( other.id );
+            }
+        }
+    }
+    return siblings;
+}
+
+std::vector< int > CpuTopology::l3Siblings( int cpu ) const
+{
+    std::vector< int > siblings;
+    if( const Cpu* self = find( cpu ) )
+    {
+        for( const Cpu& other : mCpus )
+        {
+            if( other.id == self->id || ( self->l3Domain >= 0 && other.l3Domain == self->l3Domain ) )
+            {
+                siblings.push_back( other.id );
+            }
+        }
+    }
+    return siblings;
+}
+
+std::vector< int > CpuTopology::primaryCpus() const
+{
+    std::vector< const Cpu* > firsts;
+    for( const Cpu& cpu : mCpus )
+    {
+        bool isFirst = std::none_of( firsts.begin(), firsts.end(), [&cpu]( const Cpu* other ) { return other->core == cpu.core; } );
+        if( isFirst )
+        {
+            firsts.push_back( &cpu );
+        }
+    }
+    std::stable_sort( firsts.begin(), firsts.end(), []( const Cpu* a, const Cpu* b ) { return a->numaNode < b->numaNode; } );
+    std::vector< int > primaries;
+    for( const Cpu* cpu : firsts )
+    {
+        primaries.push_back( cpu->id );
+    }
+    return primaries;
+}
+
+bool pinCurrentThread( const std::vector< int >& cpus )
+{
+    if( cpus.empty() )
+    {
+        return true;
+    }
+#if defined( __linux__ )
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    for( int cpu : cpus )
+    {
+        if( cpu >= 0 && cpu < CPU_SETSIZE )
+        {
+            CPU_SET( cpu, &set );
+        }
+    }
+    return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+    return false;
+#endif
+}
+
+bool pinCurrentThread( int cpu )
+{
+    return cpu < 0 || pinCurrentThread( std::vector< int >( 1, cpu ) );
+}
+
+bool setCurrentThreadPriority( ThreadPriority priority )
+{
+#if defined( __linux__ )
+    // Linux threads each have their own nice value; lowering it needs
+    // CAP_SYS_NICE or an RLIMIT_NICE allowance
+    int nice = priority == ThreadPriority::High ? -5 : priority == ThreadPriority::Background ? 10 : 0;
+    pid_t thread = static_cast< pid_t >( syscall( SYS_gettid ) );
+    return setpriority( PRIO_PROCESS, static_cast< id_t >( thread ), nice ) == 0;
+#else
+    return false;
+#endif
+}
+
+ThreadPlacement ThreadPlacement::plan( const CpuTopology& topology, bool reserveUpdateCore, bool useSmtSiblings )
+{
+    ThreadPlacement placement;
+    std::vector< int > primaries = topology.primaryCpus();
+    size_t reserved = reserveUpdateCore ? 2 : 1;
+    if( primaries.size() <= reserved )
+    {
+        // Too few cores to dedicate any; one unpinned worker still helps
+        // hide waits
+        placement.workerCpus.push_back( -1 );
+        return placement;
+    }
+
+    placement.mainCpu = primaries[ 0 ];
+    placement.updateCpu = reserveUpdateCore ? primaries[ 1 ] : -1;
+    placement.workerCpus.assign( primaries.begin() + reserved, primaries.end() );
+
+    // Siblings of the reserved cores are left to I/O; frame threads run
+    // best without a busy hyperthread next to them
+    std::vector< int > reservedSiblings = topology.smtSiblings( placement.mainCpu );
+    std::vector< int > updateSiblings = topology.smtSiblings( placement.updateCpu );
+    reservedSiblings.insert( reservedSiblings.end(), updateSiblings.begin(), updateSiblings.end() );
+    for( const CpuTopology::Cpu& cpu : topology.cpus() )
+    {
+        if( std::find( primaries.begin(), primaries.end(), cpu.id ) != primaries.end() )
+        {
+            continue;
+        }
+        bool isReserved = std::find( reservedSiblings.begin(), reservedSiblings.end(), cpu.id ) != reservedSiblings.end();
+        if( useSmtSiblings && !isReserved )
+        {
+            placement.workerCpus.push_back( cpu.id );
+        }
+        else
+        {
+            placement.ioCpus.push_back( cpu.id );
+        }
+    }
+    if( placement.ioCpus.empty() )
+    {
+        // No spare SMT siblings; share the worker cores at low priority
+        for( int cpu : primaries )
+        {
+            if( cpu != placement.mainCpu && cpu != placement.updateCpu )
+            {
+                placement.ioCpus.push_back( cpu );
+            }
+        }
+    }
+    return placement;
+}
+
+JobSystem::Config ThreadPlacement::jobSystemConfig() const
+{
+    JobSystem::Config config;
+    config.workerCount = static_cast< unsigned >( std::max< size_t >( workerCpus.size(), 1 ) );
+    std::vector< int > cpus = workerCpus;
+    ThreadPriority priority = workerPriority;
+    config.onWorkerStart = [cpus, priority]( unsigned worker )
+    {
+        if( worker < cpus.size() && !pinCurrentThread( cpus[ worker ] ) )
+        {
+            cobalt_log_cat_warn( Log::Platform, "Couldn't pin job worker %u to CPU %d", worker, cpus[ worker ] );
+        }
+        if( priority != ThreadPriority::Normal )
+        {
+            setCurrentThreadPriority( priority );
+        }
+    };
+    return config;
+}
+
+} }
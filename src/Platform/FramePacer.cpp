@@ -0,0 +1,61 @@
+#include <Platform/FramePacer.hpp>
+#include <Core/Clock.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace cobalt { namespace platform {
+
+using namespace core;
+
+namespace {
+    const int64_t kMinSpinNs = 50000;
+    const int64_t kMaxSpinNs = 4000000;
+}
+
+FramePacer::FramePacer( double targetFps )
+{
+    setTargetFps( targetFps );
+}
+
+void FramePacer::setTargetFps( double targetFps )
+{
+    mPeriodNs = targetFps > 0.0 ? static_cast< int64_t >( 1e9 / targetFps ) : 0;
+    mNextFrameNs = 0;
+}
+
+void FramePacer::waitForNextFrame()
+{
+    if( mPeriodNs <= 0 )
+    {
+        return;
+    }
+    int64_t now = Clock::nowNs();
+    mNextFrameNs = ( mNextFrameNs == 0 ? now : mNextFrameNs ) + mPeriodNs;
+    if( now >= mNextFrameNs )
+    {
+        // Late; start right away.  A frame or more behind, pace from here
+        // rather than bursting to catch up
+        if( now - mNextFrameNs >= mPeriodNs )
+        {
+            mNextFrameNs = now;
+        }
+        return;
+    }
+
+    int64_t spinNs = std::min( std::max( 2 * mSleepOvershootNs, kMinSpinNs ), kMaxSpinNs );
+    int64_t sleepNs = mNextFrameNs - now - spinNs;
+    if( sleepNs > 0 )
+    {
+        std::this_thread::sleep_for( std::chrono::nanoseconds( sleepNs ) );
+        int64_t overshootNs = std::max< int64_t >( Clock::nowNs() - now - sleepNs, 0 );
+        mSleepOvershootNs += ( overshootNs - mSleepOvershootNs ) / 8;
+    }
+    while( Clock::nowNs() < mNextFrameNs )
+    {
+        std::this_thread::yield();
+    }
+}
+
+} }
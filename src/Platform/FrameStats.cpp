@@ -0,0 +1,99 @@
+#include <Platform/FrameStats.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace cobalt { namespace platform {
+
+const size_t FrameStats::kCapacity;
+
+namespace {
+    const double kMicroseconds = 1000000.0;
+
+    uint32_t toMicroseconds( double seconds )
+    {
+        double us = seconds * kMicroseconds + 0.5;
+        return us <= 0.0 ? 0u : ( us >= 4294967295.0 ? 0xffffffffu : static_cast< uint32_t >( us ) );
+    }
+
+    // Nearest-rank percentiles of `count` sorted durations in microseconds
+    FrameStats::Percentiles percentiles( uint32_t* values, size_t count )
+    {
+        FrameStats::Percentiles result;
+        if( count == 0 )
+        {
+            return result;
+        }
+        std::sort( values, values + count );
+        auto rank = [&]( double p )
+        {
+            size_t index = static_cast< size_t >( std::ceil( p * count ) );
+            return values[ index > 0 ? index - 1 : 0 ] / kMicroseconds;
+        };
+        result.p50 = rank( 0.50 );
+        result.p95 = rank( 0.95 );
+        result.p99 = rank( 0.99 );
+        result.max = values[ count - 1 ] / kMicroseconds;
+        return result;
+    }
+}
+
+FrameStats::FrameStats( double hitchThreshold )
+: mFrameCount( 0 ),
+  mHitchCount( 0 ),
+  mHitchThreshold( hitchThreshold )
+{
+    for( size_t i = 0; i < kCapacity; ++i )
+    {
+        mSamples[ i ].store( 0, std::memory_order_relaxed );
+        mLatencies[ i ].store( 0, std::memory_order_relaxed );
+    }
+}
+
+void FrameStats::record( double updateSeconds, double swapSeconds, double latencySeconds )
+{
+    uint64_t packed = ( static_cast< uint64_t >( toMicroseconds( updateSeconds ) ) << 32 ) | toMicroseconds( swapSeconds );
+    uint64_t index = mFrameCount.load( std::memory_order_relaxed );
+    mSamples[ index % kCapacity ].store( packed, std::memory_order_relaxed );
+    mLatencies[ index % kCapacity ].store( toMicroseconds( latencySeconds ), std::memory_order_relaxed );
+    mFrameCount.store( index + 1, std::memory_order_release );
+    if( updateSeconds + swapSeconds > hitchThreshold() )
+    {
+        mHitchCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+FrameStats::Summary FrameStats::summary() const
+{
+    uint32_t total[ kCapacity ];
+    uint32_t update[ kCapacity ];
+    uint32_t swap[ kCapacity ];
+    uint32_t latency[ kCapacity ];
+
+    Summary result;
+    uint64_t frames = frameCount();
+    size_t count = static_cast< size_t >( std::min< uint64_t >( frames, kCapacity ) );
+    uint32_t hitchMicroseconds = toMicroseconds( hitchThreshold() );
+    for( size_t i = 0; i < count; ++i )
+    {
+        // The writer may overwrite the oldest slots meanwhile; those still
+        // hold a whole, just newer, frame
+        uint64_t packed = mSamples[ ( frames - count + i ) % kCapacity ].load( std::memory_order_relaxed );
+        update[ i ] = static_cast< uint32_t >( packed >> 32 );
+        swap[ i ] = static_cast< uint32_t >( packed );
+        total[ i ] = update[ i ] + swap[ i ];
+        latency[ i ] = mLatencies[ ( frames - count + i ) % kCapacity ].load( std::memory_order_relaxed );
+        if( total[ i ] > hitchMicroseconds )
+        {
+            ++result.hitchCount;
+        }
+    }
+    result.frameCount = count;
+    result.total = percentiles( total, count );
+    result.update = percentiles( update, count );
+    result.swap = percentiles( swap, count );
+    result.latency = percentiles( latency, count );
+    return result;
+}
+
+} }
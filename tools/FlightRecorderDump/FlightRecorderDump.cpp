@@ -0,0 +1,132 @@
+#include <Core/BinaryLog.hpp>
+#include <Core/FlightRecorder.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace cobalt::core;
+
+/// Prints the newest records of a FlightRecorder ring file in order, marking
+/// assertion failures.  Works on the file of a crashed (or running) process.
+///
+/// Usage: cobalt_flight_recorder_dump <ring file> [record count, default 50]
+int main( int argc, char* argv[] )
+{
+    if( argc < 2 || argc > 3 )
+    {
+        std::fprintf( stderr, "Usage: %s <ring file> [record count]\n", argv[ 0 ] );
+        return 1;
+    }
+    size_t wanted = argc == 3 ? std::strtoul( argv[ 2 ], nullptr, 10 ) : 50;
+
+    std::FILE* in = std::fopen( argv[ 1 ], "rb" );
+    if( !in )
+    {
+        std::fprintf( stderr, "Unable to open %s\n", argv[ 1 ] );
+        return 1;
+    }
+    std::fseek( in, 0, SEEK_END );
+    long fileSize = std::ftell( in );
+    std::fseek( in, 0, SEEK_SET );
+    std::vector< char > data( fileSize > 0 ? static_cast< size_t >( fileSize ) : 0 );
+    bool isRead = !data.empty() && std::fread( data.data(), 1, data.size(), in ) == data.size();
+    std::fclose( in );
+
+    const FlightRecorder::Header* header = reinterpret_cast< const FlightRecorder::Header* >( data.data() );
+    if( !isRead || data.size() < sizeof( *header )
+        || std::memcmp( header->magic, FlightRecorder::kMagic, sizeof( FlightRecorder::kMagic ) ) != 0
+        || header->version != FlightRecorder::kVersion
+        || header->recordSize != sizeof( FlightRecorder::Record )
+        || data.size() < sizeof( *header ) + header->recordCount * sizeof( FlightRecorder::Record )
+                         + header->formatCount * sizeof( FlightRecorder::Format ) )
+    {
+        std::fprintf( stderr, "%s is not a Cobalt flight recorder ring\n", argv[ 1 ] );
+        return 1;
+    }
+    const FlightRecorder::Record* records = reinterpret_cast< const FlightRecorder::Record* >( header + 1 );
+
+    // Format strings of binary records, by run and address in that run
+    std::map< std::pair< uint32_t, uint64_t >, std::string > formats;
+    const FlightRecorder::Format* formatTable = reinterpret_cast< const FlightRecorder::Format* >( records + header->recordCount );
+    for( uint64_t slot = 0; slot < header->formatCount; ++slot )
+    {
+        const FlightRecorder::Format& format = formatTable[ slot ];
+        uint64_t id = format.id.load();
+        if( id != 0 && id != FlightRecorder::kBusySequence )
+        {
+            formats[ std::make_pair( format.run, id ) ].assign( format.text, std::min< size_t >( format.length, sizeof( format.text ) ) );
+        }
+    }
+
+    // Keep only intact slots: a torn slot is still marked busy or has a
+    // sequence that doesn't map back to its own position
+    std::vector< const FlightRecorder::Record* > valid;
+    size_t torn = 0;
+    for( uint64_t slot = 0; slot < header->recordCount; ++slot )
+    {
+        uint64_t sequence = records[ slot ].sequence.load();
+        if( sequence == 0 )
+        {
+            continue;
+        }
+        if( sequence == FlightRecorder::kBusySequence || ( sequence - 1 ) % header->recordCount != slot )
+        {
+            ++torn;
+            continue;
+        }
+        valid.push_back( &records[ slot ] );
+    }
+    std::sort( valid.begin(), valid.end(), []( const FlightRecorder::Record* a, const FlightRecorder::Record* b )
+    {
+        return a->sequence.load() < b->sequence.load();
+    } );
+
+    uint64_t lastAssert = header->lastAssertSequence.load();
+    std::printf( "Flight recorder %s: pid %llu, %llu records written, %zu slots, %zu torn\n",
+                 argv[ 1 ],
+                 static_cast< unsigned long long >( header->processId ),
+                 static_cast< unsigned long long >( header->nextIndex.load() ),
+                 static_cast< size_t >( header->recordCount ), torn );
+    if( lastAssert )
+    {
+        std::printf( "Last assertion failure at record #%llu\n", static_cast< unsigned long long >( lastAssert ) );
+    }
+
+    static const char* levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+    char line[ 1024 ];
+    size_t first = valid.size() > wanted ? valid.size() - wanted : 0;
+    for( size_t i = first; i < valid.size(); ++i )
+    {
+        const FlightRecorder::Record& record = *valid[ i ];
+        const char* text = record.text;
+        size_t length = std::min< size_t >( record.length, sizeof( record.text ) );
+        BinaryLog::EventHeader event;
+        if( ( record.flags & FlightRecorder::BinaryFlag ) && length >= sizeof( event ) )
+        {
+            // A deferred record, decoded the way cobalt_log_decoder does
+            std::memcpy( &event, record.text, sizeof( event ) );
+            auto format = formats.find( std::make_pair( record.run, event.format ) );
+            const char* formatString = format != formats.end() ? format->second.c_str() : "<unknown format>";
+            size_t argBytes = std::min< size_t >( event.argBytes, length - sizeof( event ) );
+            length = BinaryLog::format( line, sizeof( line ), formatString, record.text + sizeof( event ), argBytes, event.argCount );
+            text = line;
+        }
+        std::time_t seconds = static_cast< std::time_t >( record.wallTimeNs / 1000000000 );
+        char time[ 32 ];
+        std::strftime( time, sizeof( time ), "%Y-%m-%d %H:%M:%S", std::localtime( &seconds ) );
+        std::printf( "%s #%-8llu %s.%03d %-5s %.*s\n",
+                     ( record.flags & FlightRecorder::AssertFlag ) ? "!!" : "  ",
+                     static_cast< unsigned long long >( record.sequence.load() ),
+                     time, static_cast< int >( ( record.wallTimeNs / 1000000 ) % 1000 ),
+                     record.level < 5 ? levelNames[ record.level ] : "?",
+                     static_cast< int >( length ), text );
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <Core/BinaryLog.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace cobalt::core;
+
+/// Decodes a binary log written by BinaryLog::openFile() into text.
+///
+/// Usage: cobalt_log_decoder <binary log file>
+int main( int argc, char* argv[] )
+{
+    if( argc != 2 )
+    {
+        std::fprintf( stderr, "Usage: %s <binary log file>\n", argv[ 0 ] );
+        return 1;
+    }
+    std::FILE* in = std::fopen( argv[ 1 ], "rb" );
+    if( !in )
+    {
+        std::fprintf( stderr, "Unable to open %s\n", argv[ 1 ] );
+        return 1;
+    }
+    char magic[ sizeof( BinaryLog::kFileMagic ) ];
+    if( std::fread( magic, 1, sizeof( magic ), in ) != sizeof( magic )
+        || std::memcmp( magic, BinaryLog::kFileMagic, sizeof( magic ) ) != 0 )
+    {
+        std::fprintf( stderr, "%s is not a Cobalt binary log\n", argv[ 1 ] );
+        std::fclose( in );
+        return 1;
+    }
+
+    static const char* levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+    std::unordered_map< uint64_t, std::string > formats;
+    std::vector< char > args;
+    char line[ 1024 ];
+    bool haveStartTime = false;
+    int64_t startTimeNs = 0;
+    int tag;
+    while( ( tag = std::fgetc( in ) ) != EOF )
+    {
+        if( tag == BinaryLog::FormatRecord )
+        {
+            uint64_t id;
+            uint32_t length;
+            if( std::fread( &id, sizeof( id ), 1, in ) != 1 || std::fread( &length, sizeof( length ), 1, in ) != 1 )
+            {
+                break;
+            }
+            std::string& format = formats[ id ];
+            format.resize( length );
+            if( length && std::fread( &format[ 0 ], 1, length, in ) != length )
+            {
+                break;
+            }
+        }
+        else if( tag == BinaryLog::EventRecord )
+        {
+            BinaryLog::EventHeader header;
+            if( std::fread( &header, sizeof( header ), 1, in ) != 1 )
+            {
+                break;
+            }
+            args.resize( header.argBytes );
+            if( header.argBytes && std::fread( args.data(), 1, header.argBytes, in ) != header.argBytes )
+            {
+                break;
+            }
+            if( !haveStartTime )
+            {
+                startTimeNs = header.timestampNs;
+                haveStartTime = true;
+            }
+            auto format = formats.find( header.format );
+            const char* formatString = format != formats.end() ? format->second.c_str() : "<unknown format>";
+            BinaryLog::format( line, sizeof( line ), formatString, args.data(), header.argBytes, header.argCount );
+            std::printf( "[%12.6f] %-5s %s\n",
+                         ( header.timestampNs - startTimeNs ) * 1e-9,
+                         header.level < 5 ? levelNames[ header.level ] : "?",
+                         line );
+        }
+        else
+        {
+            std::fprintf( stderr, "Corrupt record tag %d at offset %ld\n", tag, std::ftell( in ) - 1 );
+            break;
+        }
+    }
+    std::fclose( in );
+    return 0;
+}